@@ -15,6 +15,7 @@
 
 #include <iostream>
 #include <map>
+#include <sstream>
 #include <stdexcept>
 #include <unordered_set>
 
@@ -52,13 +53,21 @@ std::vector<Flag> infoFlags = {
 // Main CLI option flags that control behavior of the copy process
 std::vector<Flag> optionFlags = {
     {"--no-network", "", FlagType::Option, FlagValueType::No_Value, "", "Disable network access (e.g. for sponsors list)"},
-    {"--types", "", FlagType::Option, FlagValueType::Multi_Value, "<patterns>", "Include only files matching given patterns (e.g. *.h *.hpp)"},
-    {"--exclude-dirs", "", FlagType::Option, FlagValueType::Multi_Value, "<dirs>", "Exclude directories by name"},
-    {"--exclude-files", "", FlagType::Option, FlagValueType::Multi_Value, "<patterns>", "Exclude files matching patterns (e.g. *Impl.hpp)"},
+    {"--types", "", FlagType::Option, FlagValueType::Multi_Value, "<patterns>", "Include only files matching given patterns (e.g. *.h *.hpp, or paths like src/**/gen/*.h)"},
+    {"--exclude-dirs", "", FlagType::Option, FlagValueType::Multi_Value, "<dirs>", "Exclude directories by name or relative path (e.g. build third_party/*/test)"},
+    {"--exclude-files", "", FlagType::Option, FlagValueType::Multi_Value, "<patterns>", "Exclude files matching patterns (e.g. *Impl.hpp, or paths like src/legacy/*)"},
+    {"--rules", "", FlagType::Option, FlagValueType::Value, "<file>", "Ordered rules, one '+ pattern' or '- pattern' per line, first match wins (checked before --types/--exclude-*)"},
+    {"--ignore-files", "", FlagType::Option, FlagValueType::No_Value, "", "Skip what .gitignore / .prunecopyignore files in the sources ignore (ignored directories are not scanned)"},
+    {"--source-list", "", FlagType::Option, FlagValueType::Value, "<mode>", "How source files are found: walk (scan directories, default) or git (tracked files from .git/index, no scan)"},
+    {"--scan-cache", "", FlagType::Option, FlagValueType::Value, "<dir>", "Keep the directory entries of each source in this folder; unchanged directories (same mtime/ctime) are not read again"},
+    {"--files-from", "", FlagType::Option, FlagValueType::Value, "<path|->", "Copy only the files listed (relative to the source, NUL- or newline-separated, - = stdin) instead of scanning"},
     {"--delete-target-first", "", FlagType::Option, FlagValueType::No_Value, "", "Delete the entire target folder before copying"},
     {"--no-overwrite", "", FlagType::Option, FlagValueType::No_Value, "", "Skip files that already exist"},
     {"--force-overwrite", "", FlagType::Option, FlagValueType::No_Value, "", "Overwrite existing files without asking"},
-    {"--only-newer", "", FlagType::Option, FlagValueType::No_Value, "", "(comming feature) only copy, when source file is newer than the destination file"},
+    {"--index-destinations", "", FlagType::Option, FlagValueType::No_Value, "", "Scan the destinations once up front and answer existence checks from memory (fast on network drives)"},
+    {"--only-newer", "", FlagType::Option, FlagValueType::No_Value, "", "Only copy when the source file is newer than the destination file (replaces outdated files without asking)"},
+    {"--compare", "", FlagType::Option, FlagValueType::Value, "<policy>", "What marks a file as changed for --only-newer: mtime (default), size, size,mtime (implies --only-newer)"},
+    {"--mtime-tolerance", "", FlagType::Option, FlagValueType::Value, "<seconds>", "Ignore mtime differences up to this (e.g. 2 for FAT/SMB destinations)"},
     {"--cmdln-out-off", "", FlagType::Option, FlagValueType::No_Value, "", "Suppress console output", true, "--log-level none"},
     {"--log-dir", "", FlagType::Option, FlagValueType::Value,"<path>", "Write operations to a log file in the specified folder"},
     {"--log-open", "",FlagType::Option ,FlagValueType::No_Value,"","Open the log file after the operation (only when --log-dir <path> is set )"},
@@ -66,9 +75,14 @@ std::vector<Flag> optionFlags = {
     {"--flatten", "", FlagType::Option, FlagValueType::No_Value, "", "Copy all files into a single target directory"},
     {"--flatten-auto-rename", "", FlagType::Option, FlagValueType::No_Value, "", "automatically rename conflict files (filename(1).ext), affect only with --flatten flag"},
     {"--flatten-suffix", "", FlagType::Option, FlagValueType::No_Value, "", "Same as --flatten but adds suffixes(e.g.folders) to prevent name clashes"},
-    {"--parallel-async", "", FlagType::Option, FlagValueType::No_Value, "", "(comming feature) Use async-based parallel file copying"},
-    {"--parallel-thread", "", FlagType::Option, FlagValueType::No_Value, "", "(comming feature) Use threaded parallel file copying"},
-    {"--parallel-openMP", "", FlagType::Option, FlagValueType::No_Value, "", "(comming feature) Use OpenMP for parallel copying"},
+    {"--parallel-async", "", FlagType::Option, FlagValueType::No_Value, "", "Use async copy workers, conflicts are asked while other files keep copying"},
+    {"--parallel-thread", "", FlagType::Option, FlagValueType::No_Value, "", "Use a threaded scan/plan/copy pipeline"},
+    {"--parallel-openMP", "", FlagType::Option, FlagValueType::No_Value, "", "Use OpenMP for parallel copying (requires a build with OpenMP support)"},
+    {"--threads", "", FlagType::Option, FlagValueType::Value, "<count>", "Number of worker threads for parallel modes (default: all cores)"},
+    {"--copy-engine", "", FlagType::Option, FlagValueType::Value, "<mode>", "How file contents are copied: auto (default), kernel (copy_file_range/sendfile), rw (read/write loop), uring (batched io_uring, Linux)"},
+    {"--io-depth", "", FlagType::Option, FlagValueType::Value, "<count>", "Files in flight per io_uring for --copy-engine uring (default: 64)"},
+    {"--reflink", "", FlagType::Option, FlagValueType::Value, "<mode>", "Clone files on copy-on-write filesystems (btrfs, XFS): auto (default), always, never"},
+    {"--fd-relative", "", FlagType::Option, FlagValueType::No_Value, "", "Linux: open and create files relative to cached directory descriptors (fewer path lookups in deep trees)"},
     {"--color", "", FlagType::Option, FlagValueType::Value,"<mode>", "Console color output: auto (default), always, never"},
     {"--dry-run", "", FlagType::Option, FlagValueType::No_Value, "", "Show what would be copied without doing it"}
 };
@@ -167,12 +181,10 @@ void ArgumentParser::parse(int argc, char* argv[], PruneOptions& options, Parsed
     options.excludeDirs = getOptionValues(argc, argv, "--exclude-dirs");
     options.excludeFiles = getOptionValues(argc, argv, "--exclude-files");
 
-    // --- Compile Patterns ---
-    options.typePatterns = PatternUtils::convertToRegex(options.types);
-    options.excludeFilePatterns = PatternUtils::convertToRegex(options.excludeFiles);
-
     // --- Booleans ---
     options.dryRun = hasFlag(argc, argv, "--dry-run");
+    options.indexDestinations = hasFlag(argc, argv, "--index-destinations");
+    options.onlyNewer = hasFlag(argc, argv, "--only-newer");
     options.noOverwrite = hasFlag(argc, argv, "--no-overwrite");
     options.forceOverwrite = hasFlag(argc, argv, "--force-overwrite");
     options.flatten = hasFlag(argc, argv, "--flatten") || hasFlag(argc, argv, "--flatten-suffix");
@@ -181,6 +193,8 @@ void ArgumentParser::parse(int argc, char* argv[], PruneOptions& options, Parsed
     options.deleteTargetFirst = hasFlag(argc, argv, "--delete-target-first");
     options.quiet = hasFlag(argc, argv, "--cmdln-out-off");
     options.openLog = hasFlag(argc, argv, "--log-open");
+    options.useIgnoreFiles = hasFlag(argc, argv, "--ignore-files");
+    options.fdRelative = hasFlag(argc, argv, "--fd-relative");
 
     // --- Parallel Modes ---
     if (hasFlag(argc, argv, "--parallel-thread")) {
@@ -216,6 +230,83 @@ void ArgumentParser::parse(int argc, char* argv[], PruneOptions& options, Parsed
             }
         }
 
+        else if (arg == "--threads") {
+            if (i + 1 >= argc) throw std::runtime_error("--threads requires a number");
+            try {
+                options.threadCount = static_cast<unsigned>(std::stoul(argv[++i]));
+            }
+            catch (const std::exception&) {
+                throw std::runtime_error(std::string("Invalid thread count: ") + argv[i]);
+            }
+        }
+
+        else if (arg == "--copy-engine") {
+            if (i + 1 >= argc) throw std::runtime_error("--copy-engine requires a value (auto|kernel|rw|uring)");
+            std::string value = argv[++i];
+            std::transform(value.begin(), value.end(), value.begin(), ::tolower);
+            if (value == "auto")        options.copyEngine = CopyEngineMode::Auto;
+            else if (value == "kernel") options.copyEngine = CopyEngineMode::Kernel;
+            else if (value == "rw")     options.copyEngine = CopyEngineMode::ReadWrite;
+            else if (value == "uring")  options.copyEngine = CopyEngineMode::IoUring;
+            else throw std::runtime_error("Invalid copy engine: " + value);
+        }
+
+        else if (arg == "--compare") {
+            if (i + 1 >= argc) throw std::runtime_error("--compare requires a value (mtime|size|size,mtime)");
+            std::string value = argv[++i];
+            std::transform(value.begin(), value.end(), value.begin(), ::tolower);
+            options.compareSize = false;
+            options.compareMtime = false;
+            std::stringstream parts(value);
+            std::string part;
+            while (std::getline(parts, part, ',')) {
+                if (part == "size")       options.compareSize = true;
+                else if (part == "mtime") options.compareMtime = true;
+                else throw std::runtime_error("Invalid compare policy: " + value);
+            }
+            if (!options.compareSize && !options.compareMtime) {
+                throw std::runtime_error("Invalid compare policy: " + value);
+            }
+            options.onlyNewer = true;
+        }
+
+        else if (arg == "--mtime-tolerance") {
+            if (i + 1 >= argc) throw std::runtime_error("--mtime-tolerance requires a number of seconds");
+            double seconds = 0;
+            try {
+                seconds = std::stod(argv[++i]);
+            }
+            catch (const std::exception&) {
+                throw std::runtime_error(std::string("Invalid mtime tolerance: ") + argv[i]);
+            }
+            // Negative, NaN or beyond ~31 years would overflow the nanosecond count (and mean nothing)
+            if (!(seconds >= 0 && seconds <= 1e9)) {
+                throw std::runtime_error(std::string("Invalid mtime tolerance (0 to 1e9 seconds): ") + argv[i]);
+            }
+            options.mtimeToleranceNs = static_cast<std::int64_t>(seconds * 1e9);
+        }
+
+        else if (arg == "--io-depth") {
+            if (i + 1 >= argc) throw std::runtime_error("--io-depth requires a number");
+            try {
+                options.ioDepth = static_cast<unsigned>(std::stoul(argv[++i]));
+            }
+            catch (const std::exception&) {
+                throw std::runtime_error(std::string("Invalid io depth: ") + argv[i]);
+            }
+            if (options.ioDepth == 0) throw std::runtime_error("--io-depth must be at least 1");
+        }
+
+        else if (arg == "--reflink") {
+            if (i + 1 >= argc) throw std::runtime_error("--reflink requires a value (auto|always|never)");
+            std::string value = argv[++i];
+            std::transform(value.begin(), value.end(), value.begin(), ::tolower);
+            if (value == "auto")        options.reflink = ReflinkMode::Auto;
+            else if (value == "always") options.reflink = ReflinkMode::Always;
+            else if (value == "never")  options.reflink = ReflinkMode::Never;
+            else throw std::runtime_error("Invalid reflink mode: " + value);
+        }
+
         else if (arg == "--color") {
             if (i + 1 >= argc) throw std::runtime_error("--color requires a value (auto|always|never)");
             std::string value = argv[++i];
@@ -225,7 +316,49 @@ void ArgumentParser::parse(int argc, char* argv[], PruneOptions& options, Parsed
             else if (value == "never")  options.colorMode = ColorMode::Never;
             else throw std::runtime_error("Invalid color mode: " + value);
         }
+
+        else if (arg == "--source-list") {
+            if (i + 1 >= argc) throw std::runtime_error("--source-list requires a value (walk|git)");
+            std::string value = argv[++i];
+            std::transform(value.begin(), value.end(), value.begin(), ::tolower);
+            if (value == "walk")     options.sourceList = SourceListMode::Walk;
+            else if (value == "git") options.sourceList = SourceListMode::Git;
+            else throw std::runtime_error("Invalid source list mode: " + value);
+        }
+
+        else if (arg == "--files-from") {
+            if (i + 1 >= argc) throw std::runtime_error("--files-from requires a file path or - for stdin");
+            const std::string value = argv[++i];
+            options.filesFrom = value == "-" ? fs::path(value) : fs::absolute(value);
+        }
+
+        else if (arg == "--rules") {
+            if (i + 1 >= argc) throw std::runtime_error("--rules requires a file path");
+            options.rulesFile = fs::absolute(argv[++i]);
+        }
+
+        else if (arg == "--scan-cache") {
+            if (i + 1 >= argc) throw std::runtime_error("--scan-cache requires a directory");
+            options.scanCacheDir = fs::absolute(argv[++i]);
+        }
+    }
+
+    if (!options.filesFrom.empty() && options.sources.size() != 1) {
+        throw std::runtime_error("--files-from requires exactly one source");
     }
+    if (!options.filesFrom.empty() && options.sourceList == SourceListMode::Git) {
+        throw std::runtime_error("--files-from can't be combined with --source-list git");
+    }
+    // Conflict prompts read stdin as well: they would take list entries as answers
+    if (options.filesFrom == "-" && !options.forceOverwrite && !options.noOverwrite &&
+        (!options.onlyNewer || (options.flatten && !options.flattenAutoRename))) {
+        throw std::runtime_error("--files-from - needs --force-overwrite, --no-overwrite or --only-newer "
+            "(with --flatten also --flatten-auto-rename), conflict prompts can't read stdin");
+    }
+
+    // --- Compile Patterns ---
+    options.filters = std::make_shared<const FilterSet>(options.types, options.excludeFiles, options.excludeDirs,
+        options.rulesFile.empty() ? std::vector<Rule>{} : RuleSet::load(options.rulesFile));
 }
 
 
@@ -335,7 +468,8 @@ bool ArgumentParser::checkArguments(int argc, char* argv[]) {
             ++i;
             break;
         case FlagValueType::Value:
-            if (i + 1 >= argc || argv[i + 1][0] == '-') {
+            // A lone "-" is a value (stdin for --files-from), not a flag
+            if (i + 1 >= argc || (argv[i + 1][0] == '-' && std::string(argv[i + 1]) != "-")) {
                 message = "Flag \"" + currentArg + "\" requires a value.\nuse --help or -h for help\n";
                 LogManager::log(LogLevel::Error, message);
                 return false;
@@ -457,10 +591,15 @@ bool ArgumentParser::checkTests(int argc, char* argv[]) {
     if (hasFlag(argc, argv, "--test-all")) {
         return true;
     }
-    // Additional test flags (e.g. --unit-test, --benchmark) could be handled here in future
+    // Additional test flags (e.g. --unit-test) could be handled here in future
     return false;
 }
 
+// Checks if the benchmark flag is set
+bool ArgumentParser::checkBenchmark(int argc, char* argv[]) {
+    return hasFlag(argc, argv, "--benchmark");
+}
+
 // Parses and returns the appropriate log level enum from a string
 LogLevel ArgumentParser::parseLogLevel(const std::string& str) {
     std::string s = str;
@@ -567,6 +706,22 @@ std::vector<std::string> ArgumentParser::rebuildArgumentsFromOptions(const Prune
         }
     }
 
+    // --- File list ---
+    if (!options.filesFrom.empty()) {
+        args.push_back("--files-from");
+        args.push_back(options.filesFrom.string());
+    }
+
+    // --- Ordered rules ---
+    if (!options.rulesFile.empty()) {
+        args.push_back("--rules");
+        args.push_back(options.rulesFile.string());
+    }
+    if (!options.scanCacheDir.empty()) {
+        args.push_back("--scan-cache");
+        args.push_back(options.scanCacheDir.string());
+    }
+
     // --- Log options ---
     if (options.enableLogging && !options.logDir.empty()) {
         args.push_back("--log-dir");
@@ -593,6 +748,23 @@ std::vector<std::string> ArgumentParser::rebuildArgumentsFromOptions(const Prune
     if (options.deleteTargetFirst) args.push_back("--delete-target-first");
     if (options.noOverwrite)       args.push_back("--no-overwrite");
     if (options.forceOverwrite)    args.push_back("--force-overwrite");
+    if (options.indexDestinations) args.push_back("--index-destinations");
+    if (options.useIgnoreFiles)    args.push_back("--ignore-files");
+    if (options.sourceList == SourceListMode::Git) {
+        args.push_back("--source-list");
+        args.push_back("git");
+    }
+    if (options.onlyNewer)         args.push_back("--only-newer");
+    if (options.onlyNewer && (options.compareSize || !options.compareMtime)) {
+        args.push_back("--compare");
+        args.push_back(options.compareSize && options.compareMtime ? "size,mtime" : options.compareSize ? "size" : "mtime");
+    }
+    if (options.mtimeToleranceNs != 0) {
+        args.push_back("--mtime-tolerance");
+        std::ostringstream seconds;
+        seconds << static_cast<double>(options.mtimeToleranceNs) / 1e9;
+        args.push_back(seconds.str());
+    }
     if (options.flatten)           args.push_back("--flatten");
     if (options.flattenWithSuffix) args.push_back("--flatten-suffix");
 
@@ -603,6 +775,28 @@ std::vector<std::string> ArgumentParser::rebuildArgumentsFromOptions(const Prune
     case ParallelMode::OpenMP:  args.push_back("--parallel-openMP"); break;
     default: break;
     }
+    if (options.threadCount != 0) {
+        args.push_back("--threads");
+        args.push_back(std::to_string(options.threadCount));
+    }
+
+    // --- Copy engine ---
+    switch (options.copyEngine) {
+    case CopyEngineMode::Kernel:    args.push_back("--copy-engine"); args.push_back("kernel"); break;
+    case CopyEngineMode::ReadWrite: args.push_back("--copy-engine"); args.push_back("rw"); break;
+    case CopyEngineMode::IoUring:   args.push_back("--copy-engine"); args.push_back("uring"); break;
+    default: break;
+    }
+    if (options.ioDepth != PruneOptions{}.ioDepth) {
+        args.push_back("--io-depth");
+        args.push_back(std::to_string(options.ioDepth));
+    }
+    switch (options.reflink) {
+    case ReflinkMode::Always: args.push_back("--reflink"); args.push_back("always"); break;
+    case ReflinkMode::Never:  args.push_back("--reflink"); args.push_back("never"); break;
+    default: break;
+    }
+    if (options.fdRelative)        args.push_back("--fd-relative");
 
     // --- Color mode ---
     switch (options.colorMode) {
@@ -174,6 +174,14 @@ public:
 	 * @return True if test-related flags are set, false otherwise.
 	 */
 	static bool checkTests(int argc, char* argv[]);
+
+	/**
+	 * @brief Checks if the benchmark flag is set.
+	 * @param argc Number of command-line arguments.
+	 * @param argv Array of command-line arguments.
+	 * @return True if --benchmark is set, false otherwise.
+	 */
+	static bool checkBenchmark(int argc, char* argv[]);
 	
 	/**
 	 * @brief Parses a string and returns the corresponding LogLevel enum.
@@ -0,0 +1,332 @@
+/*****************************************************************//**
+ * @file   CopyEngine.cpp
+ * @brief  Implements the reflink / kernel-side copy engine and its fallbacks
+ *
+ * @author Patrik Neunteufel
+ * @date   May 2025
+ *********************************************************************/
+
+#include "core/CopyEngine.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <fstream>
+#include <system_error>
+#include <vector>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+    constexpr size_t kBufferSize = 256 * 1024;       // read/write loop buffer
+    constexpr size_t kKernelChunk = 64 * 1024 * 1024; // bytes per copy_file_range / sendfile call
+
+#ifdef __linux__
+    // Closes the descriptor when leaving scope
+    struct FileDescriptor {
+        int fd = -1;
+        explicit FileDescriptor(int value) : fd(value) {}
+        ~FileDescriptor() { if (fd >= 0) ::close(fd); }
+        FileDescriptor(const FileDescriptor&) = delete;
+        FileDescriptor& operator=(const FileDescriptor&) = delete;
+    };
+
+    // Throws a filesystem_error for the current errno
+    [[noreturn]] void throwErrno(const char* what, const fs::path& source, const fs::path& target) {
+        throw fs::filesystem_error(what, source, target, std::error_code(errno, std::generic_category()));
+    }
+
+    // Errors meaning "this method is not available for these files", so the next one is tried
+    bool isUnsupported(int error) {
+        return error == ENOSYS || error == EXDEV || error == EINVAL ||
+            error == EOPNOTSUPP || error == ENOTSUP || error == EBADF || error == EPERM;
+    }
+
+    // Clones the source extents into the (empty) target; false if the filesystem can't
+    bool cloneFile(int in, int out) {
+#ifdef FICLONE
+        return ::ioctl(out, FICLONE, in) == 0;
+#else
+        errno = EOPNOTSUPP;
+        return false;
+#endif
+    }
+
+    // --reflink always: clones into a temporary file next to the target and renames it over the
+    // target only on success, so a failed clone never truncates or removes an existing target
+    void cloneReplace(int in, mode_t mode, int targetDir, const fs::path& targetName,
+        const fs::path& source, const fs::path& target) {
+        static std::atomic<unsigned> counter{ 0 };
+        const std::string suffix = "." + std::to_string(::getpid()) + "." + std::to_string(++counter) + ".prunecopy";
+        // Only a prefix of long names, so the temporary name stays within NAME_MAX bytes
+        const std::string prefix = targetName.filename().string().substr(0, NAME_MAX - 1 - suffix.size());
+        fs::path tempName = targetName;
+        tempName.replace_filename("." + prefix + suffix);
+
+        FileDescriptor out(::openat(targetDir, tempName.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, mode));
+        if (out.fd < 0) throwErrno("cannot open target", source, target);
+        ::fchmod(out.fd, mode);
+
+        const bool cloned = cloneFile(in, out.fd);
+        const int error = errno;
+        if (!cloned || ::renameat(targetDir, tempName.c_str(), targetDir, targetName.c_str()) != 0) {
+            const int failure = cloned ? errno : error;
+            ::unlinkat(targetDir, tempName.c_str(), 0);
+            errno = failure;
+            throwErrno(cloned ? "cannot replace target" : "cannot clone file (--reflink always)", source, target);
+        }
+    }
+
+    /**
+     * @brief Outcome of a kernel-side copy loop
+     */
+    enum class KernelCopy {
+        Done,        // All bytes copied
+        Unsupported, // Nothing copied: refused, or no data reported (procfs, sysfs, some FUSE filesystems)
+        Partial      // Stopped early; the read/write loop copies the rest from the current offsets
+    };
+
+    // Loops copy_file_range until size bytes were copied
+    KernelCopy copyFileRange(int in, int out, std::uintmax_t size, const fs::path& source, const fs::path& target) {
+        std::uintmax_t done = 0;
+        while (done < size) {
+            const size_t chunk = static_cast<size_t>(std::min<std::uintmax_t>(size - done, kKernelChunk));
+            const ssize_t n = ::copy_file_range(in, nullptr, out, nullptr, chunk, 0);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                if (done == 0 && isUnsupported(errno)) return KernelCopy::Unsupported;
+                throwErrno("copy_file_range failed", source, target);
+            }
+            // 0 means end of file, but some filesystems also report it for data they can't copy in the kernel
+            if (n == 0) return done == 0 ? KernelCopy::Unsupported : KernelCopy::Partial;
+            done += static_cast<std::uintmax_t>(n);
+        }
+        return KernelCopy::Done;
+    }
+
+    // Loops sendfile until size bytes were copied
+    KernelCopy sendFile(int in, int out, std::uintmax_t size, const fs::path& source, const fs::path& target) {
+        std::uintmax_t done = 0;
+        while (done < size) {
+            const size_t chunk = static_cast<size_t>(std::min<std::uintmax_t>(size - done, kKernelChunk));
+            const ssize_t n = ::sendfile(out, in, nullptr, chunk);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                if (done == 0 && isUnsupported(errno)) return KernelCopy::Unsupported;
+                throwErrno("sendfile failed", source, target);
+            }
+            if (n == 0) return done == 0 ? KernelCopy::Unsupported : KernelCopy::Partial;
+            done += static_cast<std::uintmax_t>(n);
+        }
+        return KernelCopy::Done;
+    }
+
+    // Copies through a user-space buffer until end of file
+    void readWrite(int in, int out, const fs::path& source, const fs::path& target) {
+        std::vector<char> buffer(kBufferSize);
+        while (true) {
+            const ssize_t n = ::read(in, buffer.data(), buffer.size());
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                throwErrno("read failed", source, target);
+            }
+            if (n == 0) return;
+
+            ssize_t written = 0;
+            while (written < n) {
+                const ssize_t w = ::write(out, buffer.data() + written, static_cast<size_t>(n - written));
+                if (w < 0) {
+                    if (errno == EINTR) continue;
+                    throwErrno("write failed", source, target);
+                }
+                written += w;
+            }
+        }
+    }
+#else
+    // Portable read/write loop through a user-space buffer
+    void readWrite(const fs::path& source, const fs::path& target) {
+        std::ifstream in(source, std::ios::binary);
+        if (!in) {
+            throw fs::filesystem_error("cannot open source", source, target,
+                std::make_error_code(std::errc::no_such_file_or_directory));
+        }
+        std::ofstream out(target, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            throw fs::filesystem_error("cannot open target", source, target,
+                std::make_error_code(std::errc::permission_denied));
+        }
+
+        std::vector<char> buffer(kBufferSize);
+        while (in) {
+            in.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            out.write(buffer.data(), in.gcount());
+        }
+        if (!out) {
+            throw fs::filesystem_error("write failed", source, target, std::make_error_code(std::errc::io_error));
+        }
+        out.close();
+        fs::permissions(target, fs::status(source).permissions());
+    }
+#endif
+
+}
+
+// Formats all non-zero counters
+std::string CopyStats::toString() const {
+    std::string result;
+    for (size_t i = 0; i < files.size(); ++i) {
+        const size_t count = files[i].load();
+        if (count == 0) continue;
+        if (!result.empty()) result += ", ";
+        result += std::string(CopyEngine::methodName(static_cast<CopyMethod>(i))) + ": " + std::to_string(count);
+    }
+    return result.empty() ? "none" : result;
+}
+
+// Constructor
+CopyEngine::CopyEngine(CopyEngineMode mode, ReflinkMode reflink)
+    : m_mode(mode), m_reflink(reflink) {
+}
+
+// Display names used in the copy statistics
+const char* CopyEngine::methodName(CopyMethod method) {
+    switch (method) {
+    case CopyMethod::Reflink:       return "reflink";
+    case CopyMethod::CopyFileRange: return "copy_file_range";
+    case CopyMethod::Sendfile:      return "sendfile";
+    case CopyMethod::ReadWrite:     return "read/write";
+    case CopyMethod::IoUring:       return "io_uring";
+    case CopyMethod::FanOut:        return "fan-out";
+    case CopyMethod::Std:
+    default:                        return "std::filesystem";
+    }
+}
+
+#ifdef __linux__
+
+// Linux: full paths are resolved relative to the working directory
+CopyMethod CopyEngine::copyFile(const fs::path& source, const fs::path& target) const {
+    return copyFileAt(AT_FDCWD, source, AT_FDCWD, target);
+}
+
+// Linux: opens both files once and walks down the method chain
+// FICLONE shares the extents on CoW filesystems (btrfs, XFS, bcachefs), copy_file_range lets the kernel (or NFS/SMB server, or a CoW filesystem) move the data,
+// sendfile still avoids the user-space copy, read/write works everywhere
+CopyMethod CopyEngine::copyFileAt(int sourceDir, const fs::path& source, int targetDir, const fs::path& target) const {
+    // With an open directory only the filename is left for the kernel to resolve
+    const fs::path sourceName = sourceDir == AT_FDCWD ? source : source.filename();
+    const fs::path targetName = targetDir == AT_FDCWD ? target : target.filename();
+
+    FileDescriptor in(::openat(sourceDir, sourceName.c_str(), O_RDONLY | O_CLOEXEC));
+    if (in.fd < 0) throwErrno("cannot open source", source, target);
+
+    struct stat st {};
+    if (::fstat(in.fd, &st) != 0) throwErrno("cannot stat source", source, target);
+
+    // Never truncate the source by copying a file onto itself
+    struct stat existing {};
+    if (::fstatat(targetDir, targetName.c_str(), &existing, 0) == 0 && existing.st_dev == st.st_dev && existing.st_ino == st.st_ino) {
+        errno = EEXIST;
+        throwErrno("source and target are the same file", source, target);
+    }
+
+    if (m_reflink == ReflinkMode::Always) {
+        // The rename would replace a symlink with a regular file; like the other paths, write to
+        // the file it points to and keep the link
+        struct stat link {};
+        if (::fstatat(targetDir, targetName.c_str(), &link, AT_SYMLINK_NOFOLLOW) == 0 && S_ISLNK(link.st_mode)) {
+            std::error_code ec;
+            const fs::path resolved = fs::canonical(target, ec);
+            if (ec) throw fs::filesystem_error("cannot resolve symlinked target (--reflink always)", source, target, ec);
+            cloneReplace(in.fd, st.st_mode & 07777, AT_FDCWD, resolved, source, target);
+        }
+        else {
+            cloneReplace(in.fd, st.st_mode & 07777, targetDir, targetName, source, target);
+        }
+        return CopyMethod::Reflink;
+    }
+
+    FileDescriptor out(::openat(targetDir, targetName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, st.st_mode & 07777));
+    if (out.fd < 0) throwErrno("cannot open target", source, target);
+    ::fchmod(out.fd, st.st_mode & 07777); // an existing target keeps its mode otherwise
+
+    if (m_reflink == ReflinkMode::Auto && m_mode != CopyEngineMode::ReadWrite) {
+        struct stat targetStat {};
+        const bool sameDevice = ::fstat(out.fd, &targetStat) == 0 && targetStat.st_dev == st.st_dev;
+        if (sameDevice && cloneFile(in.fd, out.fd)) return CopyMethod::Reflink;
+    }
+
+    // A size of 0 may be a pseudo file (procfs) with content, only reading finds its real end
+    const auto size = static_cast<std::uintmax_t>(st.st_size);
+    if (m_mode != CopyEngineMode::ReadWrite && size > 0) {
+        KernelCopy result = copyFileRange(in.fd, out.fd, size, source, target);
+        if (result == KernelCopy::Done) return CopyMethod::CopyFileRange;
+        if (result == KernelCopy::Unsupported) {
+            result = sendFile(in.fd, out.fd, size, source, target);
+            if (result == KernelCopy::Done) return CopyMethod::Sendfile;
+        }
+    }
+
+    // Also finishes a kernel copy that stopped early (both offsets point behind the copied bytes)
+    readWrite(in.fd, out.fd, source, target);
+    return CopyMethod::ReadWrite;
+}
+
+// FICLONE only works within one filesystem; a target that doesn't exist yet lands on its nearest existing ancestor's
+bool CopyEngine::mayClone(const fs::path& sourceDir, const fs::path& targetDir) const {
+    const bool tryClone = m_reflink == ReflinkMode::Always ||
+        (m_reflink == ReflinkMode::Auto && m_mode != CopyEngineMode::ReadWrite);
+    struct stat source {};
+    if (!tryClone || ::stat(sourceDir.c_str(), &source) != 0) {
+        return false;
+    }
+    fs::path dir = targetDir;
+    struct stat target {};
+    while (::stat(dir.empty() ? "." : dir.c_str(), &target) != 0) {
+        if (dir.empty() || dir == dir.parent_path()) return false;
+        dir = dir.parent_path();
+    }
+    return source.st_dev == target.st_dev;
+}
+
+#else
+
+// Other platforms: std::filesystem::copy_file already copies inside the OS (CopyFile2 on Windows)
+CopyMethod CopyEngine::copyFile(const fs::path& source, const fs::path& target) const {
+    if (m_reflink == ReflinkMode::Always) {
+        throw fs::filesystem_error("cannot clone file (--reflink always is only supported on Linux)",
+            source, target, std::make_error_code(std::errc::operation_not_supported));
+    }
+
+    if (m_mode == CopyEngineMode::ReadWrite) {
+        readWrite(source, target);
+        return CopyMethod::ReadWrite;
+    }
+
+    fs::copy_file(source, target, fs::copy_options::overwrite_existing);
+    return CopyMethod::Std;
+}
+
+// Other platforms: files are never cloned
+bool CopyEngine::mayClone(const fs::path&, const fs::path&) const {
+    return false;
+}
+
+// Other platforms: the descriptors are never opened (DirectoryHandles::supported() is false), copy by path
+CopyMethod CopyEngine::copyFileAt(int, const fs::path& source, int, const fs::path& target) const {
+    return copyFile(source, target);
+}
+
+#endif
@@ -0,0 +1,121 @@
+/*****************************************************************//**
+ * @file   CopyEngine.hpp
+ * @brief  Moves the bytes of a single file (reflink clone, kernel-side
+ *         copy with fallbacks, or plain read/write)
+ *
+ * @author Patrik Neunteufel
+ * @date   May 2025
+ *********************************************************************/
+
+#pragma once
+#include <array>
+#include <atomic>
+#include <string>
+#include <filesystem>
+
+#include "core/PruneOptions.hpp"
+
+/**
+ * @brief The path a file actually took through the copy engine
+ */
+enum class CopyMethod {
+	Std = 0,        // std::filesystem::copy_file (platform default)
+	Reflink,        // ioctl(FICLONE): shares the extents, no data is copied
+	CopyFileRange,  // copy_file_range(2): in-kernel, may use server-side copy or reflinks
+	Sendfile,       // sendfile(2): in-kernel, no user-space buffer
+	ReadWrite,      // read/write loop through a user-space buffer
+	IoUring,        // batched io_uring submissions (counted by FileCopier, see UringCopier)
+	FanOut,         // read once, written to several destinations (counted by FileCopier, see FanOutCopier)
+	Count           // Number of methods (not a method)
+};
+
+/**
+ * @brief Per-method counters of copied files (thread-safe)
+ */
+struct CopyStats {
+	std::array<std::atomic<size_t>, static_cast<size_t>(CopyMethod::Count)> files{}; // Files per method
+
+	/**
+	 * @brief Counts one file for the given method.
+	 * @param method The method the file took
+	 */
+	void add(CopyMethod method) { ++files[static_cast<size_t>(method)]; }
+
+	/**
+	 * @brief Formats the non-zero counters, e.g. "copy_file_range: 10, read/write: 2".
+	 */
+	std::string toString() const;
+};
+
+/**
+ * @brief Copies single files according to the selected CopyEngineMode.
+ *
+ * Linux: the file is cloned with FICLONE first (unless ReflinkMode::Never, or
+ * ReflinkMode::Auto with CopyEngineMode::ReadWrite). Auto and Kernel then try
+ * copy_file_range, then sendfile, then a read/write loop; a method that copies
+ * nothing (pseudo and some FUSE filesystems) hands over to the next one, one
+ * that stops early is finished by the read/write loop. Other platforms:
+ * Auto and Kernel use std::filesystem::copy_file (which already copies inside
+ * the OS there). ReadWrite always uses the buffered loop. IoUring behaves like
+ * Auto for single files (batching is done by UringCopier).
+ * The target is created or truncated and receives the source permissions.
+ * A symlinked target is written through: the file it points to receives the
+ * copy (with ReflinkMode::Always it is replaced by the clone) and the link
+ * stays; with ReflinkMode::Always a dangling link is an error.
+ */
+class CopyEngine {
+public:
+	/**
+	 * @brief Constructs an engine for the given modes.
+	 * @param mode Selected copy engine mode
+	 * @param reflink Whether files are cloned instead of copied
+	 */
+	explicit CopyEngine(CopyEngineMode mode = CopyEngineMode::Auto, ReflinkMode reflink = ReflinkMode::Auto);
+
+	/**
+	 * @brief Copies source to target, overwriting an existing target.
+	 *
+	 * @param source Source file
+	 * @param target Target file
+	 * @return The method that performed the copy
+	 * @throws std::filesystem::filesystem_error on failure (also if ReflinkMode::Always cannot clone)
+	 */
+	CopyMethod copyFile(const std::filesystem::path& source, const std::filesystem::path& target) const;
+
+	/**
+	 * @brief Same as copyFile, but opens both files relative to open directories (--fd-relative).
+	 *
+	 * Linux only; other platforms ignore the descriptors and copy by path.
+	 *
+	 * @param sourceDir Directory descriptor the source's filename is opened relative to
+	 * @param source Source file (full path, used for error messages)
+	 * @param targetDir Directory descriptor the target's filename is created relative to
+	 * @param target Target file (full path, used for error messages)
+	 * @return The method that performed the copy
+	 * @throws std::filesystem::filesystem_error on failure (also if ReflinkMode::Always cannot clone)
+	 */
+	CopyMethod copyFileAt(int sourceDir, const std::filesystem::path& source,
+		int targetDir, const std::filesystem::path& target) const;
+
+	/**
+	 * @brief Whether copyFile would try to clone files from one directory into another.
+	 *
+	 * True if the reflink mode tries FICLONE and both directories (or the nearest
+	 * existing ancestor of the target) are on the same device; always false on
+	 * platforms without reflink support.
+	 *
+	 * @param sourceDir Directory of the source files
+	 * @param targetDir Directory the targets are written to (may not exist yet)
+	 */
+	bool mayClone(const std::filesystem::path& sourceDir, const std::filesystem::path& targetDir) const;
+
+	/**
+	 * @brief Returns a short display name for a method (used in statistics).
+	 * @param method The method
+	 */
+	static const char* methodName(CopyMethod method);
+
+private:
+	CopyEngineMode m_mode; ///< Selected engine mode
+	ReflinkMode m_reflink; ///< Selected reflink mode
+};
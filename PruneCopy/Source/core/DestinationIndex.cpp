@@ -0,0 +1,127 @@
+/*****************************************************************//**
+ * @file   DestinationIndex.cpp
+ * @brief  Implements the destination pre-pass index
+ *
+ * @author Patrik Neunteufel
+ * @date   May 2025
+ *********************************************************************/
+
+#include "core/DestinationIndex.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <thread>
+
+#ifdef _WIN32
+#include <cwctype>
+#endif
+
+#include "core/DirectoryWalker.hpp"
+
+namespace fs = std::filesystem;
+
+// Scans all roots at the same time, splitting the threads between them
+void DestinationIndex::build(const std::vector<fs::path>& roots, unsigned threadCount) {
+    m_roots.clear();
+    m_roots.resize(roots.size());
+
+    const unsigned total = threadCount == 0 ? std::max(1u, std::thread::hardware_concurrency()) : threadCount;
+    const unsigned perRoot = std::max(1u, total / static_cast<unsigned>(std::max<size_t>(1, roots.size())));
+
+    std::vector<std::exception_ptr> errors(roots.size());
+    std::vector<std::thread> threads;
+    threads.reserve(roots.size());
+
+    for (size_t i = 0; i < roots.size(); ++i) {
+        // "dst/" and "dst" must index the same keys
+        m_roots[i].root = roots[i].has_filename() || !roots[i].has_relative_path() ? roots[i] : roots[i].parent_path();
+        threads.emplace_back([&, i] {
+            try {
+                RootIndex& index = m_roots[i];
+                std::error_code ec;
+                if (!fs::exists(index.root, ec)) {
+                    index.missing = true; // nothing copied there yet
+                    return;
+                }
+                if (!fs::is_directory(index.root, ec)) return;
+
+                DirectoryWalker walker(std::make_shared<const FilterSet>(), perRoot); // nothing is pruned in a destination
+                walker.setCollectStats(true);
+                walker.walk(index.root, [&](DirectoryListing& listing) {
+                    const Key dir = keyOf(listing.relativeDir);
+                    index.dirs.insert(dir);
+                    if (!dir.empty()) index.others.insert(dir); // a file can't be created where the directory is
+                    for (size_t f = 0; f < listing.files.size(); ++f) {
+                        const Key key = keyOf(listing.relativeDir / listing.files[f].filename());
+                        if (listing.stats[f].exists) {
+                            index.files.emplace(key, listing.stats[f]);
+                        }
+                        else {
+                            index.others.insert(key); // vanished while scanning
+                        }
+                    }
+                    for (const auto& other : listing.others) {
+                        index.others.insert(keyOf(listing.relativeDir / other.filename()));
+                    }
+                    });
+            }
+            catch (...) {
+                errors[i] = std::current_exception();
+            }
+            });
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (const auto& error : errors) {
+        if (error) std::rethrow_exception(error);
+    }
+}
+
+// Finds the (innermost) root containing the target and looks up the relative path
+// A name the index has no file for is only known to be missing if its directory was listed
+bool DestinationIndex::lookup(const fs::path& target, FileStat& stat) const {
+    const RootIndex* best = nullptr;
+    fs::path bestRelative;
+
+    for (const auto& index : m_roots) {
+        fs::path relative = target.lexically_relative(index.root);
+        if (relative.empty() || relative == "." || *relative.begin() == "..") continue;
+        if (best && index.root.native().size() <= best->root.native().size()) continue;
+        best = &index;
+        bestRelative = std::move(relative);
+    }
+
+    if (!best) return false;
+
+    const Key key = keyOf(bestRelative);
+    if (const auto it = best->files.find(key); it != best->files.end()) {
+        stat = it->second;
+        return true;
+    }
+    // Below a symlinked directory (not listed), or a directory or special file of that name
+    if (!best->missing && (best->others.count(key) > 0 || best->dirs.count(keyOf(bestRelative.parent_path())) == 0)) {
+        return false;
+    }
+    stat = FileStat{};
+    return true;
+}
+
+// Generic separators; NTFS and the other Windows filesystems compare names case-insensitively
+DestinationIndex::Key DestinationIndex::keyOf(const fs::path& relative) {
+    Key key = relative.generic_string<fs::path::value_type>();
+#ifdef _WIN32
+    std::transform(key.begin(), key.end(), key.begin(), [](wchar_t c) { return static_cast<wchar_t>(std::towlower(c)); });
+#endif
+    return key;
+}
+
+// Total number of indexed files
+size_t DestinationIndex::size() const {
+    size_t count = 0;
+    for (const auto& index : m_roots) {
+        count += index.files.size();
+    }
+    return count;
+}
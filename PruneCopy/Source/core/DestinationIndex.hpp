@@ -0,0 +1,75 @@
+/*****************************************************************//**
+ * @file   DestinationIndex.hpp
+ * @brief  In-memory index of the destination trees (relative path ->
+ *         size/mtime), built once per run
+ *
+ * @author Patrik Neunteufel
+ * @date   May 2025
+ *********************************************************************/
+
+#pragma once
+#include <string>
+#include <vector>
+#include <filesystem>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "util/FileStat.hpp"
+
+/**
+ * @brief Answers "does this target exist, and how big/old is it" from memory.
+ *
+ * build() scans every destination once (all destinations in parallel, each
+ * with the parallel DirectoryWalker) so the planner doesn't need one
+ * metadata round-trip per file and destination. A miss only counts as "does
+ * not exist" inside a directory that was listed completely; paths below
+ * symlinked directories and names of other entries (directories, devices,
+ * dangling links) are left to the filesystem. Paths are compared
+ * case-insensitively on Windows. The index is read-only after build() and
+ * may be queried from any thread.
+ */
+class DestinationIndex {
+public:
+	/**
+	 * @brief Scans all destination roots. Missing roots are indexed as empty.
+	 *
+	 * @param roots Destination root directories
+	 * @param threadCount Total number of scanner threads (0 = hardware concurrency)
+	 */
+	void build(const std::vector<std::filesystem::path>& roots, unsigned threadCount);
+
+	/**
+	 * @brief Looks up a target path below one of the indexed roots.
+	 *
+	 * @param target Target path (destination root joined with the relative path)
+	 * @param stat Receives the indexed metadata (exists = false if the file is not in the index)
+	 * @return false if the index can't tell (caller has to ask the filesystem)
+	 */
+	bool lookup(const std::filesystem::path& target, FileStat& stat) const;
+
+	/**
+	 * @brief Returns the number of indexed files over all roots.
+	 */
+	size_t size() const;
+
+private:
+	using Key = std::filesystem::path::string_type;
+
+	/**
+	 * @brief Entries of one destination root, keyed by generic relative path
+	 */
+	struct RootIndex {
+		std::filesystem::path root;
+		bool missing = false;                    // The root didn't exist, so nothing below it does
+		std::unordered_map<Key, FileStat> files; // Regular files
+		std::unordered_set<Key> dirs;            // Directories listed completely ("" for the root)
+		std::unordered_set<Key> others;          // Subdirectories and other entries that aren't regular files
+	};
+
+	/**
+	 * @brief Index key of a path relative to its root (case folded on Windows)
+	 */
+	static Key keyOf(const std::filesystem::path& relative);
+
+	std::vector<RootIndex> m_roots; ///< One entry per destination root
+};
@@ -0,0 +1,97 @@
+/*****************************************************************//**
+ * @file   DirectoryCache.cpp
+ * @brief  Implements the cache of existing target directories
+ *
+ * @author Patrik Neunteufel
+ * @date   May 2025
+ *********************************************************************/
+
+#include "core/DirectoryCache.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <system_error>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+// Creates the missing levels top-down, stopping at the first ancestor that is already known
+void DirectoryCache::ensure(const fs::path& dir) {
+    if (dir.empty()) {
+        return;
+    }
+    std::string key = dir.string();
+    if (contains(key)) {
+        return;
+    }
+
+    const fs::path parent = dir.parent_path();
+    if (parent != dir) {
+        ensure(parent);
+    }
+
+    // A directory created concurrently by another worker is not an error
+    std::error_code ec;
+    if (!fs::create_directory(dir, ec) && ec) {
+        throw fs::filesystem_error("cannot create directory", dir, ec);
+    }
+
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    m_dirs.insert(std::move(key));
+}
+
+// Sorted and deduplicated first, then the threads take directories one by one
+void DirectoryCache::ensureAll(std::vector<fs::path> dirs, unsigned threadCount) {
+    std::sort(dirs.begin(), dirs.end());
+    dirs.erase(std::unique(dirs.begin(), dirs.end()), dirs.end());
+
+    const unsigned hardware = std::max(1u, std::thread::hardware_concurrency());
+    const unsigned count = static_cast<unsigned>(std::min<size_t>(threadCount == 0 ? hardware : threadCount, dirs.size()));
+    if (count <= 1) {
+        for (const auto& dir : dirs) {
+            ensure(dir);
+        }
+        return;
+    }
+
+    std::atomic<size_t> next{ 0 };
+    std::atomic<bool> failed{ false };
+    std::exception_ptr error;
+    std::mutex errorMutex;
+    std::vector<std::thread> threads;
+    threads.reserve(count);
+    for (unsigned t = 0; t < count; ++t) {
+        threads.emplace_back([&] {
+            for (size_t i = next++; i < dirs.size() && !failed; i = next++) {
+                try {
+                    ensure(dirs[i]);
+                }
+                catch (...) {
+                    std::lock_guard<std::mutex> lock(errorMutex);
+                    if (!error) error = std::current_exception();
+                    failed = true;
+                }
+            }
+            });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+// Number of cached directories (including ensured parents)
+size_t DirectoryCache::size() const {
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    return m_dirs.size();
+}
+
+// Shared lock: lookups of different workers don't block each other
+bool DirectoryCache::contains(const std::string& key) const {
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    return m_dirs.count(key) > 0;
+}
@@ -0,0 +1,57 @@
+/*****************************************************************//**
+ * @file   DirectoryCache.hpp
+ * @brief  Remembers the target directories that already exist, so
+ *         they are created once per run instead of once per file
+ *
+ * @author Patrik Neunteufel
+ * @date   May 2025
+ *********************************************************************/
+
+#pragma once
+#include <string>
+#include <vector>
+#include <filesystem>
+#include <shared_mutex>
+#include <unordered_set>
+
+/**
+ * @brief Thread-safe set of directories known to exist.
+ *
+ * ensure() replaces fs::create_directories for the copy workers: a directory
+ * that was ensured before costs one hash lookup under a shared lock, a new
+ * one only walks up to its nearest ensured ancestor and creates the missing
+ * levels with one mkdir each (no stat of the whole parent chain).
+ * ensureAll() pre-creates the skeleton of a complete task list in parallel.
+ */
+class DirectoryCache {
+public:
+	/**
+	 * @brief Makes sure a directory (and all its parents) exists.
+	 *
+	 * @param dir Directory to create
+	 * @throws std::filesystem::filesystem_error if it can't be created or is a file
+	 */
+	void ensure(const std::filesystem::path& dir);
+
+	/**
+	 * @brief Creates all given directories with several threads (duplicates are fine).
+	 *
+	 * @param dirs Directories to create
+	 * @param threadCount Number of threads (0 = hardware concurrency)
+	 */
+	void ensureAll(std::vector<std::filesystem::path> dirs, unsigned threadCount);
+
+	/**
+	 * @brief Returns the number of directories known to exist.
+	 */
+	size_t size() const;
+
+private:
+	/**
+	 * @brief Checks whether a directory was ensured before.
+	 */
+	bool contains(const std::string& key) const;
+
+	mutable std::shared_mutex m_mutex;      ///< Readers look up in parallel, new directories take it exclusively
+	std::unordered_set<std::string> m_dirs; ///< Directories known to exist (path strings as passed in)
+};
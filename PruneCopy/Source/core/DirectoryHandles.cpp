@@ -0,0 +1,126 @@
+/*****************************************************************//**
+ * @file   DirectoryHandles.cpp
+ * @brief  Implements the directory descriptor cache
+ *
+ * @author Patrik Neunteufel
+ * @date   May 2025
+ *********************************************************************/
+
+#include "core/DirectoryHandles.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <system_error>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+// Closes the descriptor once no worker and no cache entry references it
+DirectoryHandles::Handle::~Handle() {
+#ifdef __linux__
+    if (m_fd >= 0) ::close(m_fd);
+#endif
+}
+
+// Constructor
+DirectoryHandles::DirectoryHandles(size_t capacity)
+    : m_capacity(std::max<size_t>(1, capacity)) {
+}
+
+// Descriptor-relative calls are implemented for Linux only
+bool DirectoryHandles::supported() {
+#ifdef __linux__
+    return true;
+#else
+    return false;
+#endif
+}
+
+#ifdef __linux__
+
+// Resolves only the last component on a miss; the parent comes from the cache the same way
+std::shared_ptr<const DirectoryHandles::Handle> DirectoryHandles::open(const fs::path& dir, bool create) {
+    if (dir.empty()) {
+        return open(".", create); // parent of a bare filename
+    }
+    std::string key = dir.string();
+    if (auto cached = lookup(key)) {
+        return cached;
+    }
+
+    constexpr int flags = O_PATH | O_DIRECTORY | O_CLOEXEC;
+    const fs::path parent = dir.parent_path();
+    const fs::path name = dir.filename();
+    int fd = -1;
+    if (!parent.empty() && parent != dir && !name.empty()) {
+        const std::shared_ptr<const Handle> parentHandle = open(parent, create);
+        fd = ::openat(parentHandle->fd(), name.c_str(), flags);
+        if (fd < 0 && errno == ENOENT && create) {
+            if (::mkdirat(parentHandle->fd(), name.c_str(), 0777) == 0 || errno == EEXIST) {
+                fd = ::openat(parentHandle->fd(), name.c_str(), flags);
+            }
+        }
+    }
+    else {
+        // Filesystem root, a single relative component or a path with a trailing separator
+        fd = ::open(dir.c_str(), flags);
+        if (fd < 0 && errno == ENOENT && create) {
+            if (::mkdir(dir.c_str(), 0777) == 0 || errno == EEXIST) {
+                fd = ::open(dir.c_str(), flags);
+            }
+        }
+    }
+    if (fd < 0) {
+        throw fs::filesystem_error("cannot open directory", dir, std::error_code(errno, std::generic_category()));
+    }
+    return insert(std::move(key), std::make_shared<const Handle>(fd));
+}
+
+#else
+
+// Other platforms: callers check supported() first
+std::shared_ptr<const DirectoryHandles::Handle> DirectoryHandles::open(const fs::path& dir, bool) {
+    throw fs::filesystem_error("descriptor-relative access is only supported on Linux", dir,
+        std::make_error_code(std::errc::operation_not_supported));
+}
+
+#endif
+
+// Number of handles currently cached (handles still held by workers are not counted)
+size_t DirectoryHandles::size() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_lru.size();
+}
+
+// A hit moves the entry to the front of the list
+std::shared_ptr<const DirectoryHandles::Handle> DirectoryHandles::lookup(const std::string& key) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const auto it = m_index.find(key);
+    if (it == m_index.end()) {
+        return nullptr;
+    }
+    m_lru.splice(m_lru.begin(), m_lru, it->second);
+    return it->second->second;
+}
+
+// Two workers may open the same directory at once; the first one cached wins
+std::shared_ptr<const DirectoryHandles::Handle> DirectoryHandles::insert(std::string key, std::shared_ptr<const Handle> handle) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const auto it = m_index.find(key);
+    if (it != m_index.end()) {
+        m_lru.splice(m_lru.begin(), m_lru, it->second);
+        return it->second->second;
+    }
+    m_lru.emplace_front(std::move(key), std::move(handle));
+    m_index.emplace(m_lru.front().first, m_lru.begin());
+    while (m_lru.size() > m_capacity) {
+        m_index.erase(m_lru.back().first);
+        m_lru.pop_back();
+    }
+    return m_lru.front().second;
+}
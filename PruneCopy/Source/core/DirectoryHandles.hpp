@@ -0,0 +1,99 @@
+/*****************************************************************//**
+ * @file   DirectoryHandles.hpp
+ * @brief  LRU cache of open directory descriptors for openat/mkdirat
+ *         based copying (--fd-relative, Linux)
+ *
+ * @author Patrik Neunteufel
+ * @date   May 2025
+ *********************************************************************/
+
+#pragma once
+#include <list>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <utility>
+#include <filesystem>
+#include <unordered_map>
+
+/**
+ * @brief Open directories, each resolved relative to its cached parent.
+ *
+ * open() returns an O_PATH descriptor of a directory. On a miss only the
+ * last path component is resolved (openat relative to the parent's handle,
+ * which is looked up the same way), so the kernel no longer walks the full
+ * path for every file of a deep tree. With create = true missing levels are
+ * made with mkdirat.
+ *
+ * The cache holds at most capacity handles and drops the least recently used
+ * one; a handle still used by a worker stays open until its last shared_ptr
+ * is released. Thread-safe. Only supported on Linux (supported() is false
+ * elsewhere and open() throws).
+ */
+class DirectoryHandles {
+public:
+	static constexpr size_t DefaultCapacity = 256; ///< Upper bound for cached descriptors
+
+	/**
+	 * @brief An open directory descriptor, closed with the last reference.
+	 */
+	class Handle {
+	public:
+		explicit Handle(int fd) : m_fd(fd) {}
+		~Handle();
+		Handle(const Handle&) = delete;
+		Handle& operator=(const Handle&) = delete;
+
+		/**
+		 * @brief The descriptor, usable as dirfd of the *at calls.
+		 */
+		int fd() const { return m_fd; }
+
+	private:
+		int m_fd; ///< O_PATH directory descriptor
+	};
+
+	/**
+	 * @brief Creates an empty cache.
+	 * @param capacity Maximum number of cached handles (at least 1)
+	 */
+	explicit DirectoryHandles(size_t capacity = DefaultCapacity);
+
+	/**
+	 * @brief Whether descriptor-relative access is available on this platform.
+	 */
+	static bool supported();
+
+	/**
+	 * @brief Returns a handle of the directory, opening it relative to its parent's handle on a miss.
+	 *
+	 * @param dir Directory path
+	 * @param create Create the directory (and missing parents) if it doesn't exist
+	 * @return The handle (valid as long as the caller keeps it)
+	 * @throws std::filesystem::filesystem_error if the directory can't be opened or created
+	 */
+	std::shared_ptr<const Handle> open(const std::filesystem::path& dir, bool create = false);
+
+	/**
+	 * @brief Returns the number of cached handles.
+	 */
+	size_t size() const;
+
+private:
+	using Entry = std::pair<std::string, std::shared_ptr<const Handle>>;
+
+	/**
+	 * @brief Finds a cached handle and marks it as most recently used.
+	 */
+	std::shared_ptr<const Handle> lookup(const std::string& key);
+
+	/**
+	 * @brief Caches a handle (keeps an entry another thread added first) and evicts the oldest ones.
+	 */
+	std::shared_ptr<const Handle> insert(std::string key, std::shared_ptr<const Handle> handle);
+
+	size_t m_capacity;                                                   ///< Maximum number of cached handles
+	mutable std::mutex m_mutex;                                          ///< Guards the list and the map
+	std::list<Entry> m_lru;                                              ///< Most recently used first
+	std::unordered_map<std::string, std::list<Entry>::iterator> m_index; ///< Path string -> list entry
+};
@@ -0,0 +1,153 @@
+/*****************************************************************//**
+ * @file   DirectoryReader.cpp
+ * @brief  Implements the getdents64 directory reader
+ *
+ * @author Patrik Neunteufel
+ * @date   May 2025
+ *********************************************************************/
+
+#include "core/DirectoryReader.hpp"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <system_error>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+#ifdef __linux__
+
+namespace {
+
+    constexpr size_t kBufferSize = 64 * 1024; // bytes per getdents64 call
+
+    // Layout of struct linux_dirent64: d_ino (8), d_off (8), d_reclen (2), d_type (1), d_name
+    constexpr size_t kReclenOffset = 16;
+    constexpr size_t kTypeOffset = 18;
+    constexpr size_t kNameOffset = 19;
+
+    // Classifies an entry whose d_type doesn't tell (symlinks follow their target, like directory_entry)
+    EntryType statType(int dirFd, const char* name) {
+        struct stat st {};
+        if (::fstatat(dirFd, name, &st, 0) != 0) {
+            return EntryType::Other; // dangling link or removed meanwhile
+        }
+        if (S_ISREG(st.st_mode)) return EntryType::File;
+        if (S_ISDIR(st.st_mode)) return EntryType::Directory;
+        return EntryType::Other;
+    }
+
+}
+
+// The native reader is implemented for Linux only
+bool DirectoryReader::supported() {
+    return true;
+}
+
+// Constructor
+// Opens the directory for reading, the buffer is filled lazily by next()
+DirectoryReader::DirectoryReader(const fs::path& dir)
+    : m_dir(dir), m_fd(::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC)), m_buffer(kBufferSize) {
+    if (m_fd < 0) {
+        throw fs::filesystem_error("cannot open directory", dir, std::error_code(errno, std::generic_category()));
+    }
+}
+
+// Closes the directory descriptor
+DirectoryReader::~DirectoryReader() {
+    if (m_fd >= 0) ::close(m_fd);
+}
+
+// Walks the records of the buffer and refills it with the next batch when it is used up
+bool DirectoryReader::next(DirectoryEntry& entry) {
+    while (true) {
+        if (m_pos >= m_end) {
+            const long n = ::syscall(SYS_getdents64, m_fd, m_buffer.data(), m_buffer.size());
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                throw fs::filesystem_error("cannot read directory", m_dir, std::error_code(errno, std::generic_category()));
+            }
+            if (n == 0) return false;
+            m_pos = 0;
+            m_end = static_cast<size_t>(n);
+        }
+
+        const char* record = m_buffer.data() + m_pos;
+        std::uint16_t reclen = 0;
+        std::memcpy(&reclen, record + kReclenOffset, sizeof(reclen));
+        const unsigned char type = static_cast<unsigned char>(record[kTypeOffset]);
+        const char* name = record + kNameOffset;
+        m_pos += reclen;
+
+        if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+            continue;
+        }
+
+        entry.name.assign(name);
+        switch (type) {
+        case DT_REG: entry.type = EntryType::File; break;
+        case DT_DIR: entry.type = EntryType::Directory; break;
+        case DT_LNK:
+            entry.type = statType(m_fd, name);
+            if (entry.type == EntryType::Directory) entry.type = EntryType::DirectorySymlink;
+            break;
+        case DT_UNKNOWN: {
+            // Some filesystems don't fill d_type; a symlink must still be recognized as one
+            struct stat st {};
+            if (::fstatat(m_fd, name, &st, AT_SYMLINK_NOFOLLOW) == 0 && S_ISLNK(st.st_mode)) {
+                entry.type = statType(m_fd, name);
+                if (entry.type == EntryType::Directory) entry.type = EntryType::DirectorySymlink;
+            }
+            else {
+                entry.type = S_ISREG(st.st_mode) ? EntryType::File : S_ISDIR(st.st_mode) ? EntryType::Directory : EntryType::Other;
+            }
+            break;
+        }
+        default: entry.type = EntryType::Other; break;
+        }
+        return true;
+    }
+}
+
+// One statx relative to the open directory instead of resolving the full path
+FileStat DirectoryReader::stat(const DirectoryEntry& entry) const {
+    return FileStat::at(m_fd, entry.name.c_str());
+}
+
+#else
+
+// Other platforms use std::filesystem::directory_iterator
+bool DirectoryReader::supported() {
+    return false;
+}
+
+// Constructor
+// Not available: callers check supported() first
+DirectoryReader::DirectoryReader(const fs::path& dir)
+    : m_dir(dir) {
+    throw fs::filesystem_error("the native directory reader is only supported on Linux", dir,
+        std::make_error_code(std::errc::operation_not_supported));
+}
+
+// Nothing to close
+DirectoryReader::~DirectoryReader() = default;
+
+// Never reached (the constructor throws)
+bool DirectoryReader::next(DirectoryEntry&) {
+    return false;
+}
+
+// Never reached (the constructor throws)
+FileStat DirectoryReader::stat(const DirectoryEntry&) const {
+    return {};
+}
+
+#endif
@@ -0,0 +1,89 @@
+/*****************************************************************//**
+ * @file   DirectoryReader.hpp
+ * @brief  Reads directory entries in large getdents64 batches and
+ *         classifies them by d_type (Linux)
+ *
+ * @author Patrik Neunteufel
+ * @date   May 2025
+ *********************************************************************/
+
+#pragma once
+#include <string>
+#include <vector>
+#include <filesystem>
+
+#include "util/FileStat.hpp"
+
+/**
+ * @brief What the walker needs to know about a directory entry.
+ */
+enum class EntryType {
+	File,             // Regular file (or a symlink to one)
+	Directory,        // Directory
+	DirectorySymlink, // Symlink to a directory (checked against the filters, never followed)
+	Other             // Anything else (devices, sockets, dangling links, vanished entries)
+};
+
+/**
+ * @brief A single entry of a directory.
+ */
+struct DirectoryEntry {
+	std::string name; // Filename without the directory
+	EntryType type = EntryType::Other;
+};
+
+/**
+ * @brief Native directory reader for the DirectoryWalker.
+ *
+ * The directory is opened once and its entries are fetched with getdents64
+ * into a 64 KiB buffer, so one system call returns hundreds of entries. The
+ * type comes from d_type; only symlinks and filesystems reporting DT_UNKNOWN
+ * cost an fstatat. Size and mtime are read with statx relative to the open
+ * directory, and only when stat() is asked for them.
+ *
+ * Only supported on Linux (supported() is false elsewhere and the
+ * constructor throws); the walker uses std::filesystem there.
+ */
+class DirectoryReader {
+public:
+	/**
+	 * @brief Whether the native reader is available on this platform.
+	 */
+	static bool supported();
+
+	/**
+	 * @brief Opens the directory.
+	 * @param dir Directory to read
+	 * @throws std::filesystem::filesystem_error if it can't be opened (same as std::filesystem::directory_iterator)
+	 */
+	explicit DirectoryReader(const std::filesystem::path& dir);
+
+	/**
+	 * @brief Closes the directory.
+	 */
+	~DirectoryReader();
+
+	DirectoryReader(const DirectoryReader&) = delete;
+	DirectoryReader& operator=(const DirectoryReader&) = delete;
+
+	/**
+	 * @brief Returns the next entry ("." and ".." are skipped).
+	 * @param entry Receives the entry
+	 * @return false at the end of the directory
+	 * @throws std::filesystem::filesystem_error if reading fails
+	 */
+	bool next(DirectoryEntry& entry);
+
+	/**
+	 * @brief Reads size and mtime of an entry relative to the open directory (one statx).
+	 * @param entry An entry returned by next()
+	 */
+	FileStat stat(const DirectoryEntry& entry) const;
+
+private:
+	std::filesystem::path m_dir; ///< Directory (for error messages)
+	int m_fd = -1;               ///< Open directory descriptor
+	std::vector<char> m_buffer;  ///< Raw getdents64 records
+	size_t m_pos = 0;            ///< Offset of the next record in m_buffer
+	size_t m_end = 0;            ///< Number of valid bytes in m_buffer
+};
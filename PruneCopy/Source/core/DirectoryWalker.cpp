@@ -0,0 +1,342 @@
+/*****************************************************************//**
+ * @file   DirectoryWalker.cpp
+ * @brief  Implements the work-stealing parallel directory traversal
+ *
+ * @author Patrik Neunteufel
+ * @date   May 2025
+ *********************************************************************/
+
+#include "core/DirectoryWalker.hpp"
+#include "core/DirectoryReader.hpp"
+#include "core/ScanCache.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+
+namespace fs = std::filesystem;
+
+namespace {
+
+    // Cached names are UTF-8 on Windows (narrow strings would lose characters outside the code page)
+    std::string cacheName(const fs::path& name) {
+#ifdef _WIN32
+        const std::u8string utf8 = name.u8string();
+        return std::string(utf8.begin(), utf8.end());
+#else
+        return name.native();
+#endif
+    }
+
+    // Inverse of cacheName
+    fs::path cachePath(const std::string& name) {
+#ifdef _WIN32
+        return fs::path(std::u8string(name.begin(), name.end()));
+#else
+        return fs::path(name);
+#endif
+    }
+
+    // Name as the filters see it (path::string(), like the directory_iterator branch)
+    std::string filterName(const std::string& name) {
+#ifdef _WIN32
+        return cachePath(name).string();
+#else
+        return name;
+#endif
+    }
+
+}
+
+// Constructor
+// Compiles the exclude-dir patterns once and resolves the worker count
+DirectoryWalker::DirectoryWalker(const std::vector<std::string>& excludeDirs, unsigned threadCount)
+    : DirectoryWalker(std::make_shared<const FilterSet>(std::vector<std::string>{}, std::vector<std::string>{}, excludeDirs), threadCount) {
+}
+
+// Constructor
+// Shares the filters compiled by ArgumentParser/PresetLoader and resolves the worker count
+DirectoryWalker::DirectoryWalker(std::shared_ptr<const FilterSet> filters, unsigned threadCount)
+    : m_filters(std::move(filters)),
+      m_threadCount(threadCount == 0 ? std::max(1u, std::thread::hardware_concurrency()) : threadCount) {
+}
+
+// Lists a single directory: collects regular files, prunes excluded directories
+// and returns the remaining subdirectories for further traversal
+std::vector<DirectoryWalker::WorkItem> DirectoryWalker::scanDirectory(WorkItem item, DirectoryListing& listing) const {
+    std::vector<WorkItem> subdirs;
+    listing.directory = std::move(item.dir);
+    listing.relativeDir = std::move(item.relativeDir);
+    listing.pathState = std::move(item.pathState);
+    const bool pathPatterns = m_filters->hasPathPatterns();
+    const std::shared_ptr<const IgnoreStack> ignore =
+        m_useIgnoreFiles ? IgnoreStack::enter(item.parentIgnore, listing.directory) : nullptr;
+    const bool ignoring = ignore && !ignore->empty();
+
+    // Prunes a subdirectory before it is ever enqueued, otherwise queues it
+    auto addDirectory = [&](const std::string& name, fs::path path, bool symlink) {
+        if (m_filters->isExcludedDir(name, listing.pathState) || (ignoring && ignore->isIgnored(name, true))) {
+            listing.skippedDirs.push_back(std::move(path));
+            return;
+        }
+        // Symlinked directories are not followed (same as recursive_directory_iterator)
+        if (symlink) {
+            if (m_collectStats) listing.others.push_back(std::move(path));
+            return;
+        }
+        fs::path relativeDir = listing.relativeDir / path.filename();
+        if (!pathPatterns) {
+            subdirs.push_back({ std::move(path), std::move(relativeDir), {}, ignore });
+            return;
+        }
+        // Nothing below can be copied once no include path pattern or rule can match any more
+        FilterSet::PathState childState = m_filters->descend(listing.pathState, name);
+        if (m_filters->canContainIncluded(childState)) {
+            subdirs.push_back({ std::move(path), std::move(relativeDir), std::move(childState), ignore });
+        }
+    };
+
+    // Keeps a regular file unless an ignore file excludes it
+    auto addFile = [&](const std::string& name, fs::path path) {
+        if (ignoring && ignore->isIgnored(name, false)) {
+            return false;
+        }
+        listing.files.push_back(std::move(path));
+        return true;
+    };
+
+    // --scan-cache: an unchanged directory is served from the cache without reading it
+    ScanCache::Stamp stamp;
+    std::vector<DirectoryEntry> entries;
+    const std::shared_ptr<const std::vector<DirectoryEntry>> cached =
+        m_scanCache ? m_scanCache->lookup(listing.directory, listing.relativeDir, stamp) : nullptr;
+    if (cached) {
+        for (const auto& entry : *cached) {
+            fs::path path = listing.directory / cachePath(entry.name);
+            const std::string name = filterName(entry.name);
+            if (entry.type == EntryType::Directory || entry.type == EntryType::DirectorySymlink) {
+                addDirectory(name, std::move(path), entry.type == EntryType::DirectorySymlink);
+            }
+            else if (entry.type == EntryType::File) {
+                if (addFile(name, std::move(path)) && m_collectStats) {
+                    listing.stats.push_back(FileStat::of(listing.files.back())); // sizes and mtimes are never cached
+                }
+            }
+            else if (m_collectStats) {
+                listing.others.push_back(std::move(path));
+            }
+        }
+    }
+    else if (m_useNativeReader && DirectoryReader::supported()) {
+        // Entry types come from d_type; a stat is only paid for symlinks, DT_UNKNOWN and collected stats
+        DirectoryReader reader(listing.directory);
+        DirectoryEntry entry;
+        while (reader.next(entry)) {
+            if (entry.type == EntryType::Directory || entry.type == EntryType::DirectorySymlink) {
+                addDirectory(entry.name, listing.directory / entry.name, entry.type == EntryType::DirectorySymlink);
+            }
+            else if (entry.type == EntryType::File) {
+                if (addFile(entry.name, listing.directory / entry.name) && m_collectStats) {
+                    listing.stats.push_back(reader.stat(entry));
+                }
+            }
+            else if (m_collectStats) {
+                listing.others.push_back(listing.directory / entry.name);
+            }
+            if (m_scanCache && entry.type != EntryType::Other) {
+                entries.push_back(entry);
+            }
+        }
+    }
+    else {
+        for (const auto& entry : fs::directory_iterator(listing.directory)) {
+            if (entry.is_directory()) {
+                addDirectory(entry.path().filename().string(), entry.path(), entry.is_symlink());
+                if (m_scanCache) {
+                    entries.push_back({ cacheName(entry.path().filename()), entry.is_symlink() ? EntryType::DirectorySymlink : EntryType::Directory });
+                }
+                continue;
+            }
+
+            if (entry.is_regular_file()) {
+                if (m_scanCache) {
+                    entries.push_back({ cacheName(entry.path().filename()), EntryType::File });
+                }
+                if (addFile(entry.path().filename().string(), entry.path()) && m_collectStats) {
+                    listing.stats.push_back(FileStat::of(entry)); // cached by the iteration on Windows
+                }
+            }
+            else if (m_collectStats) {
+                listing.others.push_back(entry.path());
+            }
+        }
+    }
+    if (m_scanCache && !cached) {
+        m_scanCache->store(listing.relativeDir, stamp, std::move(entries));
+    }
+
+    if (m_collectStats) {
+        // Sort files and stats together
+        std::vector<size_t> order(listing.files.size());
+        for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return listing.files[a] < listing.files[b]; });
+
+        std::vector<fs::path> files;
+        std::vector<FileStat> stats;
+        files.reserve(order.size());
+        stats.reserve(order.size());
+        for (size_t i : order) {
+            files.push_back(std::move(listing.files[i]));
+            stats.push_back(listing.stats[i]);
+        }
+        listing.files = std::move(files);
+        listing.stats = std::move(stats);
+    }
+    else {
+        std::sort(listing.files.begin(), listing.files.end());
+    }
+    std::sort(listing.skippedDirs.begin(), listing.skippedDirs.end());
+    std::sort(subdirs.begin(), subdirs.end(), [](const WorkItem& a, const WorkItem& b) { return a.dir < b.dir; });
+    return subdirs;
+}
+
+// Walks the tree and passes each directory listing to the sink
+// Single-threaded walks run inline in depth-first order, otherwise workers steal from each other
+void DirectoryWalker::walk(const fs::path& root, const std::function<void(DirectoryListing&)>& sink) const {
+    if (m_threadCount <= 1) {
+        std::vector<WorkItem> stack;
+        stack.push_back({ root, {}, m_filters->rootState(), nullptr });
+        while (!stack.empty()) {
+            WorkItem item = std::move(stack.back());
+            stack.pop_back();
+
+            DirectoryListing listing;
+            std::vector<WorkItem> subdirs = scanDirectory(std::move(item), listing);
+
+            // Push in reverse so the smallest name is visited next
+            for (auto it = subdirs.rbegin(); it != subdirs.rend(); ++it) {
+                stack.push_back(std::move(*it));
+            }
+            sink(listing);
+        }
+        return;
+    }
+
+    std::vector<WorkQueue> queues(m_threadCount);
+    std::atomic<size_t> pending{ 1 };   // directories enqueued but not yet finished
+    std::atomic<bool> failed{ false };
+    std::exception_ptr error;
+    std::mutex errorMutex;
+    std::mutex sinkMutex;
+    std::mutex idleMutex;                    // parks workers that found nothing to steal
+    std::condition_variable idle;
+    std::atomic<std::uint64_t> wakeups{ 0 }; // bumped under idleMutex when work was pushed or the walk ends
+
+    queues[0].tasks.push_back({ root, {}, m_filters->rootState(), nullptr });
+
+    auto wakeIdle = [&] {
+        {
+            std::lock_guard<std::mutex> lock(idleMutex);
+            ++wakeups;
+        }
+        idle.notify_all();
+    };
+
+    auto worker = [&](unsigned id) {
+        WorkQueue& own = queues[id];
+
+        while (pending.load() > 0 && !failed.load()) {
+            const std::uint64_t seen = wakeups.load(); // anything pushed later wakes the wait below
+            WorkItem item;
+            bool found = false;
+
+            // Own work first (LIFO keeps the working set local)
+            {
+                std::lock_guard<std::mutex> lock(own.mutex);
+                if (!own.tasks.empty()) {
+                    item = std::move(own.tasks.back());
+                    own.tasks.pop_back();
+                    found = true;
+                }
+            }
+
+            // Steal the oldest (usually largest) subtree from another worker
+            for (unsigned k = 1; !found && k < m_threadCount; ++k) {
+                WorkQueue& victim = queues[(id + k) % m_threadCount];
+                std::lock_guard<std::mutex> lock(victim.mutex);
+                if (!victim.tasks.empty()) {
+                    item = std::move(victim.tasks.front());
+                    victim.tasks.pop_front();
+                    found = true;
+                }
+            }
+
+            if (!found) {
+                // Sleep until another worker pushes subdirectories or the walk ends
+                std::unique_lock<std::mutex> lock(idleMutex);
+                idle.wait(lock, [&] { return wakeups.load() != seen || pending.load() == 0 || failed.load(); });
+                continue;
+            }
+
+            try {
+                DirectoryListing listing;
+                std::vector<WorkItem> subdirs = scanDirectory(std::move(item), listing);
+
+                if (!subdirs.empty()) {
+                    pending += subdirs.size();
+                    {
+                        std::lock_guard<std::mutex> lock(own.mutex);
+                        for (auto it = subdirs.rbegin(); it != subdirs.rend(); ++it) {
+                            own.tasks.push_back(std::move(*it));
+                        }
+                    }
+                    wakeIdle();
+                }
+
+                std::lock_guard<std::mutex> lock(sinkMutex);
+                sink(listing);
+            }
+            catch (...) {
+                std::lock_guard<std::mutex> lock(errorMutex);
+                if (!error) error = std::current_exception();
+                failed = true;
+            }
+
+            if (--pending == 0 || failed.load()) {
+                wakeIdle();
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(m_threadCount);
+    for (unsigned i = 0; i < m_threadCount; ++i) {
+        threads.emplace_back(worker, i);
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+// Collects all listings and merges them deterministically (sorted by directory path,
+// which equals the depth-first order of a single-threaded walk)
+std::vector<DirectoryListing> DirectoryWalker::collect(const fs::path& root) const {
+    std::vector<DirectoryListing> listings;
+    walk(root, [&](DirectoryListing& listing) {
+        listings.push_back(std::move(listing));
+        });
+
+    std::sort(listings.begin(), listings.end(), [](const DirectoryListing& a, const DirectoryListing& b) {
+        return a.directory < b.directory;
+        });
+    return listings;
+}
@@ -0,0 +1,150 @@
+/*****************************************************************//**
+ * @file   DirectoryWalker.hpp
+ * @brief  Work-stealing parallel directory traversal for PruneCopy
+ *
+ * @author Patrik Neunteufel
+ * @date   May 2025
+ *********************************************************************/
+
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <functional>
+#include <memory>
+#include <filesystem>
+
+#include "util/FileStat.hpp"
+#include "util/FilterSet.hpp"
+#include "util/IgnoreStack.hpp"
+
+class ScanCache;
+
+/**
+ * @brief Result of scanning a single directory (one work item of the walker)
+ */
+struct DirectoryListing {
+	std::filesystem::path directory;                 // Directory that was scanned
+	std::filesystem::path relativeDir;               // Same directory relative to the walked root (empty for the root)
+	std::vector<std::filesystem::path> files;        // Regular files found directly in the directory (sorted)
+	std::vector<std::filesystem::path> skippedDirs;  // Subdirectories pruned by the exclude patterns (sorted)
+	std::vector<FileStat> stats;                     // Metadata parallel to files (only with setCollectStats(true))
+	std::vector<std::filesystem::path> others;       // Symlinked directories and entries that are neither files nor directories (only with setCollectStats(true))
+	FilterSet::PathState pathState;                  // Path pattern state of the directory (empty without path patterns)
+};
+
+/**
+ * @brief Walks a directory tree, optionally with several threads.
+ *
+ * Every subdirectory becomes a task on a per-thread deque. A worker pops from
+ * the back of its own deque and steals from the front of the others when idle;
+ * with nothing to steal it sleeps until new subdirectories are pushed.
+ * Excluded directories are pruned before they are ever enqueued, and so are
+ * directories below which no path pattern of --types or include rule can
+ * match any more. With setUseIgnoreFiles(true) the .gitignore and
+ * .prunecopyignore files are read on the way down; ignored directories are
+ * pruned and ignored files are left out of the listings.
+ * On Linux directories are read with DirectoryReader (getdents64 batches,
+ * entry types from d_type, no stat per entry unless stats are collected).
+ */
+class DirectoryWalker {
+public:
+	/**
+	 * @brief Constructs a walker with the given directory exclusion patterns.
+	 *
+	 * @param excludeDirs Directory name patterns to prune (glob wildcards supported)
+	 * @param threadCount Number of worker threads (0 = hardware concurrency, 1 = inline on the caller)
+	 */
+	explicit DirectoryWalker(const std::vector<std::string>& excludeDirs, unsigned threadCount = 1);
+
+	/**
+	 * @brief Constructs a walker that prunes with an already compiled filter set.
+	 *
+	 * @param filters Compiled filters (PruneOptions::filters), only the directory filters and rules are used
+	 * @param threadCount Number of worker threads (0 = hardware concurrency, 1 = inline on the caller)
+	 */
+	explicit DirectoryWalker(std::shared_ptr<const FilterSet> filters, unsigned threadCount = 1);
+
+	/**
+	 * @brief Walks the tree below root and hands every directory listing to the sink.
+	 * The sink is never called concurrently. With one thread the listings arrive in
+	 * depth-first order, otherwise in the order the workers finish them.
+	 *
+	 * @param root Root directory to scan
+	 * @param sink Callback receiving each directory listing
+	 */
+	void walk(const std::filesystem::path& root, const std::function<void(DirectoryListing&)>& sink) const;
+
+	/**
+	 * @brief Walks the tree below root and returns all listings in a deterministic order.
+	 *
+	 * @param root Root directory to scan
+	 * @return Directory listings sorted by directory path
+	 */
+	std::vector<DirectoryListing> collect(const std::filesystem::path& root) const;
+
+	/**
+	 * @brief Enables reading size and mtime of every file while scanning (in the workers).
+	 * @param collect Whether DirectoryListing::stats and DirectoryListing::others are filled
+	 */
+	void setCollectStats(bool collect) { m_collectStats = collect; }
+
+	/**
+	 * @brief Enables reading .gitignore / .prunecopyignore in every scanned directory.
+	 * @param use Whether ignored entries are left out (PruneOptions::useIgnoreFiles)
+	 */
+	void setUseIgnoreFiles(bool use) { m_useIgnoreFiles = use; }
+
+	/**
+	 * @brief Selects the native getdents64 reader (DirectoryReader, Linux) or std::filesystem::directory_iterator.
+	 * @param use Whether the native reader is used where supported (default: true)
+	 */
+	void setUseNativeReader(bool use) { m_useNativeReader = use; }
+
+	/**
+	 * @brief Serves unchanged directories from a persistent scan cache and records the others (--scan-cache).
+	 * @param cache The cache of the walked root (must outlive the walk), nullptr to read every directory
+	 */
+	void setScanCache(ScanCache* cache) { m_scanCache = cache; }
+
+	/**
+	 * @brief Returns the number of worker threads used by this walker.
+	 */
+	unsigned threadCount() const { return m_threadCount; }
+
+private:
+	/**
+	 * @brief A directory still to be scanned, with its path pattern state
+	 */
+	struct WorkItem {
+		std::filesystem::path dir;
+		std::filesystem::path relativeDir; ///< dir relative to the root, extended by one component per level
+		FilterSet::PathState pathState;
+		std::shared_ptr<const IgnoreStack> parentIgnore; ///< Ignore files of the parent (nullptr for the root)
+	};
+
+	/**
+	 * @brief Per-thread task deque (owner works at the back, thieves at the front)
+	 */
+	struct WorkQueue {
+		std::mutex mutex;
+		std::deque<WorkItem> tasks;
+	};
+
+	/**
+	 * @brief Lists one directory and returns its subdirectories that still have to be visited.
+	 *
+	 * @param item The directory to scan and its path pattern state
+	 * @param listing Receives files and pruned directories
+	 * @return Subdirectories to enqueue, sorted
+	 */
+	std::vector<WorkItem> scanDirectory(WorkItem item, DirectoryListing& listing) const;
+
+	std::shared_ptr<const FilterSet> m_filters; ///< Compiled directory filters and rules (shared, read-only)
+	unsigned m_threadCount;                     ///< Number of worker threads
+	bool m_collectStats = false;                ///< Fill DirectoryListing::stats
+	bool m_useIgnoreFiles = false;              ///< Read ignore files while descending
+	bool m_useNativeReader = true;              ///< Read directories with DirectoryReader where supported
+	ScanCache* m_scanCache = nullptr;           ///< Optional scan cache (not owned)
+};
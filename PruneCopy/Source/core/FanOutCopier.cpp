@@ -0,0 +1,159 @@
+/*****************************************************************//**
+ * @file   FanOutCopier.cpp
+ * @brief  Implements the read-once, write-many copy
+ *
+ * @author Patrik Neunteufel
+ * @date   May 2025
+ *********************************************************************/
+
+#include "core/FanOutCopier.hpp"
+
+#include <exception>
+#include <fstream>
+#include <memory>
+#include <system_error>
+#include <thread>
+
+#include "core/TaskQueue.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+    using Chunk = std::shared_ptr<const std::vector<char>>;
+
+    // One target with its own queue and writer thread
+    struct Writer {
+        fs::path target;
+        std::ofstream out;
+        TaskQueue<Chunk> queue{ FanOutCopier::QueueChunks };
+        bool failed = false;     // only touched by the writer thread until it was joined
+        bool sameFile = false;   // the target is the source itself (never opened)
+        std::thread thread;
+
+        // Lets the writer thread drain its queue and waits for it (a joinable thread must never be destroyed)
+        void finish() {
+            queue.close();
+            if (thread.joinable()) thread.join();
+        }
+
+        ~Writer() {
+            finish();
+        }
+    };
+
+    fs::filesystem_error writeError(const fs::path& source, const Writer& writer) {
+        if (writer.sameFile) {
+            return fs::filesystem_error("source and target are the same file", source, writer.target,
+                std::make_error_code(std::errc::file_exists));
+        }
+        return fs::filesystem_error("fan-out write failed", source, writer.target, std::make_error_code(std::errc::io_error));
+    }
+
+}
+
+// Reads each chunk once; small files are written inline, large files through per-target writer threads
+void FanOutCopier::copy(const fs::path& source, const std::vector<fs::path>& targets) {
+    std::ifstream in(source, std::ios::binary);
+    if (!in) {
+        throw fs::filesystem_error("cannot open source", source, std::make_error_code(std::errc::no_such_file_or_directory));
+    }
+    const std::uintmax_t size = fs::file_size(source);
+    const fs::perms permissions = fs::status(source).permissions();
+
+    std::vector<std::unique_ptr<Writer>> writers;
+    for (const auto& target : targets) {
+        auto writer = std::make_unique<Writer>();
+        writer->target = target;
+        // Never truncate the source by writing it onto itself (same check as CopyEngine)
+        std::error_code ec;
+        writer->sameFile = fs::equivalent(source, target, ec);
+        if (!writer->sameFile) {
+            writer->out.open(target, std::ios::binary | std::ios::trunc);
+        }
+        writer->failed = writer->sameFile || !writer->out; // the other targets are still written
+        writers.push_back(std::move(writer));
+    }
+
+    if (size <= ChunkSize) {
+        // One read, no threads: not worth a hand-off for small files
+        std::vector<char> buffer(static_cast<size_t>(size));
+        in.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        const std::streamsize count = in.gcount();
+        if (in.bad()) {
+            throw fs::filesystem_error("read failed", source, std::make_error_code(std::errc::io_error));
+        }
+        for (auto& writer : writers) {
+            if (writer->failed) continue;
+            writer->out.write(buffer.data(), count);
+            writer->out.close();
+            writer->failed = !writer->out;
+        }
+    }
+    else {
+        bool readFailed = false;
+        std::exception_ptr error; // rethrown once every writer thread was joined
+        try {
+            for (auto& writer : writers) {
+                Writer* w = writer.get();
+                w->thread = std::thread([w] {
+                    Chunk chunk;
+                    while (w->queue.pop(chunk)) {
+                        if (w->failed) continue; // keep draining so the reader never blocks on us
+                        w->out.write(chunk->data(), static_cast<std::streamsize>(chunk->size()));
+                        w->failed = !w->out;
+                    }
+                    if (!w->failed) {
+                        w->out.close();
+                        w->failed = !w->out;
+                    }
+                    });
+            }
+
+            while (in) {
+                auto buffer = std::make_shared<std::vector<char>>(ChunkSize);
+                in.read(buffer->data(), static_cast<std::streamsize>(buffer->size()));
+                const std::streamsize count = in.gcount();
+                if (in.bad()) {
+                    readFailed = true;
+                    break;
+                }
+                if (count <= 0) break;
+                buffer->resize(static_cast<size_t>(count));
+
+                const Chunk chunk = std::move(buffer);
+                for (auto& writer : writers) {
+                    writer->queue.push(chunk); // blocks only while this target's queue is full
+                }
+            }
+        }
+        catch (...) {
+            error = std::current_exception();
+        }
+
+        for (auto& writer : writers) {
+            writer->finish();
+        }
+
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        if (readFailed) {
+            throw fs::filesystem_error("read failed", source, std::make_error_code(std::errc::io_error));
+        }
+    }
+
+    // Permissions for all targets that were written, then report the first failure
+    const Writer* failed = nullptr;
+    for (const auto& writer : writers) {
+        if (writer->failed) {
+            if (!failed) failed = writer.get();
+            continue;
+        }
+        std::error_code ec;
+        fs::permissions(writer->target, permissions, ec);
+    }
+    if (failed) {
+        throw writeError(source, *failed);
+    }
+}
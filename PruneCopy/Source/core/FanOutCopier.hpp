@@ -0,0 +1,38 @@
+/*****************************************************************//**
+ * @file   FanOutCopier.hpp
+ * @brief  Reads a source file once and writes it to several targets
+ *
+ * @author Patrik Neunteufel
+ * @date   May 2025
+ *********************************************************************/
+
+#pragma once
+#include <vector>
+#include <filesystem>
+
+/**
+ * @brief Read-once, write-many copy for multiple destinations.
+ *
+ * Small files are read into one buffer and written to every target in turn.
+ * Larger files are read in chunks that are shared by per-target writer
+ * threads; every target has its own bounded queue, so a slow target only
+ * holds back the reader once its queue is full while the others keep writing.
+ */
+class FanOutCopier {
+public:
+	/**
+	 * @brief Copies source to all targets (existing targets are overwritten).
+	 *
+	 * Every target receives the source permissions. All targets are written
+	 * even if one of them fails; the first error is thrown afterwards. A
+	 * target that is the source itself is never opened and counts as failed.
+	 *
+	 * @param source Source file
+	 * @param targets Target files (parent directories must exist)
+	 * @throws std::filesystem::filesystem_error on failure
+	 */
+	static void copy(const std::filesystem::path& source, const std::vector<std::filesystem::path>& targets);
+
+	static constexpr size_t ChunkSize = 1024 * 1024; ///< Bytes per read
+	static constexpr size_t QueueChunks = 16;        ///< Chunks a target may fall behind the reader
+};
@@ -13,7 +13,31 @@
 #include <filesystem>
 #include <string>
 #include <algorithm>
-
+#include <atomic>
+#include <exception>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "core/CopyEngine.hpp"
+#include "core/DestinationIndex.hpp"
+#include "core/DirectoryCache.hpp"
+#include "core/DirectoryWalker.hpp"
+#include "core/FanOutCopier.hpp"
+#include "core/FileList.hpp"
+#include "core/GitIndex.hpp"
+#include "core/PromptBroker.hpp"
+#include "core/ScanCache.hpp"
+#include "core/TaskPlanner.hpp"
+#include "core/TaskQueue.hpp"
+#include "core/UringCopier.hpp"
 #include "util/PatternUtils.hpp"
 #include "log/LogManager.hpp"
 
@@ -22,221 +46,555 @@ namespace fs = std::filesystem;
 // Constructor
 // Initializes the FileCopier with given options and optional log file
 FileCopier::FileCopier(const PruneOptions& options, std::ofstream* logFile)
-    : m_options(options), m_logFile(logFile) {
+    : m_options(options), m_logFile(logFile), m_engine(options.copyEngine, options.reflink) {
+    // Options assembled in code (not by ArgumentParser/PresetLoader) may only carry the raw patterns
+    if (!m_options.filters) {
+        m_options.filters = std::make_shared<const FilterSet>(m_options.types, m_options.excludeFiles, m_options.excludeDirs,
+            m_options.rulesFile.empty() ? std::vector<Rule>{} : RuleSet::load(m_options.rulesFile));
+    }
+    if (m_options.fdRelative && !m_options.dryRun) {
+        if (DirectoryHandles::supported()) {
+            m_handles = std::make_unique<DirectoryHandles>();
+        }
+        else {
+            LogManager::log(LogLevel::Warning, "--fd-relative is only supported on Linux, copying by path.");
+        }
+    }
 }
 
 // Main execution method
-// Iterates through sources and applies filtering, copying and logging logic
+// Dispatches to the execution strategy of the selected parallel mode and logs a summary
 void FileCopier::execute() {
-    for (const auto& src : m_options.sources) {
-        for (auto it = fs::recursive_directory_iterator(src); it != fs::recursive_directory_iterator(); ++it) {
-            const auto& entry = *it;
+    TaskPlanner planner(m_options, m_logFile);
+
+    // Optional pre-pass: existence checks are answered from memory afterwards
+    DestinationIndex index;
+    if (m_options.indexDestinations) {
+        index.build(m_options.destinations, m_options.threadCount);
+        planner.setDestinationIndex(&index);
+        LogManager::log(LogLevel::Info, "Indexed " + std::to_string(index.size()) + " file(s) in the destination(s)");
+    }
 
-            // Skip excluded directories
-            if (entry.is_directory() && PatternUtils::isExcludedDir(entry.path(), m_options.excludeDirs)) {
-                LogManager::log(LogType::Skipped, entry.path().string(), m_logFile);
-                it.disable_recursion_pending();
-                continue;
-            }
+    switch (m_options.parallelMode) {
+    case ParallelMode::Thread:
+        executeThreaded(planner);
+        break;
+    case ParallelMode::Async:
+        executeAsync(planner);
+        break;
+    case ParallelMode::OpenMP:
+        executeOpenMP(planner);
+        break;
+    case ParallelMode::None:
+    default:
+        executeSerial(planner);
+        break;
+    }
+    copyRepeated();
 
-            // Only process regular files
-            if (!entry.is_regular_file()) continue;
+    LogManager::log(LogLevel::Info, std::string(m_options.dryRun ? "Would copy " : "Copied ") +
+        std::to_string(m_copiedFiles.load()) + " file(s), " + std::to_string(m_copiedBytes.load()) + " bytes");
+    if (!m_options.dryRun) {
+        LogManager::log(LogLevel::Info, "Copy methods: " + m_copyStats.toString());
+    }
+}
 
-            const std::string filename = entry.path().filename().string();
+// Serial mode: each directory is planned and copied as soon as it was listed
+// With io_uring the tasks of several directories are collected into one batch
+void FileCopier::executeSerial(TaskPlanner& planner) {
+    std::unique_ptr<UringCopier> ring = makeRing();
+    const size_t batch = batchSize(ring.get());
+    std::vector<FileTask> tasks;
 
-            // Filter by allowed file types
-            if (!m_options.typePatterns.empty() &&
-                !PatternUtils::matchesPattern(filename, m_options.typePatterns)) {
-                continue;
+    for (const auto& src : m_options.sources) {
+        walkSource(src, 1, [&](DirectoryListing& listing) {
+            planListing(planner, listing, tasks);
+            if (tasks.size() >= batch) {
+                copyBatch(tasks, ring.get());
+                tasks.clear();
             }
+            });
+    }
+    copyBatch(tasks, ring.get());
+}
 
-            // Filter excluded files
-            if (!m_options.excludeFilePatterns.empty() &&
-                PatternUtils::matchesPattern(filename, m_options.excludeFilePatterns)) {
-                LogManager::log(LogType::Skipped, entry.path().string(), m_logFile);
-                continue;
+// Threaded mode: three overlapping stages connected by bounded queues
+//   scanner thread (parallel DirectoryWalker) -> planner (calling thread, owns the console) -> copy workers
+void FileCopier::executeThreaded(TaskPlanner& planner) {
+    const unsigned threadCount = m_options.threadCount == 0
+        ? std::max(1u, std::thread::hardware_concurrency())
+        : m_options.threadCount;
+
+    TaskQueue<DirectoryListing> listings(256);
+    TaskQueue<FileTask> tasks(threadCount * 64);
+
+    std::atomic<bool> failed{ false };
+    std::exception_ptr error;
+    std::mutex errorMutex;
+    auto fail = [&](std::exception_ptr e) {
+        std::lock_guard<std::mutex> lock(errorMutex);
+        if (!error) error = e;
+        failed = true;
+        listings.close();
+        tasks.close();
+    };
+
+    // Stage 1: scan all sources in parallel
+    std::thread scanner([&] {
+        try {
+            for (const auto& src : m_options.sources) {
+                walkSource(src, threadCount, [&](DirectoryListing& listing) {
+                    if (!listings.push(std::move(listing))) {
+                        throw std::runtime_error("Scan aborted");
+                    }
+                    });
+            }
+        }
+        catch (...) {
+            if (!failed) fail(std::current_exception());
+        }
+        listings.close();
+        });
+
+    // Stage 3: copy workers drain the task queue
+    std::vector<std::thread> workers;
+    workers.reserve(threadCount);
+    for (unsigned i = 0; i < threadCount; ++i) {
+        workers.emplace_back([&] {
+            try {
+                std::unique_ptr<UringCopier> ring = makeRing();
+                std::vector<FileTask> batch;
+                while (!failed && tasks.popBatch(batch, batchSize(ring.get()))) {
+                    copyBatch(batch, ring.get());
+                }
             }
+            catch (...) {
+                fail(std::current_exception());
+            }
+            });
+    }
 
-            // Copy file to all destinations
-            for (const auto& dst : m_options.destinations) {
-                fs::path targetFile = resolveTargetPath(src, entry.path(), dst);
+    // Stage 2: filter and plan on this thread, so prompts never run concurrently
+    try {
+        DirectoryListing listing;
+        std::vector<FileTask> planned;
+        while (!failed && listings.pop(listing)) {
+            planned.clear();
+            planListing(planner, listing, planned);
+            for (auto& task : planned) {
+                if (!tasks.push(std::move(task))) break;
+            }
+        }
+    }
+    catch (...) {
+        fail(std::current_exception());
+    }
+    tasks.close();
 
-                // File exists → resolve based on overwrite flags
-                if (fs::exists(targetFile)) {
-                    if (m_options.noOverwrite) {
-                        continue; // skip silently without any prompt
-                    }
-                    else if (m_options.forceOverwrite) {
-                        // Do nothing: overwrite directly
-                    }
-                    else if (m_options.flatten) {
-                        if (!handleFlattenConflictPrompt(targetFile)) {
-                            continue; // user skipped or canceled
-                        }
+    scanner.join();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+// Async mode: copy workers are std::async tasks; conflicting tasks are handed to the
+// PromptBroker, which asks the user while all other copies keep running
+void FileCopier::executeAsync(TaskPlanner& planner) {
+    const unsigned threadCount = m_options.threadCount == 0
+        ? std::max(1u, std::thread::hardware_concurrency())
+        : m_options.threadCount;
+
+    TaskQueue<FileTask> tasks(threadCount * 64);
+
+    planner.setDeferConflicts(true);
+    PromptBroker broker(planner, m_options.flatten, m_logFile, [&](FileTask&& task) {
+        tasks.push(std::move(task));
+        });
+
+    std::vector<std::future<void>> workers;
+    workers.reserve(threadCount);
+    for (unsigned i = 0; i < threadCount; ++i) {
+        workers.push_back(std::async(std::launch::async, [&] {
+            try {
+                std::unique_ptr<UringCopier> ring = makeRing();
+                std::vector<FileTask> batch;
+                while (tasks.popBatch(batch, batchSize(ring.get()))) {
+                    copyBatch(batch, ring.get());
+                }
+            }
+            catch (...) {
+                tasks.close(); // unblock the producers, the error surfaces through get()
+                broker.stop(); // no point in asking about files that won't be copied
+                throw;
+            }
+            }));
+    }
+
+    std::exception_ptr scanError;
+    try {
+        std::vector<FileTask> planned;
+        for (const auto& src : m_options.sources) {
+            walkSource(src, threadCount, [&](DirectoryListing& listing) {
+                planned.clear();
+                planListing(planner, listing, planned);
+                for (auto& task : planned) {
+                    if (task.action == TaskAction::Conflict) {
+                        broker.post(std::move(task));
                     }
-                    else {
-                        // Normal mode → prompt via classic handler
-                        if (!handleOverwritePrompt(targetFile)) continue;
+                    else if (!tasks.push(std::move(task))) {
+                        throw std::runtime_error("Copy aborted");
                     }
                 }
+                });
+        }
+    }
+    catch (...) {
+        scanError = std::current_exception();
+        broker.stop();
+    }
 
-                // Perform copy unless dry-run is active
-                if (!m_options.dryRun) {
-                    fs::create_directories(targetFile.parent_path());
-                    fs::copy_file(entry.path(), targetFile, fs::copy_options::overwrite_existing);
-                }
+    // Let the user answer the remaining conflicts, then drain the copy queue
+    std::exception_ptr promptError;
+    try {
+        broker.finish();
+    }
+    catch (...) {
+        promptError = std::current_exception();
+    }
+    tasks.close();
 
-                // Log successful copy
-                LogManager::log(LogType::Copied, targetFile.string(), m_logFile);
-            }
+    std::exception_ptr copyError;
+    for (auto& worker : workers) {
+        try {
+            worker.get();
+        }
+        catch (...) {
+            if (!copyError) copyError = std::current_exception();
         }
     }
+
+    if (copyError) std::rethrow_exception(copyError);
+    if (scanError) std::rethrow_exception(scanError);
+    if (promptError) std::rethrow_exception(promptError);
 }
 
-// Resolves the destination path for a file, considering flatten options
-fs::path FileCopier::resolveTargetPath(const fs::path& srcRoot, const fs::path& currentFile, const fs::path& destRoot) const {
-    fs::path relPath = fs::relative(currentFile, srcRoot);
+// OpenMP mode: a planning pass collects all FileTasks, then an OpenMP loop copies them
+// Without OpenMP support at compile time the planned tasks are copied serially
+void FileCopier::executeOpenMP(TaskPlanner& planner) {
+    std::vector<FileTask> tasks;
+
+    // Planning pass (parallel scan, deterministic order, prompts on this thread)
+    for (const auto& src : m_options.sources) {
+        for (const auto& listing : collectSource(src, m_options.threadCount)) {
+            planListing(planner, listing, tasks);
+        }
+    }
 
-    // Flatten mode discards folder structure
-    if (m_options.flatten) {
-        std::string filename = currentFile.filename().string();
+    // Skeleton pass: every target directory exists before the copy loop starts
+    if (!m_options.dryRun) {
+        createSkeleton(tasks);
+    }
 
-        // Add flattened suffix from folder structure
-        if (m_options.flattenWithSuffix) {
-            std::string prefix;
-            if (!relPath.parent_path().empty()) {
-                prefix = relPath.parent_path().string();
-                std::replace(prefix.begin(), prefix.end(), '\\', '_');
-                std::replace(prefix.begin(), prefix.end(), '/', '_');
-                filename = prefix + "_" + filename;
+#ifdef _OPENMP
+    const int threadCount = m_options.threadCount == 0
+        ? omp_get_max_threads() // honours OMP_NUM_THREADS
+        : static_cast<int>(m_options.threadCount);
+    std::atomic<bool> failed{ false };
+    std::exception_ptr error;
+
+    // Each thread owns its ring (if any) and takes chunks of tasks dynamically
+#pragma omp parallel num_threads(threadCount)
+    {
+        std::unique_ptr<UringCopier> ring;
+        try {
+            ring = makeRing();
+        }
+        catch (...) {
+            failed = true;
+        }
+        const size_t chunk = ring ? batchSize(ring.get()) : 8;
+        const long long chunks = static_cast<long long>((tasks.size() + chunk - 1) / chunk);
+
+#pragma omp for schedule(dynamic, 1)
+        for (long long c = 0; c < chunks; ++c) {
+            if (failed) continue; // exceptions must not leave the parallel region
+            try {
+                const size_t first = static_cast<size_t>(c) * chunk;
+                const size_t count = std::min(chunk, tasks.size() - first);
+                copyBatch(std::span<const FileTask>(tasks).subspan(first, count), ring.get());
+            }
+            catch (...) {
+#pragma omp critical(prunecopy_error)
+                {
+                    if (!error) error = std::current_exception();
+                }
+                failed = true;
             }
         }
-
-        return destRoot / filename;
     }
 
-    // Normal mode: preserve relative path under destination
-    return destRoot / relPath;
+    if (error) {
+        std::rethrow_exception(error);
+    }
+#else
+    LogManager::log(LogLevel::Warning, "PruneCopy was built without OpenMP support, copying serially.");
+    std::unique_ptr<UringCopier> ring = makeRing();
+    copyBatch(tasks, ring.get());
+#endif
 }
 
-// Prompts the user to confirm file overwrite unless forced globally
-bool FileCopier::handleOverwritePrompt(const fs::path& targetFile) {
-    while (true) {
-		std::string msg = targetFile.string() + " already exists. [y]es / [n]o / [a]ll / [s]kip all / [c]ancel:";
-        LogManager::logAlwaysToConsole(LogType::Conflict, msg);
-        LogManager::log(LogType::Conflict, msg, m_logFile); 
-        std::string input;
-        std::getline(std::cin, input);
-        LogManager::log(LogType::UserInput, "User entered: " + input, m_logFile);
-
-        if (input.empty()) continue;
+// Plans a listing; with several destinations the consecutive tasks of one source
+// (one per destination) become a single task whose mirrors are written from the same read
+// Not merged: conflicts (still undecided), an explicit --copy-engine (kernel, rw, uring), directories
+// the copy engine may clone into a destination (a clone reads nothing) and repeated writes
+// to a target (copied after all others)
+void FileCopier::planListing(TaskPlanner& planner, const DirectoryListing& listing, std::vector<FileTask>& tasks) {
+    const size_t first = tasks.size();
+    planner.planListing(listing, tasks);
+
+    if (m_options.destinations.size() < 2 || tasks.size() - first < 2 ||
+        m_options.copyEngine != CopyEngineMode::Auto || m_options.reflink == ReflinkMode::Always ||
+        std::any_of(m_options.destinations.begin(), m_options.destinations.end(),
+            [&](const fs::path& dst) { return m_engine.mayClone(listing.directory, dst); })) {
+        return;
+    }
 
-        char answer = std::tolower(input[0]);
+    size_t kept = first;
+    for (size_t i = first; i < tasks.size(); ++i) {
+        FileTask& task = tasks[i];
+        if (kept > first && task.action != TaskAction::Conflict) {
+            FileTask& previous = tasks[kept - 1];
+            if (previous.action != TaskAction::Conflict && previous.source == task.source &&
+                previous.generation == 0 && task.generation == 0) {
+                previous.mirrors.push_back(std::move(task.target));
+                continue;
+            }
+        }
+        if (kept != i) tasks[kept] = std::move(task);
+        ++kept;
+    }
+    tasks.resize(kept);
+}
 
-        switch (answer) {
-        case 'y': return true;
-        case 'n': return false;
-        case 'a':
-            m_options.forceOverwrite = true;
-            return true;
-        case 's':
-            m_options.noOverwrite = true;
-            return false;
-        case 'c':
-            LogManager::log(LogType::Aborted, "Operation cancelled by user.", m_logFile);
-            exit(0);
-        default:
-            continue;
+// Executes a single planned task (never prompts, safe to call from worker threads)
+void FileCopier::copyTask(const FileTask& task) {
+    // Perform copy unless dry-run is active
+    if (!m_options.dryRun) {
+        if (task.mirrors.empty() && m_handles) {
+            // --fd-relative: the kernel only resolves the filenames, the directories come from the handle cache
+            const auto sourceDir = m_handles->open(task.source.parent_path());
+            const auto targetDir = m_handles->open(task.target.parent_path(), true);
+            m_copyStats.add(m_engine.copyFileAt(sourceDir->fd(), task.source, targetDir->fd(), task.target));
+        }
+        else if (task.mirrors.empty()) {
+            m_directories.ensure(task.target.parent_path());
+            m_copyStats.add(m_engine.copyFile(task.source, task.target));
+        }
+        else {
+            m_directories.ensure(task.target.parent_path());
+            std::vector<fs::path> targets{ task.target };
+            for (const auto& mirror : task.mirrors) {
+                m_directories.ensure(mirror.parent_path());
+                targets.push_back(mirror);
+            }
+            FanOutCopier::copy(task.source, targets);
+            for (size_t i = 0; i < targets.size(); ++i) {
+                m_copyStats.add(CopyMethod::FanOut);
+            }
         }
     }
+
+    m_copiedFiles += 1 + task.mirrors.size();
+    m_copiedBytes += task.size * (1 + task.mirrors.size());
+
+    // Log successful copy
+    logCopy(task.target);
+    for (const auto& mirror : task.mirrors) {
+        logCopy(mirror);
+    }
 }
 
-// Prompts user for flatten conflict resolution with suggested name and extended options
-bool FileCopier::handleFlattenConflictPrompt(std::filesystem::path& targetFile) {
-    const fs::path suggested = resolveFileNameConflict(targetFile);
+// Executes a batch: one io_uring pass if a ring is given, otherwise task by task
+void FileCopier::copyBatch(std::span<const FileTask> tasks, UringCopier* ring) {
+    // Repeated writes wait until the first write of their target is done, so no two workers write a file at once
+    if (std::any_of(tasks.begin(), tasks.end(), [](const FileTask& task) { return task.generation != 0; })) {
+        std::vector<FileTask> first;
+        {
+            std::lock_guard<std::mutex> lock(m_repeatedMutex);
+            for (const auto& task : tasks) {
+                (task.generation != 0 ? m_repeated : first).push_back(task);
+            }
+        }
+        copyBatch(first, ring);
+        return;
+    }
 
-    // Auto-rename mode: no interaction
-    if (m_options.flattenAutoRename) {
-        targetFile = suggested;
-        return true;
+    if (!ring || m_options.dryRun) {
+        for (const auto& task : tasks) {
+            copyTask(task);
+        }
+        return;
     }
 
-    while (true) {
-        std::string msg = targetFile.string() +
-            " already exists. [o]verwrite / [r]ename / [s]kip / [c]ancel / [a]lways overwrite / [m] Auto-rename all\n" +
-            "Suggested rename: " + suggested.filename().string();
+    // Target directories must exist before the ring opens the targets
+    fs::path lastParent;
+    for (const auto& task : tasks) {
+        if (task.target.parent_path() != lastParent) {
+            lastParent = task.target.parent_path();
+            m_directories.ensure(lastParent);
+        }
+    }
 
-        LogManager::logAlwaysToConsole(LogType::Conflict, msg);
-        LogManager::log(LogType::Conflict, msg, m_logFile); 
-        std::string input;
-        std::getline(std::cin, input);
-        LogManager::log(LogType::UserInput, "User entered: " + input, m_logFile);
+    ring->copy(tasks, [&](const FileTask& task) {
+        ++m_copiedFiles;
+        m_copiedBytes += task.size;
+        m_copyStats.add(CopyMethod::IoUring);
+        logCopy(task.target);
+        });
+}
 
-        if (input.empty()) continue;
-        char choice = std::tolower(input[0]);
+// Runs on the calling thread after every worker finished; only the last write of a target is copied,
+// since it replaces the earlier ones anyway
+void FileCopier::copyRepeated() {
+    std::sort(m_repeated.begin(), m_repeated.end(),
+        [](const FileTask& a, const FileTask& b) { return a.generation < b.generation; });
+    std::unordered_map<std::string, std::uint64_t> last;
+    for (const auto& task : m_repeated) {
+        last[task.target.string()] = task.generation;
+    }
+    for (const auto& task : m_repeated) {
+        if (last[task.target.string()] != task.generation) {
+            LogManager::log(LogType::Skipped, task.target.string() + " (replaced by a later file)", m_logFile);
+            continue;
+        }
+        copyTask(task);
+    }
+    m_repeated.clear();
+}
 
-        switch (choice) {
-        case 'o':
-            return true; // Overwrite
-        case 'r': {
-            LogManager::logAlwaysToConsole(LogType::Conflict, "Enter new filename (leave blank to use suggested):");
-            std::string newName;
-            std::getline(std::cin, newName);
-            if (!newName.empty()) {
-                fs::path candidate = targetFile.parent_path() / newName;
-                // Recursively check if new name also exists
-                while (fs::exists(candidate)) {
-                    LogManager::logAlwaysToConsole(LogType::Conflict, candidate.string() + " also exists. Enter different name:");
-                    std::getline(std::cin, newName);
-                    if (newName.empty()) break; // fallback to suggestion
-                    candidate = targetFile.parent_path() / newName;
-                }
-                targetFile = candidate;
-            }
-            else {
-                targetFile = suggested;
-            }
-            return true;
+// Collects the distinct target directories of a planned task list and creates them in parallel
+void FileCopier::createSkeleton(std::span<const FileTask> tasks) {
+    std::vector<fs::path> dirs;
+    fs::path lastParent;
+    for (const auto& task : tasks) {
+        if (task.target.parent_path() != lastParent) {
+            lastParent = task.target.parent_path();
+            dirs.push_back(lastParent);
         }
-        case 's':
-            return false; // Skip file
-        case 'c':
-            LogManager::log(LogType::Aborted, "Operation cancelled by user.", m_logFile);
-            exit(0);
-        case 'a':
-            m_options.forceOverwrite = true;
-            return true;
-        case 'm':
-            m_options.flattenAutoRename = true;
-            targetFile = suggested;
-            return true;
-        default:
-            continue; // Repeat on invalid input
+        for (const auto& mirror : task.mirrors) {
+            dirs.push_back(mirror.parent_path());
         }
     }
+    m_directories.ensureAll(std::move(dirs), m_options.threadCount);
+}
+
+// Creates the calling thread's ring for --copy-engine uring
+// Falls back to the copy engine (with a single warning) if io_uring can't be used
+std::unique_ptr<UringCopier> FileCopier::makeRing() {
+    if (m_options.copyEngine != CopyEngineMode::IoUring || m_options.dryRun) {
+        return nullptr;
+    }
+
+    auto ring = std::make_unique<UringCopier>(m_options.ioDepth);
+    if (ring->ready()) {
+        return ring;
+    }
+
+    if (!m_uringWarned.exchange(true)) {
+        LogManager::log(LogLevel::Warning, "io_uring is not available (kernel or build), using the default copy engine.");
+    }
+    return nullptr;
 }
 
+// A batch keeps the ring busy for a while without starving the other workers
+size_t FileCopier::batchSize(const UringCopier* ring) const {
+    return ring ? std::max<size_t>(1, m_options.ioDepth) * 4 : 1;
+}
 
+// Source walkers share the compiled filters; ignore files only apply to sources, never to destinations
+DirectoryWalker FileCopier::makeWalker(unsigned threadCount) const {
+    DirectoryWalker walker(m_options.filters, threadCount);
+    walker.setUseIgnoreFiles(m_options.useIgnoreFiles);
+    return walker;
+}
 
-// Logs a successful copy operation to log file and/or console
-void FileCopier::logCopy(const fs::path& path) {
-    LogManager::log(LogType::Copied, path.string(), m_logFile);
+// Opens the git index of a source for --source-list git
+// Falls back to a directory walk (with a warning) if the source isn't a usable checkout
+std::optional<GitIndex> FileCopier::openGitIndex(const fs::path& src) const {
+    if (m_options.sourceList != SourceListMode::Git) {
+        return std::nullopt;
+    }
+    try {
+        return GitIndex(src);
+    }
+    catch (const std::exception& e) {
+        LogManager::log(LogLevel::Warning, std::string(e.what()) + ", scanning " + src.string() + " instead.");
+        return std::nullopt;
+    }
+}
+
+// Loads the scan cache of a source for --scan-cache (a missing or damaged cache starts empty)
+std::unique_ptr<ScanCache> FileCopier::openScanCache(const fs::path& src) const {
+    if (m_options.scanCacheDir.empty()) {
+        return nullptr;
+    }
+    return std::make_unique<ScanCache>(m_options.scanCacheDir, src);
 }
 
-// Resolves name conflict by appending (1), (2), ... to filename until free
-fs::path FileCopier::resolveFileNameConflict(const fs::path& originalPath) const {
-    fs::path base = originalPath.parent_path();
-    std::string stem = originalPath.stem().string();
-    std::string ext = originalPath.extension().string();
+// The copy already succeeded, so a cache that can't be written only costs a full scan next time
+void FileCopier::saveScanCache(const ScanCache* cache) const {
+    if (!cache) {
+        return;
+    }
+    try {
+        cache->save();
+        LogManager::log(LogLevel::Info, "Scan cache: " + std::to_string(cache->hits()) + " directories unchanged, " +
+            std::to_string(cache->misses()) + " read");
+    }
+    catch (const std::exception& e) {
+        LogManager::log(LogLevel::Warning, std::string("Scan cache not saved: ") + e.what());
+    }
+}
 
-    int counter = 1;
-    fs::path newPath;
-    do {
-        newPath = base / fs::path(stem + "(" + std::to_string(counter) + ")" + ext);
-        ++counter;
-    } while (fs::exists(newPath));
+// Enumerates one source from the file list, the git index or with the directory walker
+void FileCopier::walkSource(const fs::path& src, unsigned threadCount, const std::function<void(DirectoryListing&)>& sink) const {
+    if (!m_options.filesFrom.empty()) {
+        FileList(m_options.filesFrom).walk(src, *m_options.filters, sink, m_logFile);
+        return;
+    }
+    if (std::optional<GitIndex> index = openGitIndex(src)) {
+        index->walk(*m_options.filters, sink, m_logFile);
+        return;
+    }
+    const std::unique_ptr<ScanCache> cache = openScanCache(src);
+    DirectoryWalker walker = makeWalker(threadCount);
+    walker.setScanCache(cache.get());
+    walker.walk(src, sink);
+    saveScanCache(cache.get());
+}
+
+// Same as walkSource, but returns all listings in a deterministic order
+std::vector<DirectoryListing> FileCopier::collectSource(const fs::path& src, unsigned threadCount) const {
+    if (m_options.filesFrom.empty() && m_options.sourceList == SourceListMode::Walk) {
+        const std::unique_ptr<ScanCache> cache = openScanCache(src);
+        DirectoryWalker walker = makeWalker(threadCount);
+        walker.setScanCache(cache.get());
+        std::vector<DirectoryListing> listings = walker.collect(src);
+        saveScanCache(cache.get());
+        return listings;
+    }
+    std::vector<DirectoryListing> listings;
+    walkSource(src, threadCount, [&](DirectoryListing& listing) { listings.push_back(std::move(listing)); });
+    return listings;
+}
 
-    return newPath;
+// Logs a successful copy operation to log file and/or console
+void FileCopier::logCopy(const fs::path& path) {
+    LogManager::log(LogType::Copied, path.string(), m_logFile);
 }
 
 // Wrapper for directory exclusion check
@@ -11,8 +11,25 @@
 #include <vector>
 #include <filesystem>
 #include <fstream>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
 
 #include "core/PruneOptions.hpp"
+#include "core/CopyEngine.hpp"
+#include "core/DirectoryCache.hpp"
+#include "core/DirectoryHandles.hpp"
+#include "core/FileTask.hpp"
+#include "core/DirectoryWalker.hpp"
+#include "core/GitIndex.hpp"
+#include "core/ScanCache.hpp"
+
+class TaskPlanner;
+class UringCopier;
 
  /**
   * @brief Class responsible for copying files based on specified options and filters.
@@ -50,50 +67,155 @@ public:
 	 */
 	static bool isExcludedDir(const std::filesystem::path& dir, const std::vector<std::string>& excludeDirs);
 
+	/**
+	 * @brief Files per copy method of the last execute()
+	 */
+	const CopyStats& copyStats() const { return m_copyStats; }
+
 protected:
 	/**
-	 * @brief Resolves the final destination path for a given file, based on options and mode
+	 * @brief Walks and copies all sources on the calling thread, directory by directory
 	 *
-	 * @param srcRoot root path of the source directory
-	 * @param currentFile the current file being processed
-	 * @param destRoot root path of the destination directory
-	 * @return resolved target path for the file
+	 * @param planner the planner turning scanned files into tasks
 	 */
-	std::filesystem::path resolveTargetPath(const std::filesystem::path& srcRoot,
-		const std::filesystem::path& currentFile,
-		const std::filesystem::path& destRoot) const;
+	void executeSerial(TaskPlanner& planner);
 
 	/**
-	 * @brief Prompts the user how to handle an existing file when overwrite is not forced
+	 * @brief Runs scanning, planning and copying as overlapping pipeline stages
+	 * (parallel scanner -> planner on the calling thread -> pool of copy workers)
 	 *
-	 * @param targetFile the target file path
-	 * @return true, if the user wants to overwrite the file
+	 * @param planner the planner turning scanned files into tasks
 	 */
-	bool handleOverwritePrompt(const std::filesystem::path& targetFile);
+	void executeThreaded(TaskPlanner& planner);
 
 	/**
-	 * @brief Prompts the user how to handle a file conflict when flattening is enabled
+	 * @brief Copies with std::async workers while a PromptBroker answers conflicts on its own
+	 * thread, so non-conflicting files keep flowing during prompts
 	 *
-	 * @param targetFile the target file path
-	 * @return true, if the user wants to overwrite the file
+	 * @param planner the planner turning scanned files into tasks
 	 */
-	bool handleFlattenConflictPrompt(std::filesystem::path& targetFile);
+	void executeAsync(TaskPlanner& planner);
+
 	/**
-	 * @brief Logs the path of the copied file
+	 * @brief Plans all tasks first, then copies them with an OpenMP dynamic loop
+	 * (falls back to a serial loop when compiled without OpenMP)
 	 *
-	 * @param path Path of the copied file
+	 * @param planner the planner turning scanned files into tasks
 	 */
-	void logCopy(const std::filesystem::path& path);
+	void executeOpenMP(TaskPlanner& planner);
+
+	/**
+	 * @brief Plans a directory listing and merges the tasks of a file for several
+	 * destinations into one fan-out task (read once, write many)
+	 *
+	 * @param planner the planner turning scanned files into tasks
+	 * @param listing the directory listing
+	 * @param tasks receives the planned tasks (appended)
+	 */
+	void planListing(TaskPlanner& planner, const DirectoryListing& listing, std::vector<FileTask>& tasks);
+
+	/**
+	 * @brief Executes a planned task: creates the target directory, copies and logs
+	 *
+	 * @param task the task to execute
+	 */
+	void copyTask(const FileTask& task);
 
 	/**
-	 * @brief Resolves filename conflicts by appending suffixes like (1), (2), ...
+	 * @brief Executes several planned tasks, batched through the ring if one is given
 	 *
-	 * @param originalPath Path where conflict might occur
-	 * @return Unique path that doesn't exist
+	 * Tasks with a generation (a target written earlier in this run) are set aside for copyRepeated().
+	 *
+	 * @param tasks the tasks to execute
+	 * @param ring io_uring of the calling thread, or nullptr to copy task by task
+	 */
+	void copyBatch(std::span<const FileTask> tasks, UringCopier* ring);
+
+	/**
+	 * @brief Copies the repeated writes set aside by copyBatch once all other tasks are done,
+	 * in planning order, skipping every write a later one replaces (the serial mode's result)
+	 */
+	void copyRepeated();
+
+	/**
+	 * @brief Creates the target directories of all tasks before copying starts (parallel pre-pass)
+	 *
+	 * @param tasks the planned tasks
+	 */
+	void createSkeleton(std::span<const FileTask> tasks);
+
+	/**
+	 * @brief Creates an io_uring for the calling thread if --copy-engine uring is selected
+	 *
+	 * @return the ring, or nullptr if not selected, dry-run, or io_uring is unavailable (warns once)
+	 */
+	std::unique_ptr<UringCopier> makeRing();
+
+	/**
+	 * @brief Number of tasks a worker hands to its ring at once
 	 */
-	std::filesystem::path resolveFileNameConflict(const std::filesystem::path& originalPath) const;
+	size_t batchSize(const UringCopier* ring) const;
+
+	/**
+	 * @brief Creates a source walker with the compiled filters and the ignore file setting
+	 *
+	 * @param threadCount Number of scanner threads
+	 */
+	DirectoryWalker makeWalker(unsigned threadCount) const;
+
+	/**
+	 * @brief Opens the git index of a source if --source-list git is selected
+	 *
+	 * @return the index, or std::nullopt if not selected or the source isn't a usable checkout (warns)
+	 */
+	std::optional<GitIndex> openGitIndex(const std::filesystem::path& src) const;
+
+	/**
+	 * @brief Loads the scan cache of a source if --scan-cache is set
+	 *
+	 * @return the cache, or nullptr if not selected
+	 */
+	std::unique_ptr<ScanCache> openScanCache(const std::filesystem::path& src) const;
+
+	/**
+	 * @brief Writes a scan cache back after a complete walk (a failure only warns)
+	 *
+	 * @param cache the cache, nullptr does nothing
+	 */
+	void saveScanCache(const ScanCache* cache) const;
+
+	/**
+	 * @brief Enumerates one source (file list, git index or directory walk) and hands every listing to the sink
+	 *
+	 * @param src Source root
+	 * @param threadCount Number of scanner threads for a directory walk
+	 * @param sink Callback receiving each directory listing (never called concurrently)
+	 */
+	void walkSource(const std::filesystem::path& src, unsigned threadCount,
+		const std::function<void(DirectoryListing&)>& sink) const;
+
+	/**
+	 * @brief Enumerates one source and returns all listings in a deterministic order
+	 */
+	std::vector<DirectoryListing> collectSource(const std::filesystem::path& src, unsigned threadCount) const;
+
+	/**
+	 * @brief Logs the path of the copied file
+	 *
+	 * @param path Path of the copied file
+	 */
+	void logCopy(const std::filesystem::path& path);
 
 protected:
 	PruneOptions m_options; ///< The configuration options for file copying.
 	std::ofstream* m_logFile; ///< Optional pointer to an ofstream for logging output.
+	std::atomic<size_t> m_copiedFiles{ 0 }; ///< Number of executed copy tasks (all workers)
+	std::atomic<std::uintmax_t> m_copiedBytes{ 0 }; ///< Number of copied bytes (all workers)
+	CopyEngine m_engine; ///< Moves the file contents (selected by --copy-engine)
+	CopyStats m_copyStats; ///< Files per copy method (all workers)
+	std::atomic<bool> m_uringWarned{ false }; ///< The io_uring fallback warning was logged
+	DirectoryCache m_directories; ///< Target directories created in this run (all workers)
+	std::unique_ptr<DirectoryHandles> m_handles; ///< Directory descriptors for --fd-relative (nullptr if off or unsupported)
+	std::vector<FileTask> m_repeated; ///< Repeated writes to targets of this run, copied last (guarded by m_repeatedMutex)
+	std::mutex m_repeatedMutex; ///< Guards m_repeated (all workers)
 };
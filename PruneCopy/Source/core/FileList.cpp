@@ -0,0 +1,73 @@
+/*****************************************************************//**
+ * @file   FileList.cpp
+ * @brief  Implements the streamed --files-from reader
+ *
+ * @author Patrik Neunteufel
+ * @date   May 2025
+ *********************************************************************/
+
+#include "core/FileList.hpp"
+
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include "core/ListingBuilder.hpp"
+#include "log/LogManager.hpp"
+#include "util/FileStat.hpp"
+
+namespace fs = std::filesystem;
+
+// Constructor
+// Opens the list file, or uses standard input for "-"
+FileList::FileList(const fs::path& listFile)
+    : m_in(&std::cin) {
+    if (listFile != "-") {
+        m_file.open(listFile, std::ios::binary);
+        if (!m_file) {
+            throw std::runtime_error("Cannot read file list: " + listFile.string());
+        }
+        m_in = &m_file;
+    }
+}
+
+// Reads entry by entry; one stat per entry, handed on so the planner doesn't repeat it
+void FileList::walk(const fs::path& root, const FilterSet& filters,
+    const std::function<void(DirectoryListing&)>& sink, std::ofstream* logFile) {
+    ListingBuilder builder(root, filters, sink);
+    const fs::path absoluteRoot = fs::absolute(root).lexically_normal();
+
+    // The first delimiter decides between NUL- and newline-separated entries
+    char delimiter = '\n';
+    std::string entry;
+    for (int c = m_in->get(); c != std::char_traits<char>::eof(); c = m_in->get()) {
+        if (c == '\0' || c == '\n') {
+            delimiter = static_cast<char>(c);
+            break;
+        }
+        entry.push_back(static_cast<char>(c));
+    }
+
+    bool first = true;
+    while (first || std::getline(*m_in, entry, delimiter)) {
+        first = false;
+        if (delimiter == '\n' && !entry.empty() && entry.back() == '\r') entry.pop_back();
+        if (entry.empty()) continue;
+
+        fs::path path(entry);
+        path = path.is_absolute() ? path.lexically_normal().lexically_relative(absoluteRoot) : path.lexically_normal();
+        const std::string relative = path.generic_string();
+        if (relative.empty() || relative == "." || relative == ".." || relative.rfind("../", 0) == 0) {
+            LogManager::log(LogType::Skipped, entry + " (outside the source)", logFile);
+            continue;
+        }
+
+        const FileStat stat = FileStat::of(root / path);
+        if (!stat.exists) {
+            LogManager::log(LogType::Skipped, entry + " (not a file)", logFile);
+            continue;
+        }
+        builder.add(relative, stat);
+    }
+    builder.finish();
+}
@@ -0,0 +1,53 @@
+/*****************************************************************//**
+ * @file   FileList.hpp
+ * @brief  Streams an explicit list of files to copy (--files-from) instead
+ *         of scanning the source
+ *
+ * @author Patrik Neunteufel
+ * @date   May 2025
+ *********************************************************************/
+
+#pragma once
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <istream>
+
+#include "core/DirectoryWalker.hpp"
+#include "util/FilterSet.hpp"
+
+/**
+ * @brief NUL- or newline-delimited list of paths relative to the source root.
+ *
+ * The delimiter is detected from the first entry (a NUL before the first
+ * newline means NUL-delimited, e.g. `find -print0`). Entries are read one
+ * at a time and grouped into listings by ListingBuilder, so the copy can
+ * start long before the list ends and memory stays flat however long the
+ * list is. Absolute entries are accepted if they lie below the source root;
+ * entries leaving the root, directories and missing files are skipped.
+ */
+class FileList {
+public:
+	/**
+	 * @brief Opens the list.
+	 *
+	 * @param listFile Path of the list, or "-" for standard input
+	 * @throws std::runtime_error if the file can't be opened
+	 */
+	explicit FileList(const std::filesystem::path& listFile);
+
+	/**
+	 * @brief Reads the whole list and hands the files to the sink as listings (consumes the stream).
+	 *
+	 * @param root Source root the entries are relative to
+	 * @param filters Compiled filters; only the directory filters are applied here
+	 * @param sink Callback receiving each listing
+	 * @param logFile Optional log file for skipped entries
+	 */
+	void walk(const std::filesystem::path& root, const FilterSet& filters,
+		const std::function<void(DirectoryListing&)>& sink, std::ofstream* logFile = nullptr);
+
+private:
+	std::ifstream m_file; ///< Opened list file (unused for stdin)
+	std::istream* m_in;   ///< Stream the entries are read from
+};
@@ -5,3 +5,6 @@
  * @author Patrik Neunteufel
  * @date   April 2025
  *********************************************************************/
+
+#include "core/FileTask.hpp"
+/* empty for now */
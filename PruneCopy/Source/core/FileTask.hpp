@@ -1,9 +1,38 @@
 ﻿/*****************************************************************//**
  * @file   FileTask.hpp
- * @brief  
+ * @brief  Describes a single planned copy operation
  * 
  * @author Patrik Neunteufel
  * @date   April 2025
  *********************************************************************/
 
-#pragma once
\ No newline at end of file
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <filesystem>
+
+/**
+ * @brief Outcome of the overwrite decision for a planned copy
+ */
+enum class TaskAction {
+    Copy,       // Target does not exist yet
+    Overwrite,  // Target exists and will be replaced (forced or confirmed by the user)
+    Conflict,   // Target exists and the user still has to decide (ParallelMode::Async)
+};
+
+/**
+ * @brief A single unit of work: copy one source file to one resolved target
+ * (plus its mirrors in the other destinations, if the copier merged them).
+ *
+ * FileTasks are produced by the TaskPlanner after filtering and conflict
+ * resolution, so executing a task never needs user interaction.
+ */
+struct FileTask {
+    std::filesystem::path source;        // Absolute path of the source file
+    std::filesystem::path target;        // Fully resolved destination path
+    std::uintmax_t size = 0;             // Size of the source file in bytes
+    TaskAction action = TaskAction::Copy; // Overwrite decision made during planning
+    std::vector<std::filesystem::path> mirrors; // Further targets written from the same read (fan-out)
+    std::uint64_t generation = 0;        // Planning order of a repeated write to a target of this run (0 = first write)
+};
@@ -0,0 +1,255 @@
+/*****************************************************************//**
+ * @file   GitIndex.cpp
+ * @brief  Implements the git index reader
+ *
+ * @author Patrik Neunteufel
+ * @date   May 2025
+ *********************************************************************/
+
+#include "core/GitIndex.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+
+#include "core/ListingBuilder.hpp"
+#include "log/LogManager.hpp"
+#include "util/FileStat.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+    constexpr std::uint32_t ModeTypeMask = 0170000;
+    constexpr std::uint32_t ModeRegular = 0100000;
+    constexpr std::uint16_t FlagExtended = 0x4000;
+    constexpr std::uint16_t FlagStageMask = 0x3000;
+    constexpr std::uint16_t FlagNameMask = 0x0FFF;
+    constexpr std::uint16_t ExtFlagSkipWorktree = 0x4000;
+
+    // Index integers are big-endian
+    std::uint32_t readU32(const char* p) {
+        const auto* b = reinterpret_cast<const unsigned char*>(p);
+        return (std::uint32_t(b[0]) << 24) | (std::uint32_t(b[1]) << 16) | (std::uint32_t(b[2]) << 8) | std::uint32_t(b[3]);
+    }
+
+    std::uint16_t readU16(const char* p) {
+        const auto* b = reinterpret_cast<const unsigned char*>(p);
+        return static_cast<std::uint16_t>((b[0] << 8) | b[1]);
+    }
+
+    /**
+     * @brief The fields of one entry PruneCopy needs
+     */
+    struct IndexEntry {
+        std::uint32_t mode = 0;
+        std::uint32_t size = 0;  // Truncated to 32 bits by git
+        std::int64_t mtimeNs = 0;
+        std::uint16_t flags = 0;
+        std::uint16_t extFlags = 0;
+    };
+
+    /**
+     * @brief Sequential reader for the entry table (v4 names are prefix-compressed)
+     */
+    class EntryReader {
+    public:
+        EntryReader(const std::vector<char>& data, std::uint32_t version, size_t oidSize)
+            : m_data(data), m_version(version), m_oidSize(oidSize) {
+        }
+
+        // Reads the next entry; name() then holds its path
+        void next(IndexEntry& entry) {
+            const size_t fixed = 40 + m_oidSize + 2;
+            require(m_offset + fixed);
+            const char* p = m_data.data() + m_offset;
+            entry.mtimeNs = static_cast<std::int64_t>(readU32(p + 8)) * 1000000000 + readU32(p + 12);
+            entry.mode = readU32(p + 24);
+            entry.size = readU32(p + 36);
+            entry.flags = readU16(p + 40 + m_oidSize);
+            entry.extFlags = 0;
+
+            size_t nameStart = m_offset + fixed;
+            if (m_version >= 3 && (entry.flags & FlagExtended)) {
+                require(nameStart + 2);
+                entry.extFlags = readU16(m_data.data() + nameStart);
+                nameStart += 2;
+            }
+
+            if (m_version >= 4) {
+                // Number of bytes to drop from the previous name, then the NUL-terminated rest
+                size_t pos = nameStart;
+                require(pos + 1);
+                unsigned char c = static_cast<unsigned char>(m_data[pos++]);
+                size_t strip = c & 127;
+                while (c & 128) {
+                    require(pos + 1);
+                    c = static_cast<unsigned char>(m_data[pos++]);
+                    strip = ((strip + 1) << 7) | (c & 127);
+                }
+                if (strip > m_name.size()) throw std::runtime_error("corrupt git index (name compression)");
+                const size_t end = terminator(pos);
+                m_name.resize(m_name.size() - strip);
+                m_name.append(m_data.data() + pos, end - pos);
+                m_offset = end + 1;
+                return;
+            }
+
+            size_t nameLength = entry.flags & FlagNameMask;
+            if (nameLength == FlagNameMask) {
+                nameLength = terminator(nameStart) - nameStart;
+            }
+            require(nameStart + nameLength + 1);
+            m_name.assign(m_data.data() + nameStart, nameLength);
+            // Entries are NUL-padded to a multiple of eight bytes
+            m_offset += (nameStart - m_offset + nameLength + 8) & ~size_t(7);
+        }
+
+        const std::string& name() const { return m_name; }
+        size_t offset() const { return m_offset; }
+        void seek(size_t offset) { m_offset = offset; }
+
+    private:
+        void require(size_t end) const {
+            if (end > m_data.size()) throw std::runtime_error("truncated git index");
+        }
+
+        size_t terminator(size_t from) const {
+            const void* nul = std::memchr(m_data.data() + from, '\0', m_data.size() - from);
+            if (!nul) throw std::runtime_error("truncated git index");
+            return static_cast<const char*>(nul) - m_data.data();
+        }
+
+        const std::vector<char>& m_data;
+        std::uint32_t m_version;
+        size_t m_oidSize;
+        size_t m_offset = 12;
+        std::string m_name;
+    };
+
+    // Finds the directory holding .git (a directory, or a file "gitdir: <path>" for worktrees and submodules)
+    bool findGitDir(const fs::path& start, fs::path& worktree, fs::path& gitDir) {
+        for (fs::path dir = start; ; dir = dir.parent_path()) {
+            const fs::path dotGit = dir / ".git";
+            std::error_code ec;
+            if (fs::is_directory(dotGit, ec)) {
+                worktree = dir;
+                gitDir = dotGit;
+                return true;
+            }
+            if (fs::is_regular_file(dotGit, ec)) {
+                std::ifstream in(dotGit);
+                std::string line;
+                std::getline(in, line);
+                if (line.rfind("gitdir:", 0) == 0) {
+                    std::string target = line.substr(7);
+                    target.erase(0, target.find_first_not_of(" \t"));
+                    while (!target.empty() && (target.back() == '\r' || target.back() == ' ')) target.pop_back();
+                    worktree = dir;
+                    gitDir = fs::path(target).is_absolute() ? fs::path(target) : dir / target;
+                    return true;
+                }
+            }
+            if (dir == dir.root_path() || dir.parent_path() == dir) return false;
+        }
+    }
+
+    // SHA-256 repositories declare it in their config (extensions.objectFormat)
+    size_t objectIdSize(const fs::path& gitDir) {
+        std::ifstream in(gitDir / "config");
+        std::string line;
+        while (std::getline(in, line)) {
+            std::transform(line.begin(), line.end(), line.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+            line.erase(std::remove_if(line.begin(), line.end(), [](char c) { return c == ' ' || c == '\t' || c == '\r'; }), line.end());
+            if (line == "objectformat=sha256") return 32;
+        }
+        return 20;
+    }
+
+}
+
+// Constructor
+// Reads the whole index once and checks that every tracked file is listed in it
+GitIndex::GitIndex(const fs::path& source)
+    : m_source(source) {
+    const fs::path absolute = fs::absolute(source).lexically_normal();
+    fs::path gitDir;
+    if (!findGitDir(absolute, m_worktree, gitDir)) {
+        throw std::runtime_error(source.string() + " is not inside a git checkout");
+    }
+    std::string prefix = absolute.lexically_relative(m_worktree).generic_string();
+    while (!prefix.empty() && prefix.back() == '/') prefix.pop_back();
+    m_prefix = (prefix.empty() || prefix == ".") ? std::string() : prefix + "/";
+
+    const fs::path indexFile = gitDir / "index";
+    std::ifstream in(indexFile, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("cannot read " + indexFile.string());
+    }
+    m_data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    m_oidSize = objectIdSize(gitDir);
+
+    if (m_data.size() < 12 + m_oidSize || std::memcmp(m_data.data(), "DIRC", 4) != 0) {
+        throw std::runtime_error(indexFile.string() + " is not a git index");
+    }
+    m_version = readU32(m_data.data() + 4);
+    m_count = readU32(m_data.data() + 8);
+    if (m_version < 2 || m_version > 4) {
+        throw std::runtime_error("unsupported git index version " + std::to_string(m_version));
+    }
+
+    // Skip over the entries once to reach the extensions
+    EntryReader reader(m_data, m_version, m_oidSize);
+    IndexEntry entry;
+    for (std::uint32_t i = 0; i < m_count; ++i) {
+        reader.next(entry);
+    }
+    m_entriesEnd = reader.offset();
+
+    // A split index keeps most entries in a shared file, a sparse index collapses directories
+    const size_t extensionsEnd = m_data.size() - m_oidSize;
+    for (size_t offset = m_entriesEnd; offset + 8 <= extensionsEnd; ) {
+        const std::string_view signature(m_data.data() + offset, 4);
+        if (signature == "link" || signature == "sdir") {
+            throw std::runtime_error("split or sparse git index is not supported");
+        }
+        offset += 8 + static_cast<size_t>(readU32(m_data.data() + offset + 4));
+    }
+}
+
+// Replays the sorted paths through a ListingBuilder, which applies the directory filters
+// One stat per entry, handed on so the planner doesn't repeat it
+void GitIndex::walk(const FilterSet& filters, const std::function<void(DirectoryListing&)>& sink, std::ofstream* logFile) const {
+    ListingBuilder builder(m_source, filters, sink);
+    EntryReader reader(m_data, m_version, m_oidSize);
+    IndexEntry entry;
+    for (std::uint32_t i = 0; i < m_count; ++i) {
+        reader.next(entry);
+        const std::string& name = reader.name();
+
+        if ((entry.mode & ModeTypeMask) != ModeRegular || (entry.flags & FlagStageMask) != 0 ||
+            (entry.extFlags & ExtFlagSkipWorktree) != 0) {
+            continue;
+        }
+        // Entries are sorted, so the ones below the prefix are contiguous
+        if (!m_prefix.empty()) {
+            if (name.compare(0, m_prefix.size(), m_prefix) < 0) continue;
+            if (name.compare(0, m_prefix.size(), m_prefix) > 0) break;
+        }
+
+        // The index may be stale: a tracked file can be deleted or modified in the worktree
+        const std::string_view relative = std::string_view(name).substr(m_prefix.size());
+        const FileStat stat = FileStat::of(m_source / fs::path(relative));
+        if (!stat.exists) {
+            LogManager::log(LogType::Skipped, name + " (not a file)", logFile);
+            continue;
+        }
+        builder.add(relative, stat);
+    }
+    builder.finish();
+}
@@ -0,0 +1,77 @@
+/*****************************************************************//**
+ * @file   GitIndex.hpp
+ * @brief  Enumerates the tracked files of a git checkout from .git/index
+ *         (--source-list git) instead of walking the directory tree
+ *
+ * @author Patrik Neunteufel
+ * @date   May 2025
+ *********************************************************************/
+
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "core/DirectoryWalker.hpp"
+#include "util/FilterSet.hpp"
+
+/**
+ * @brief Reader for the git index file (versions 2, 3 and 4), no git binary needed.
+ *
+ * The index lists every tracked path sorted byte-wise, together with the
+ * stat data git recorded for it. walk() turns it into DirectoryListings for
+ * the TaskPlanner, applying the directory filters on the way (excluded and
+ * dead subtrees are skipped just like in DirectoryWalker), so no directory
+ * of the source is ever listed. Every entry is stat'ed in the worktree, since
+ * the index only records the state of the last git command: tracked files
+ * that were deleted since are skipped and logged like missing --files-from
+ * entries, and the size and mtime found on disk are handed on in
+ * DirectoryListing::stats so the planner doesn't repeat the stat.
+ *
+ * Only regular files in stage 0 are returned: symlinks, submodules,
+ * unmerged and skip-worktree entries are left out. Split and sparse
+ * indexes are rejected so the caller can fall back to a directory walk.
+ */
+class GitIndex {
+public:
+	/**
+	 * @brief Locates the checkout containing source and reads its index.
+	 *
+	 * @param source Source directory (the worktree root or any directory inside it)
+	 * @throws std::runtime_error if no checkout is found or the index can't be used
+	 */
+	explicit GitIndex(const std::filesystem::path& source);
+
+	/**
+	 * @brief Hands the tracked files below the source to the sink, one listing per directory run.
+	 *
+	 * @param filters Compiled filters; only the directory filters are applied here
+	 * @param sink Callback receiving each listing (in index order)
+	 * @param logFile Optional log file for entries missing from the worktree
+	 */
+	void walk(const FilterSet& filters, const std::function<void(DirectoryListing&)>& sink,
+		std::ofstream* logFile = nullptr) const;
+
+	/**
+	 * @brief Number of entries in the index (all stages and types).
+	 */
+	std::uint32_t entryCount() const { return m_count; }
+
+	/**
+	 * @brief Root directory of the checkout the index belongs to.
+	 */
+	const std::filesystem::path& worktree() const { return m_worktree; }
+
+private:
+	std::filesystem::path m_source;   ///< Source as passed in (listing paths are built from it)
+	std::filesystem::path m_worktree; ///< Directory containing .git
+	std::string m_prefix;             ///< Source relative to the worktree with trailing '/' ("" for the root)
+	std::vector<char> m_data;         ///< Whole index file
+	std::uint32_t m_version = 0;      ///< Index format version (2, 3 or 4)
+	std::uint32_t m_count = 0;        ///< Number of entries
+	size_t m_oidSize = 20;            ///< Object id length (20 for SHA-1, 32 for SHA-256 repositories)
+	size_t m_entriesEnd = 0;          ///< Offset of the first extension
+};
@@ -0,0 +1,107 @@
+/*****************************************************************//**
+ * @file   ListingBuilder.cpp
+ * @brief  Implements grouping of known file paths into directory listings
+ *
+ * @author Patrik Neunteufel
+ * @date   May 2025
+ *********************************************************************/
+
+#include "core/ListingBuilder.hpp"
+
+#include <algorithm>
+
+namespace fs = std::filesystem;
+
+// Constructor
+// Starts with an empty listing of the root
+ListingBuilder::ListingBuilder(const fs::path& root, const FilterSet& filters,
+    const std::function<void(DirectoryListing&)>& sink)
+    : m_root(root), m_filters(filters), m_sink(sink) {
+    m_rootFrame.state = m_filters.rootState();
+    m_listing.directory = m_root;
+    m_listing.pathState = m_rootFrame.state;
+}
+
+// Switches directories if needed and appends the file to the current listing
+bool ListingBuilder::add(std::string_view relative, const FileStat& stat) {
+    const size_t slash = relative.rfind('/');
+    const std::string_view dir = slash == std::string_view::npos ? std::string_view() : relative.substr(0, slash);
+    if (dir != m_dir) {
+        enter(dir);
+    }
+    if (m_pruned) {
+        return false;
+    }
+
+    m_listing.files.push_back(m_root / std::string(relative));
+    m_listing.stats.push_back(stat);
+    if (m_listing.files.size() >= MaxFiles) {
+        flush();
+    }
+    return true;
+}
+
+// Hands out whatever is left
+void ListingBuilder::finish() {
+    flush();
+}
+
+// Keeps the frames shared with the previous directory and checks the new components one by one
+void ListingBuilder::enter(std::string_view dir) {
+    flush();
+
+    size_t depth = 0;
+    size_t pos = 0;
+    while (depth < m_stack.size() && pos < dir.size()) {
+        const size_t end = std::min(dir.find('/', pos), dir.size());
+        if (dir.substr(pos, end - pos) != m_stack[depth].name) break;
+        ++depth;
+        pos = end + 1;
+    }
+    m_stack.resize(depth);
+
+    while (pos < dir.size()) {
+        const size_t end = std::min(dir.find('/', pos), dir.size());
+        const Frame& parent = m_stack.empty() ? m_rootFrame : m_stack.back();
+        Frame frame;
+        frame.name = std::string(dir.substr(pos, end - pos));
+        if (parent.pruned) {
+            frame.pruned = true;
+        }
+        else if (m_filters.isExcludedDir(frame.name, parent.state)) {
+            std::string path(dir.substr(0, end));
+            if (m_reported.insert(path).second) {
+                m_skipped.push_back(m_root / path);
+            }
+            frame.pruned = true;
+        }
+        else {
+            frame.state = m_filters.descend(parent.state, frame.name);
+            frame.pruned = !m_filters.canContainIncluded(frame.state);
+        }
+        m_stack.push_back(std::move(frame));
+        pos = end + 1;
+    }
+
+    m_dir.assign(dir);
+    m_pruned = !m_stack.empty() && m_stack.back().pruned;
+    m_listing.directory = dir.empty() ? m_root : m_root / m_dir;
+    m_listing.relativeDir = m_dir;
+    m_listing.pathState = m_stack.empty() ? m_rootFrame.state : m_stack.back().state;
+}
+
+// Passes the current listing (and pending excluded directories) to the sink
+void ListingBuilder::flush() {
+    if (m_listing.files.empty() && m_skipped.empty()) {
+        return;
+    }
+    m_listing.skippedDirs = std::move(m_skipped);
+    m_skipped.clear();
+    m_sink(m_listing);
+
+    DirectoryListing next;
+    next.directory = m_listing.directory;
+    next.relativeDir = m_listing.relativeDir;
+    next.pathState = m_listing.pathState;
+    m_listing = std::move(next);
+}
@@ -0,0 +1,84 @@
+/*****************************************************************//**
+ * @file   ListingBuilder.hpp
+ * @brief  Groups a stream of relative file paths into DirectoryListings
+ *         with the directory filters applied (git index, --files-from)
+ *
+ * @author Patrik Neunteufel
+ * @date   May 2025
+ *********************************************************************/
+
+#pragma once
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+#include "core/DirectoryWalker.hpp"
+#include "util/FileStat.hpp"
+#include "util/FilterSet.hpp"
+
+/**
+ * @brief Turns file paths that are already known into the listings DirectoryWalker would produce.
+ *
+ * The builder keeps a stack of directory frames (name, path state, pruned)
+ * for the directory of the previous path, so consecutive paths in the same
+ * or a neighbouring directory only cost the components that differ. Every
+ * directory component is checked against the exclude-dir patterns and rules
+ * and advanced through the path patterns exactly once per visit; files below
+ * an excluded or dead directory are dropped. Sorted input gives one listing
+ * per directory, unsorted input just more and smaller ones.
+ */
+class ListingBuilder {
+public:
+	static constexpr size_t MaxFiles = 4096; ///< Files per listing before it is handed on (bounds memory for huge directories)
+
+	/**
+	 * @brief Constructs a builder for one source root.
+	 *
+	 * @param root Source root the paths are relative to (listing paths are built from it)
+	 * @param filters Compiled filters; only the directory filters are applied here
+	 * @param sink Callback receiving each finished listing
+	 */
+	ListingBuilder(const std::filesystem::path& root, const FilterSet& filters,
+		const std::function<void(DirectoryListing&)>& sink);
+
+	/**
+	 * @brief Adds one file.
+	 *
+	 * @param relative Path relative to the root with '/' separators (no "." or ".." components)
+	 * @param stat Size and mtime if already known (exists = false to let the planner stat it)
+	 * @return false if a directory filter dropped the file
+	 */
+	bool add(std::string_view relative, const FileStat& stat = {});
+
+	/**
+	 * @brief Hands the last listing to the sink.
+	 */
+	void finish();
+
+private:
+	/**
+	 * @brief One directory component of the current directory
+	 */
+	struct Frame {
+		std::string name;
+		FilterSet::PathState state;
+		bool pruned = false;
+	};
+
+	void enter(std::string_view dir);
+	void flush();
+
+	std::filesystem::path m_root;
+	const FilterSet& m_filters;
+	std::function<void(DirectoryListing&)> m_sink;
+	Frame m_rootFrame;
+	std::vector<Frame> m_stack;                   ///< Frames of the current directory below the root
+	std::vector<std::filesystem::path> m_skipped; ///< Excluded directories not reported yet
+	std::unordered_set<std::string> m_reported;   ///< Excluded directories already reported (unsorted input)
+	DirectoryListing m_listing;
+	std::string m_dir;                            ///< Current directory relative to the root
+	bool m_pruned = false;                        ///< Current directory is excluded or dead
+};
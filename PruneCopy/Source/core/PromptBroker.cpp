@@ -0,0 +1,251 @@
+/*****************************************************************//**
+ * @file   PromptBroker.cpp
+ * @brief  Implements the conflict prompts and the serialized prompt broker
+ *
+ * @author Patrik Neunteufel
+ * @date   May 2025
+ *********************************************************************/
+
+#include "core/PromptBroker.hpp"
+
+#include <iostream>
+#include <limits>
+#include <utility>
+
+#include "core/TaskPlanner.hpp"
+#include "log/LogManager.hpp"
+
+namespace fs = std::filesystem;
+
+// Constructor
+// The request queue is effectively unbounded so posting never blocks the planner
+PromptBroker::PromptBroker(TaskPlanner& planner, bool flatten, std::ofstream* logFile, AcceptHandler onAccept)
+    : m_planner(planner), m_flatten(flatten), m_logFile(logFile), m_onAccept(std::move(onAccept)),
+      m_requests(std::numeric_limits<size_t>::max()) {
+    m_thread = std::thread([this] { run(); });
+}
+
+// Destructor
+// Makes sure the broker thread is stopped (without prompting for what is left)
+PromptBroker::~PromptBroker() {
+    stop();
+    m_requests.close();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+// Queues a conflicting task for the broker thread
+void PromptBroker::post(FileTask task) {
+    m_requests.push(std::move(task));
+}
+
+// Closes the request queue, waits until all requests were answered and hands back a broker error
+void PromptBroker::finish() {
+    m_requests.close();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+    if (m_error) {
+        std::rethrow_exception(std::exchange(m_error, nullptr));
+    }
+}
+
+// The loop keeps draining the queue, so posting never blocks
+void PromptBroker::stop() {
+    m_stopped = true;
+}
+
+// Broker loop: answers queued requests strictly one after another
+// An exception must not escape the thread (std::terminate); the first one is kept for finish()
+void PromptBroker::run() {
+    FileTask task;
+    while (m_requests.pop(task)) {
+        if (m_stopped) continue;
+        try {
+            resolve(task);
+        }
+        catch (...) {
+            if (!m_error) m_error = std::current_exception();
+        }
+    }
+}
+
+// Applies sticky answers first and only prompts if none applies
+void PromptBroker::resolve(FileTask& task) {
+    if (m_overwriteAll) {
+        task.action = TaskAction::Overwrite;
+        accept(task);
+        return;
+    }
+
+    if (!m_flatten) {
+        if (m_skipAll) return;
+
+        switch (askOverwrite(task.target, m_logFile)) {
+        case PromptAnswer::All:
+            m_overwriteAll = true;
+            [[fallthrough]];
+        case PromptAnswer::Yes:
+            task.action = TaskAction::Overwrite;
+            accept(task);
+            return;
+        case PromptAnswer::SkipAll:
+            m_skipAll = true;
+            return;
+        default:
+            return;
+        }
+    }
+
+    if (m_autoRenameAll) {
+        acceptRenamed(task);
+        return;
+    }
+
+    const fs::path suggested = m_planner.resolveFileNameConflict(task.target);
+    FlattenChoice choice = askFlatten(task.target, suggested,
+        [&](const fs::path& p) { return m_planner.targetExists(p); }, m_logFile);
+
+    switch (choice.answer) {
+    case PromptAnswer::All:
+        m_overwriteAll = true;
+        [[fallthrough]];
+    case PromptAnswer::Yes:
+        task.action = TaskAction::Overwrite;
+        accept(task);
+        return;
+    case PromptAnswer::AutoRenameAll:
+        m_autoRenameAll = true;
+        acceptRenamed(task);
+        return;
+    case PromptAnswer::Rename:
+        if (choice.target == suggested || !m_planner.claimTarget(choice.target)) {
+            acceptRenamed(task);  // the suggestion may have been taken meanwhile
+            return;
+        }
+        task.target = choice.target;
+        task.action = TaskAction::Copy;
+        accept(task);
+        return;
+    default:
+        return;
+    }
+}
+
+// An accepted overwrite may replace a target an earlier task of this run writes as well
+// (renamed targets were claimed, so they are new)
+void PromptBroker::accept(FileTask& task) {
+    if (task.action == TaskAction::Overwrite) {
+        task.generation = m_planner.planTarget(task.target);
+    }
+    m_onAccept(std::move(task));
+}
+
+// Reserves the next free "name(n).ext" for the task and accepts it
+void PromptBroker::acceptRenamed(FileTask& task) {
+    fs::path renamed;
+    do {
+        renamed = m_planner.resolveFileNameConflict(task.target);
+    } while (!m_planner.claimTarget(renamed));
+
+    task.target = renamed;
+    task.action = TaskAction::Copy;
+    accept(task);
+}
+
+// Prompts the user to confirm a file overwrite
+PromptAnswer PromptBroker::askOverwrite(const fs::path& targetFile, std::ofstream* logFile) {
+    while (true) {
+        std::string msg = targetFile.string() + " already exists. [y]es / [n]o / [a]ll / [s]kip all / [c]ancel:";
+        LogManager::logAlwaysToConsole(LogType::Conflict, msg);
+        LogManager::log(LogType::Conflict, msg, logFile);
+        std::string input;
+        if (!std::getline(std::cin, input)) {
+            // No one left to answer (stdin closed or redirected): never overwrite unasked
+            LogManager::log(LogType::UserInput, "End of input, skipping all conflicts", logFile);
+            return PromptAnswer::SkipAll;
+        }
+        LogManager::log(LogType::UserInput, "User entered: " + input, logFile);
+
+        if (input.empty()) continue;
+
+        char answer = std::tolower(input[0]);
+
+        switch (answer) {
+        case 'y': return PromptAnswer::Yes;
+        case 'n': return PromptAnswer::No;
+        case 'a': return PromptAnswer::All;
+        case 's': return PromptAnswer::SkipAll;
+        case 'c':
+            LogManager::log(LogType::Aborted, "Operation cancelled by user.", logFile);
+            exit(0);
+        default:
+            continue;
+        }
+    }
+}
+
+// Prompts for flatten conflict resolution with suggested name and extended options
+FlattenChoice PromptBroker::askFlatten(const fs::path& targetFile, const fs::path& suggested,
+    const std::function<bool(const fs::path&)>& exists, std::ofstream* logFile) {
+    while (true) {
+        std::string msg = targetFile.string() +
+            " already exists. [o]verwrite / [r]ename / [s]kip / [c]ancel / [a]lways overwrite / [m] Auto-rename all\n" +
+            "Suggested rename: " + suggested.filename().string();
+
+        LogManager::logAlwaysToConsole(LogType::Conflict, msg);
+        LogManager::log(LogType::Conflict, msg, logFile);
+        std::string input;
+        if (!std::getline(std::cin, input)) {
+            LogManager::log(LogType::UserInput, "End of input, skipping", logFile);
+            return { PromptAnswer::No, {} };
+        }
+        LogManager::log(LogType::UserInput, "User entered: " + input, logFile);
+
+        if (input.empty()) continue;
+        char choice = std::tolower(input[0]);
+
+        switch (choice) {
+        case 'o':
+            return { PromptAnswer::Yes, targetFile }; // Overwrite
+        case 'r': {
+            LogManager::logAlwaysToConsole(LogType::Conflict, "Enter new filename (leave blank to use suggested):");
+            std::string newName;
+            if (!std::getline(std::cin, newName)) {
+                LogManager::log(LogType::UserInput, "End of input, skipping", logFile);
+                return { PromptAnswer::No, {} };
+            }
+            if (!newName.empty()) {
+                fs::path candidate = targetFile.parent_path() / newName;
+                // Recursively check if new name also exists
+                while (exists(candidate)) {
+                    LogManager::logAlwaysToConsole(LogType::Conflict, candidate.string() + " also exists. Enter different name:");
+                    if (!std::getline(std::cin, newName)) {
+                        LogManager::log(LogType::UserInput, "End of input, skipping", logFile);
+                        return { PromptAnswer::No, {} };
+                    }
+                    if (newName.empty()) {
+                        candidate = suggested; // fallback to suggestion
+                        break;
+                    }
+                    candidate = targetFile.parent_path() / newName;
+                }
+                return { PromptAnswer::Rename, candidate };
+            }
+            return { PromptAnswer::Rename, suggested };
+        }
+        case 's':
+            return { PromptAnswer::No, {} }; // Skip file
+        case 'c':
+            LogManager::log(LogType::Aborted, "Operation cancelled by user.", logFile);
+            exit(0);
+        case 'a':
+            return { PromptAnswer::All, targetFile };
+        case 'm':
+            return { PromptAnswer::AutoRenameAll, suggested };
+        default:
+            continue; // Repeat on invalid input
+        }
+    }
+}
@@ -0,0 +1,153 @@
+/*****************************************************************//**
+ * @file   PromptBroker.hpp
+ * @brief  Owns the console for conflict prompts while copies keep
+ *         running in the background (ParallelMode::Async)
+ *
+ * @author Patrik Neunteufel
+ * @date   May 2025
+ *********************************************************************/
+
+#pragma once
+#include <string>
+#include <atomic>
+#include <exception>
+#include <thread>
+#include <fstream>
+#include <functional>
+#include <filesystem>
+
+#include "core/FileTask.hpp"
+#include "core/TaskQueue.hpp"
+
+class TaskPlanner;
+
+/**
+ * @brief Answer given by the user to a conflict prompt
+ */
+enum class PromptAnswer {
+	Yes,            // Overwrite this file ([y]es / [o]verwrite)
+	No,             // Skip this file ([n]o / [s]kip)
+	All,            // Overwrite this and all following files ([a]ll / [a]lways overwrite)
+	SkipAll,        // Skip this and all following conflicts ([s]kip all)
+	Rename,         // Write to a different name ([r]ename)
+	AutoRenameAll   // Rename this and all following conflicts automatically ([m])
+};
+
+/**
+ * @brief Result of a flatten conflict prompt
+ */
+struct FlattenChoice {
+	PromptAnswer answer = PromptAnswer::No; // What the user decided
+	std::filesystem::path target;           // Target to write to for Rename / AutoRenameAll
+};
+
+/**
+ * @brief Serializes all conflict prompts on a single thread.
+ *
+ * Conflicting tasks are posted to the broker and the caller moves on, so
+ * non-conflicting copies keep flowing while the user answers. Sticky answers
+ * ([a]ll, [s]kip all, auto-rename all) are applied to every request that is
+ * still pending without asking again. An error while resolving a request
+ * doesn't stop the broker; the first one is rethrown by finish().
+ */
+class PromptBroker {
+public:
+	/**
+	 * @brief Handler receiving tasks the user accepted (called on the broker thread)
+	 */
+	using AcceptHandler = std::function<void(FileTask&&)>;
+
+	/**
+	 * @brief Constructs the broker and starts its thread.
+	 *
+	 * @param planner Planner used to find and reserve conflict-free names
+	 * @param flatten Whether conflicts are flatten conflicts (rename options)
+	 * @param logFile Optional pointer to an ofstream for logging output
+	 * @param onAccept Handler receiving accepted tasks
+	 */
+	PromptBroker(TaskPlanner& planner, bool flatten, std::ofstream* logFile, AcceptHandler onAccept);
+
+	/**
+	 * @brief Stops the broker thread (pending requests are dropped).
+	 */
+	~PromptBroker();
+
+	/**
+	 * @brief Posts a conflicting task; never blocks the caller.
+	 * @param task The task with TaskAction::Conflict
+	 */
+	void post(FileTask task);
+
+	/**
+	 * @brief Waits until every posted request was answered and stops the broker thread.
+	 * @throws The first exception thrown while resolving a request (only once)
+	 */
+	void finish();
+
+	/**
+	 * @brief Stops asking: requests still pending or posted later are dropped (the run failed).
+	 * Safe to call from any thread.
+	 */
+	void stop();
+
+	/**
+	 * @brief Asks whether an existing file should be overwritten.
+	 *
+	 * @param targetFile The existing target file
+	 * @param logFile Optional pointer to an ofstream for logging output
+	 * @return The answer (exits the program on [c]ancel, SkipAll at the end of input)
+	 */
+	static PromptAnswer askOverwrite(const std::filesystem::path& targetFile, std::ofstream* logFile);
+
+	/**
+	 * @brief Asks how to resolve a conflict in flatten mode.
+	 *
+	 * @param targetFile The conflicting target file
+	 * @param suggested Suggested conflict-free name
+	 * @param exists Predicate used to validate names entered by the user
+	 * @param logFile Optional pointer to an ofstream for logging output
+	 * @return The choice (exits the program on [c]ancel, skips the file at the end of input)
+	 */
+	static FlattenChoice askFlatten(const std::filesystem::path& targetFile,
+		const std::filesystem::path& suggested,
+		const std::function<bool(const std::filesystem::path&)>& exists,
+		std::ofstream* logFile);
+
+private:
+	/**
+	 * @brief Broker thread: answers requests one after another until stopped
+	 */
+	void run();
+
+	/**
+	 * @brief Resolves a single request, prompting only if no sticky answer applies
+	 * @param task The conflicting task
+	 */
+	void resolve(FileTask& task);
+
+	/**
+	 * @brief Renames the task target to a reserved conflict-free name and accepts it
+	 * @param task The conflicting task
+	 */
+	void acceptRenamed(FileTask& task);
+
+	/**
+	 * @brief Records an overwritten target with the planner and hands the task to the accept handler
+	 * @param task The accepted task
+	 */
+	void accept(FileTask& task);
+
+	TaskPlanner& m_planner;           ///< Planner used for name reservation
+	bool m_flatten;                   ///< Flatten conflict mode
+	std::ofstream* m_logFile;         ///< Optional pointer to an ofstream for logging output
+	AcceptHandler m_onAccept;         ///< Receives accepted tasks
+	TaskQueue<FileTask> m_requests;   ///< Pending conflict requests
+	std::thread m_thread;             ///< Thread owning the console
+	std::atomic<bool> m_stopped{ false }; ///< stop() was called, no more prompts
+	std::exception_ptr m_error;       ///< First error of the broker thread (read after the join)
+
+	// Sticky answers, only touched on the broker thread
+	bool m_overwriteAll = false;      ///< [a]ll was chosen
+	bool m_skipAll = false;           ///< [s]kip all was chosen
+	bool m_autoRenameAll = false;     ///< auto-rename all was chosen
+};
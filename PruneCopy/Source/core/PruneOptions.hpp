@@ -10,7 +10,10 @@
 #include <string>
 #include <vector>
 #include <filesystem>
-#include <regex>
+#include <cstdint>
+#include <memory>
+
+#include "util/FilterSet.hpp"
 
 namespace fs = std::filesystem;
 /**
@@ -23,6 +26,33 @@ enum class ParallelMode {
     OpenMP    // Use OpenMP parallel for-loops (requires compiler support)
 };
 
+/**
+ * @brief Defines how the bytes of a file are copied
+ */
+enum class CopyEngineMode {
+    Auto,      // Best available method (kernel-side copy on Linux, std::filesystem elsewhere)
+    Kernel,    // Kernel-side copy (copy_file_range, then sendfile), read/write loop as last resort
+    ReadWrite, // Plain read/write loop through a user-space buffer
+    IoUring    // Batched io_uring submissions (Linux, build with liburing), Auto when unavailable
+};
+
+/**
+ * @brief Defines how the files of a source are enumerated
+ */
+enum class SourceListMode {
+    Walk, // Scan the directory tree (default)
+    Git   // Read the tracked files from the git index (falls back to Walk outside a checkout)
+};
+
+/**
+ * @brief Defines whether files are cloned (reflink / copy-on-write) instead of copied
+ */
+enum class ReflinkMode {
+    Auto,    // Clone when the filesystem supports it, copy otherwise (default)
+    Always,  // Clone or fail (never duplicates data)
+    Never    // Always copy the data
+};
+
 /**
  * @brief Defines the verbosity level for console and file logging
  */
@@ -55,9 +85,13 @@ struct PruneOptions {
     std::vector<std::string> types;              // File patterns to include (e.g. *.h, *.cpp)
     std::vector<std::string> excludeDirs;        // Directory names to exclude
     std::vector<std::string> excludeFiles;       // File patterns to exclude (e.g. *Impl.hpp)
+    fs::path rulesFile;                          // Ordered +/- rules checked before the patterns above (empty = none)
+    bool useIgnoreFiles = false;                 // Honour .gitignore / .prunecopyignore files in the sources
+    SourceListMode sourceList = SourceListMode::Walk; // How source files are enumerated
+    fs::path filesFrom;                          // Copy the files named in this list ("-" = stdin) instead of scanning (one source only)
+    fs::path scanCacheDir;                       // Persistent scan caches of the sources (empty = every directory is read)
 
-    std::vector<std::regex> typePatterns;        // Compiled regex filters for include patterns
-    std::vector<std::regex> excludeFilePatterns; // Compiled regex filters for exclude patterns
+    std::shared_ptr<const FilterSet> filters;    // types/excludeFiles/excludeDirs/rules compiled once (shared, read-only)
 
     fs::path logDir;                             // Directory for writing log files
     bool enableLogging = false;                  // Whether to write logs to file
@@ -69,12 +103,22 @@ struct PruneOptions {
     bool dryRun = false;                         // Simulate copying without touching the filesystem
     bool noOverwrite = false;                    // Skip files that already exist
     bool forceOverwrite = false;                 // Overwrite files without prompting
+    bool indexDestinations = false;              // Scan the destinations once up front instead of probing every target
+    bool onlyNewer = false;                      // Only copy files that changed compared to the existing target
+    bool compareSize = false;                    // onlyNewer: a different size counts as changed
+    bool compareMtime = true;                    // onlyNewer: a newer source mtime counts as changed
+    std::int64_t mtimeToleranceNs = 0;           // onlyNewer: mtime differences up to this are ignored (FAT/SMB: 2s)
 
     bool flatten = false;                        // Copy all files into a single target folder
     bool flattenWithSuffix = false;              // Flatten with path-based filename suffixes to prevent conflicts
 	bool flattenAutoRename = false;              // Automatically rename files in flatten mode to avoid conflicts
 
     ParallelMode parallelMode = ParallelMode::None; // Selected parallelization strategy
+    unsigned threadCount = 0;                       // Worker threads for parallel modes (0 = hardware concurrency)
+    CopyEngineMode copyEngine = CopyEngineMode::Auto; // How file contents are copied
+    ReflinkMode reflink = ReflinkMode::Auto;        // Clone files on copy-on-write filesystems
+    unsigned ioDepth = 64;                          // Files in flight per io_uring (CopyEngineMode::IoUring)
+    bool fdRelative = false;                        // Linux: open/create files relative to cached directory descriptors
     ColorMode colorMode = ColorMode::Auto;          // Console color output setting
     LogLevel logLevel = LogLevel::Info;             // Log verbosity level
 };
@@ -0,0 +1,266 @@
+/*****************************************************************//**
+ * @file   ScanCache.cpp
+ * @brief  Implements the persistent scan cache
+ *
+ * @author Patrik Neunteufel
+ * @date   May 2025
+ *********************************************************************/
+
+#include "core/ScanCache.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <system_error>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/stat.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+    constexpr char Magic[4] = { 'P', 'C', 'S', 'C' };
+    constexpr std::uint32_t Version = 1;
+
+    // FNV-1a: a stable file name per source root (std::hash may differ between builds)
+    std::uint64_t fnv1a(const std::string& text) {
+        std::uint64_t hash = 14695981039346656037ull;
+        for (const unsigned char c : text) {
+            hash ^= c;
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    // Appends a value in native byte order (the cache never leaves the machine)
+    template <typename T>
+    void put(std::string& out, T value) {
+        char bytes[sizeof(T)];
+        std::memcpy(bytes, &value, sizeof(T));
+        out.append(bytes, sizeof(T));
+    }
+
+    // Appends a length-prefixed string
+    void putString(std::string& out, const std::string& text) {
+        put<std::uint32_t>(out, static_cast<std::uint32_t>(text.size()));
+        out += text;
+    }
+
+    /**
+     * @brief Bounds-checked cursor over the loaded cache file
+     */
+    struct Reader {
+        const std::string& data;
+        size_t pos = 0;
+        bool ok = true;
+
+        template <typename T>
+        T get() {
+            T value{};
+            if (!ok || data.size() - pos < sizeof(T)) {
+                ok = false;
+                return value;
+            }
+            std::memcpy(&value, data.data() + pos, sizeof(T));
+            pos += sizeof(T);
+            return value;
+        }
+
+        std::string getString() {
+            const std::uint32_t size = get<std::uint32_t>();
+            if (!ok || data.size() - pos < size) {
+                ok = false;
+                return {};
+            }
+            std::string text = data.substr(pos, size);
+            pos += size;
+            return text;
+        }
+    };
+
+    // Current time in nanoseconds since the Unix epoch (same scale as the stamps)
+    std::int64_t nowNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+}
+
+// Constructor
+// Falls back to an empty cache if the file can't be used, the next save() replaces it
+ScanCache::ScanCache(const fs::path& cacheDir, const fs::path& root, std::int64_t racyWindowNs) {
+    std::error_code ec;
+    fs::path absolute = fs::absolute(root, ec);
+    m_root = (ec ? root : absolute).lexically_normal().generic_string();
+    if (m_root.size() > 1 && m_root.back() == '/') {
+        m_root.pop_back();
+    }
+
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.pcscan", static_cast<unsigned long long>(fnv1a(m_root)));
+    m_file = cacheDir / name;
+    m_racyBeforeNs = nowNs() - racyWindowNs;
+
+    if (!load()) {
+        m_dirs.clear();
+        m_changed = true;
+    }
+}
+
+// Reads the whole file at once and parses it with a bounds-checked cursor
+bool ScanCache::load() {
+    std::ifstream in(m_file, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    const std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (data.size() < sizeof(Magic) || std::memcmp(data.data(), Magic, sizeof(Magic)) != 0) {
+        return false;
+    }
+
+    Reader reader{ data, sizeof(Magic) };
+    if (reader.get<std::uint32_t>() != Version || reader.getString() != m_root) {
+        return false;
+    }
+    const std::uint32_t count = reader.get<std::uint32_t>();
+    m_dirs.reserve(count);
+    for (std::uint32_t i = 0; i < count && reader.ok; ++i) {
+        std::string key = reader.getString();
+        Record record;
+        record.stamp.mtimeNs = reader.get<std::int64_t>();
+        record.stamp.ctimeNs = reader.get<std::int64_t>();
+        record.stamp.valid = true;
+        const std::uint32_t count = reader.get<std::uint32_t>();
+        auto entries = std::make_shared<std::vector<DirectoryEntry>>();
+        entries->reserve(std::min<std::uint32_t>(count, 65536));
+        for (std::uint32_t e = 0; e < count && reader.ok; ++e) {
+            DirectoryEntry entry;
+            const std::uint8_t type = reader.get<std::uint8_t>();
+            entry.type = type <= static_cast<std::uint8_t>(EntryType::Other) ? static_cast<EntryType>(type) : EntryType::Other;
+            entry.name = reader.getString();
+            entries->push_back(std::move(entry));
+        }
+        record.entries = std::move(entries);
+        m_dirs.emplace(std::move(key), std::move(record));
+    }
+    return reader.ok && reader.pos == data.size();
+}
+
+// One stat per directory: statx on Linux, stat on other POSIX systems, the write time on Windows
+ScanCache::Stamp ScanCache::stampOf(const fs::path& dir) {
+    Stamp stamp;
+#if defined(__linux__) && defined(STATX_MTIME)
+    struct statx stx {};
+    if (::statx(AT_FDCWD, dir.c_str(), 0, STATX_TYPE | STATX_MTIME | STATX_CTIME, &stx) == 0) {
+        if (!S_ISDIR(stx.stx_mode)) return stamp;
+        stamp.mtimeNs = static_cast<std::int64_t>(stx.stx_mtime.tv_sec) * 1000000000 + stx.stx_mtime.tv_nsec;
+        stamp.ctimeNs = static_cast<std::int64_t>(stx.stx_ctime.tv_sec) * 1000000000 + stx.stx_ctime.tv_nsec;
+        stamp.valid = true;
+        return stamp;
+    }
+    if (errno != ENOSYS) return stamp;
+#endif
+#ifndef _WIN32
+    struct stat st {};
+    if (::stat(dir.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) {
+        return stamp;
+    }
+    stamp.mtimeNs = static_cast<std::int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    stamp.ctimeNs = static_cast<std::int64_t>(st.st_ctim.tv_sec) * 1000000000 + st.st_ctim.tv_nsec;
+    stamp.valid = true;
+#else
+    std::error_code ec;
+    const fs::file_time_type time = fs::last_write_time(dir, ec);
+    if (ec) return stamp;
+    stamp.mtimeNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::file_clock::to_sys(time).time_since_epoch()).count();
+    stamp.valid = true;
+#endif
+    return stamp;
+}
+
+// A hit needs the same mtime and ctime as recorded; the record is kept for save() either way
+std::shared_ptr<const std::vector<DirectoryEntry>> ScanCache::lookup(const fs::path& dir, const fs::path& relativeDir, Stamp& stamp) {
+    stamp = stampOf(dir);
+    if (stamp.valid) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const auto it = m_dirs.find(relativeDir.generic_string());
+        if (it != m_dirs.end() && it->second.stamp == stamp) {
+            it->second.visited = true;
+            ++m_hits;
+            return it->second.entries;
+        }
+    }
+    ++m_misses;
+    return nullptr;
+}
+
+// Replaces the record with what was just read
+void ScanCache::store(const fs::path& relativeDir, const Stamp& stamp, std::vector<DirectoryEntry> entries) {
+    Record record;
+    record.stamp = stamp;
+    record.entries = std::make_shared<const std::vector<DirectoryEntry>>(std::move(entries));
+    record.visited = true;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_dirs[relativeDir.generic_string()] = std::move(record);
+    m_changed = true;
+}
+
+// Written to a temporary file first, so an interrupted run never leaves a truncated cache behind
+void ScanCache::save() const {
+    std::string out(Magic, sizeof(Magic));
+    put<std::uint32_t>(out, Version);
+    putString(out, m_root);
+
+    const size_t countPos = out.size();
+    put<std::uint32_t>(out, 0);
+    std::uint32_t count = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        // Racy: a change in the same timestamp tick as the recorded stamp would not be seen next time
+        auto keep = [&](const Record& record) {
+            return record.visited && record.stamp.valid &&
+                record.stamp.mtimeNs < m_racyBeforeNs && record.stamp.ctimeNs < m_racyBeforeNs;
+        };
+        // Nothing stored and nothing dropped: the file would be written back byte for byte
+        if (!m_changed && std::all_of(m_dirs.begin(), m_dirs.end(), [&](const auto& dir) { return keep(dir.second); })) {
+            return;
+        }
+        for (const auto& [key, record] : m_dirs) {
+            if (!keep(record)) {
+                continue;
+            }
+            putString(out, key);
+            put<std::int64_t>(out, record.stamp.mtimeNs);
+            put<std::int64_t>(out, record.stamp.ctimeNs);
+            put<std::uint32_t>(out, static_cast<std::uint32_t>(record.entries->size()));
+            for (const auto& entry : *record.entries) {
+                put<std::uint8_t>(out, static_cast<std::uint8_t>(entry.type));
+                putString(out, entry.name);
+            }
+            ++count;
+        }
+    }
+    std::memcpy(out.data() + countPos, &count, sizeof(count));
+
+    if (!m_file.parent_path().empty()) {
+        fs::create_directories(m_file.parent_path());
+    }
+    const fs::path temp = fs::path(m_file).concat(".tmp");
+    {
+        std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+        file.write(out.data(), static_cast<std::streamsize>(out.size()));
+        if (!file) {
+            throw fs::filesystem_error("cannot write scan cache", temp, std::make_error_code(std::errc::io_error));
+        }
+    }
+    fs::rename(temp, m_file);
+}
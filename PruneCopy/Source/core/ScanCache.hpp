@@ -0,0 +1,134 @@
+/*****************************************************************//**
+ * @file   ScanCache.hpp
+ * @brief  Persistent per-source cache of directory entries, validated
+ *         by the directory's mtime/ctime (--scan-cache)
+ *
+ * @author Patrik Neunteufel
+ * @date   May 2025
+ *********************************************************************/
+
+#pragma once
+#include <string>
+#include <vector>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <filesystem>
+#include <unordered_map>
+
+#include "core/DirectoryReader.hpp"
+
+/**
+ * @brief Remembers the entries of every scanned directory between runs.
+ *
+ * Adding, removing or renaming an entry updates the directory's mtime and
+ * ctime, so a directory whose stamp is unchanged since the last run can be
+ * served from the cache with a single stat instead of being read again. The
+ * entries are stored unfiltered (name and type), so the filters, rules and
+ * ignore files of the current run are applied as usual and a cache stays
+ * valid when they change; file sizes and mtimes are never cached.
+ *
+ * One cache file per source root lives in the cache directory. Directories
+ * that changed within racyWindowNs before the run started are not saved,
+ * because a later change in the same timestamp tick would go unnoticed.
+ * Only directories visited in this run are written back. lookup() and
+ * store() may be called from several walker threads.
+ */
+class ScanCache {
+public:
+	static constexpr std::int64_t DefaultRacyWindowNs = 2000000000; ///< Coarse directory timestamps (FAT: 2s)
+
+	/**
+	 * @brief Modification and change time of a directory.
+	 */
+	struct Stamp {
+		std::int64_t mtimeNs = 0; // Last modification (entries added, removed, renamed)
+		std::int64_t ctimeNs = 0; // Last status change (0 where the platform has none)
+		bool valid = false;       // Whether the directory could be stat'ed
+
+		bool operator==(const Stamp& other) const = default;
+	};
+
+	/**
+	 * @brief Loads the cache of a source root; a missing, foreign or damaged file starts an empty cache (never throws).
+	 *
+	 * @param cacheDir Directory holding the cache files (PruneOptions::scanCacheDir)
+	 * @param root Source root the cache belongs to
+	 * @param racyWindowNs Directories changed this close to the start of the run are not saved
+	 */
+	ScanCache(const std::filesystem::path& cacheDir, const std::filesystem::path& root,
+		std::int64_t racyWindowNs = DefaultRacyWindowNs);
+
+	/**
+	 * @brief Reads the current stamp of a directory (one stat call).
+	 */
+	static Stamp stampOf(const std::filesystem::path& dir);
+
+	/**
+	 * @brief Returns the cached entries of a directory if its stamp is unchanged.
+	 *
+	 * @param dir The directory
+	 * @param relativeDir The directory relative to the root (cache key)
+	 * @param stamp Receives the current stamp (pass it to store() after reading the directory on a miss)
+	 * @return The cached entries (shared, not copied), nullptr on a miss
+	 */
+	std::shared_ptr<const std::vector<DirectoryEntry>> lookup(const std::filesystem::path& dir,
+		const std::filesystem::path& relativeDir, Stamp& stamp);
+
+	/**
+	 * @brief Records the entries of a directory that was read from disk.
+	 *
+	 * @param relativeDir The directory relative to the root (cache key)
+	 * @param stamp Stamp taken before the directory was read
+	 * @param entries All entries of the directory
+	 */
+	void store(const std::filesystem::path& relativeDir, const Stamp& stamp, std::vector<DirectoryEntry> entries);
+
+	/**
+	 * @brief Writes the directories visited in this run to the cache file (replaced atomically).
+	 *
+	 * Nothing is written if the file would stay the same (no directory read again, none dropped).
+	 * @throws std::filesystem::filesystem_error if the file can't be written
+	 */
+	void save() const;
+
+	/**
+	 * @brief Cache file of this source root.
+	 */
+	const std::filesystem::path& file() const { return m_file; }
+
+	/**
+	 * @brief Directories served from the cache in this run.
+	 */
+	size_t hits() const { return m_hits; }
+
+	/**
+	 * @brief Directories read from disk in this run.
+	 */
+	size_t misses() const { return m_misses; }
+
+private:
+	/**
+	 * @brief One cached directory.
+	 */
+	struct Record {
+		Stamp stamp;
+		std::shared_ptr<const std::vector<DirectoryEntry>> entries;
+		bool visited = false; // Seen in this run (only these are saved)
+	};
+
+	/**
+	 * @brief Parses the cache file; returns false if it is damaged or belongs to another root.
+	 */
+	bool load();
+
+	std::filesystem::path m_file;                      ///< Cache file of this root
+	std::string m_root;                                ///< Absolute source root (stored in the file)
+	std::int64_t m_racyBeforeNs = 0;                   ///< Stamps at or after this time are not saved
+	mutable std::mutex m_mutex;                        ///< Guards m_dirs
+	std::unordered_map<std::string, Record> m_dirs;    ///< Generic relative directory path -> record
+	std::atomic<size_t> m_hits{ 0 };                   ///< Directories served from the cache
+	std::atomic<size_t> m_misses{ 0 };                 ///< Directories read from disk
+	bool m_changed = false;                            ///< Records stored or file unusable (guarded by m_mutex)
+};
@@ -1,9 +1,282 @@
 /*****************************************************************//**
  * @file   TaskPlanner.cpp
- * @brief  
+ * @brief  Implements filtering, target resolution and conflict handling
+ *         that turn scanned files into FileTasks
  * 
  * @author Patrik Neunteufel
  * @date   April 2025
  *********************************************************************/
 
-#include "core/TaskPlanner.hpp"
\ No newline at end of file
+#include "core/TaskPlanner.hpp"
+
+#include <string>
+#include <algorithm>
+
+#include "core/DestinationIndex.hpp"
+#include "core/DirectoryWalker.hpp"
+#include "core/PromptBroker.hpp"
+#include "util/FilterSet.hpp"
+#include "log/LogManager.hpp"
+
+namespace fs = std::filesystem;
+
+// Constructor
+// Works directly on the options of the owning copier so sticky prompt answers stay in effect
+TaskPlanner::TaskPlanner(PruneOptions& options, std::ofstream* logFile)
+    : m_options(options), m_logFile(logFile) {
+}
+
+// Logs pruned directories and plans every file of a directory listing
+void TaskPlanner::planListing(const DirectoryListing& listing, std::vector<FileTask>& tasks) {
+    for (const auto& dir : listing.skippedDirs) {
+        LogManager::log(LogType::Skipped, dir.string(), m_logFile);
+    }
+    for (size_t i = 0; i < listing.files.size(); ++i) {
+        const FileStat* known = i < listing.stats.size() && listing.stats[i].exists ? &listing.stats[i] : nullptr;
+        planFile(listing.relativeDir, listing.files[i], listing.pathState, tasks, known);
+    }
+}
+
+// Filters a single file and plans one task per destination
+void TaskPlanner::planFile(const fs::path& relativeDir, const fs::path& file,
+    const FilterSet::PathState& pathState, std::vector<FileTask>& tasks, const FileStat* knownStat) {
+    const std::string filename = file.filename().string();
+
+    // Rules, allowed file types and excluded files in one decision
+    switch (m_options.filters->classifyFile(filename, pathState)) {
+    case FilterSet::FileDecision::NotIncluded:
+        return;
+    case FilterSet::FileDecision::Excluded:
+        LogManager::log(LogType::Skipped, file.string(), m_logFile);
+        return;
+    default:
+        break;
+    }
+
+    // One stat call for size and mtime of the source (--only-newer always asks the filesystem)
+    const FileStat sourceStat = knownStat && !m_options.onlyNewer ? *knownStat : FileStat::of(file);
+    const std::uintmax_t size = sourceStat.size;
+
+    // Plan the copy for all destinations
+    for (const auto& dst : m_options.destinations) {
+        fs::path targetFile = resolveTargetPath(relativeDir, file, dst);
+        const fs::path resolvedTarget = targetFile;
+        bool exists = false;
+        bool outdated = false;
+
+        if (m_options.onlyNewer) {
+            // Incremental copy: a single stat of the target decides; unchanged targets are skipped,
+            // outdated ones are replaced without asking (targets planned earlier in this run stay conflicts)
+            const FileStat targetStat = statOnDisk(targetFile);
+            const bool planned = isPlanned(targetFile);
+            exists = planned || targetStat.exists;
+            if (targetStat.exists && !planned) {
+                if (!isOutdated(sourceStat, targetStat)) {
+                    LogManager::log(LogType::Skipped, targetFile.string() + " (up to date)", m_logFile);
+                    continue;
+                }
+                outdated = true;
+            }
+        }
+        else {
+            exists = targetExists(targetFile);
+        }
+
+        // File exists → resolve based on overwrite flags
+        if (exists && !outdated) {
+            if (m_options.noOverwrite) {
+                continue; // skip silently without any prompt
+            }
+            else if (m_options.forceOverwrite) {
+                // Do nothing: overwrite directly
+            }
+            else if (m_deferConflicts && !(m_options.flatten && m_options.flattenAutoRename)) {
+                // Leave the decision to the prompt broker
+                FileTask task;
+                task.source = file;
+                task.target = std::move(targetFile);
+                task.size = size;
+                task.action = TaskAction::Conflict;
+                tasks.push_back(std::move(task));
+                continue;
+            }
+            else if (m_options.flatten) {
+                if (!handleFlattenConflictPrompt(targetFile)) {
+                    continue; // user skipped or canceled
+                }
+                exists = (targetFile == resolvedTarget); // renamed targets are new files
+            }
+            else {
+                // Normal mode → prompt via classic handler
+                if (!handleOverwritePrompt(targetFile)) continue;
+            }
+        }
+
+        // A target written a second time gets a generation, so it's copied after the earlier write
+        FileTask task;
+        task.generation = planTarget(targetFile);
+
+        task.source = file;
+        task.target = std::move(targetFile);
+        task.size = size;
+        task.action = exists ? TaskAction::Overwrite : TaskAction::Copy;
+        tasks.push_back(std::move(task));
+    }
+}
+
+// Resolves the destination path for a file, considering flatten options
+// Purely lexical: the relative directory comes from the walker, so no filesystem call is needed
+fs::path TaskPlanner::resolveTargetPath(const fs::path& relativeDir, const fs::path& currentFile, const fs::path& destRoot) const {
+    // Flatten mode discards folder structure
+    if (m_options.flatten) {
+        std::string filename = currentFile.filename().string();
+
+        // Add flattened suffix from folder structure
+        if (m_options.flattenWithSuffix && !relativeDir.empty()) {
+            std::string prefix = relativeDir.string();
+            std::replace(prefix.begin(), prefix.end(), '\\', '_');
+            std::replace(prefix.begin(), prefix.end(), '/', '_');
+            filename = prefix + "_" + filename;
+        }
+
+        return destRoot / filename;
+    }
+
+    // Normal mode: preserve relative path under destination (an empty relativeDir would append a separator)
+    fs::path target = relativeDir.empty() ? destRoot : destRoot / relativeDir;
+    target /= currentFile.filename();
+    return target;
+}
+
+// Checks whether a target is already present on disk or was planned earlier in this run
+bool TaskPlanner::targetExists(const fs::path& target) const {
+    std::lock_guard<std::mutex> lock(m_targetsMutex);
+    return m_plannedTargets.count(target.string()) > 0 || existsOnDisk(target);
+}
+
+// Atomically reserves a target that is neither on disk nor planned yet
+bool TaskPlanner::claimTarget(const fs::path& target) {
+    std::lock_guard<std::mutex> lock(m_targetsMutex);
+    if (m_plannedTargets.count(target.string()) > 0 || existsOnDisk(target)) {
+        return false;
+    }
+    m_plannedTargets.insert(target.string());
+    return true;
+}
+
+// Uses the index for targets below an indexed destination, the filesystem for everything else
+bool TaskPlanner::existsOnDisk(const fs::path& target) const {
+    FileStat stat;
+    if (m_index && m_index->lookup(target, stat)) {
+        return stat.exists;
+    }
+    return fs::exists(target);
+}
+
+// Checks whether a target was already handed out in this run
+bool TaskPlanner::isPlanned(const fs::path& target) const {
+    std::lock_guard<std::mutex> lock(m_targetsMutex);
+    return m_plannedTargets.count(target.string()) > 0;
+}
+
+// Same source as existsOnDisk, but with size and mtime
+FileStat TaskPlanner::statOnDisk(const fs::path& target) const {
+    FileStat stat;
+    if (m_index && m_index->lookup(target, stat)) {
+        return stat;
+    }
+    return FileStat::of(target);
+}
+
+// Compare policy: a newer mtime (beyond the tolerance) and/or a different size marks the target outdated
+bool TaskPlanner::isOutdated(const FileStat& source, const FileStat& target) const {
+    if (m_options.compareSize && source.size != target.size) {
+        return true;
+    }
+    if (m_options.compareMtime && source.mtimeNs > target.mtimeNs + m_options.mtimeToleranceNs) {
+        return true;
+    }
+    return false;
+}
+
+// Sets the destination index used by existsOnDisk
+void TaskPlanner::setDestinationIndex(const DestinationIndex* index) {
+    m_index = index;
+}
+
+// Targets can only collide within one run when flattening or merging several sources
+// Generations only need to be ordered, so a plain counter suffices
+std::uint64_t TaskPlanner::planTarget(const fs::path& target) {
+    if (!m_options.flatten && m_options.sources.size() < 2) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(m_targetsMutex);
+    return m_plannedTargets.insert(target.string()).second ? 0 : ++m_generation;
+}
+
+// Enables deferred conflict handling (conflicts become tasks for the PromptBroker)
+void TaskPlanner::setDeferConflicts(bool defer) {
+    m_deferConflicts = defer;
+}
+
+// Prompts the user to confirm file overwrite unless forced globally
+bool TaskPlanner::handleOverwritePrompt(const fs::path& targetFile) {
+    switch (PromptBroker::askOverwrite(targetFile, m_logFile)) {
+    case PromptAnswer::Yes:
+        return true;
+    case PromptAnswer::All:
+        m_options.forceOverwrite = true;
+        return true;
+    case PromptAnswer::SkipAll:
+        m_options.noOverwrite = true;
+        return false;
+    default:
+        return false;
+    }
+}
+
+// Prompts user for flatten conflict resolution with suggested name and extended options
+bool TaskPlanner::handleFlattenConflictPrompt(std::filesystem::path& targetFile) {
+    const fs::path suggested = resolveFileNameConflict(targetFile);
+
+    // Auto-rename mode: no interaction
+    if (m_options.flattenAutoRename) {
+        targetFile = suggested;
+        return true;
+    }
+
+    const FlattenChoice choice = PromptBroker::askFlatten(targetFile, suggested,
+        [&](const fs::path& p) { return targetExists(p); }, m_logFile);
+
+    switch (choice.answer) {
+    case PromptAnswer::Yes:
+        return true; // Overwrite
+    case PromptAnswer::All:
+        m_options.forceOverwrite = true;
+        return true;
+    case PromptAnswer::AutoRenameAll:
+        m_options.flattenAutoRename = true;
+        [[fallthrough]];
+    case PromptAnswer::Rename:
+        targetFile = choice.target;
+        return true;
+    default:
+        return false; // Skip file
+    }
+}
+
+// Resolves name conflict by appending (1), (2), ... to filename until free
+fs::path TaskPlanner::resolveFileNameConflict(const fs::path& originalPath) const {
+    fs::path base = originalPath.parent_path();
+    std::string stem = originalPath.stem().string();
+    std::string ext = originalPath.extension().string();
+
+    int counter = 1;
+    fs::path newPath;
+    do {
+        newPath = base / fs::path(stem + "(" + std::to_string(counter) + ")" + ext);
+        ++counter;
+    } while (targetExists(newPath));
+
+    return newPath;
+}
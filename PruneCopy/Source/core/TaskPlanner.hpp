@@ -1,10 +1,188 @@
 /*****************************************************************//**
  * @file   TaskPlanner.hpp
- * @brief  
+ * @brief  Turns scanned files into FileTasks (filtering, target
+ *         resolution and overwrite decisions)
  * 
  * @author Patrik Neunteufel
  * @date   April 2025
  *********************************************************************/
 
 #pragma once
+#include <string>
+#include <vector>
+#include <fstream>
+#include <filesystem>
+#include <unordered_set>
+#include <mutex>
+#include <cstdint>
 
+#include "core/PruneOptions.hpp"
+#include "core/FileTask.hpp"
+#include "util/FileStat.hpp"
+
+struct DirectoryListing;
+class DestinationIndex;
+
+/**
+ * @brief Producer side of the copy pipeline.
+ *
+ * Applies the file filters, resolves the target path per destination and
+ * settles conflicts (prompting the user if required). Everything that may
+ * need console interaction happens here, so the resulting FileTasks can be
+ * executed by any number of worker threads.
+ */
+class TaskPlanner {
+public:
+	/**
+	 * @brief Constructs a planner working on the given options.
+	 *
+	 * @param options Options of the running copy operation; prompt answers like
+	 *                [a]ll or [s]kip all are stored back into them
+	 * @param logFile Optional pointer to an ofstream for logging output
+	 */
+	TaskPlanner(PruneOptions& options, std::ofstream* logFile = nullptr);
+
+	/**
+	 * @brief Logs pruned directories and plans all files of a directory listing
+	 *
+	 * @param listing the listing produced by the DirectoryWalker
+	 * @param tasks receives the planned tasks
+	 */
+	void planListing(const DirectoryListing& listing, std::vector<FileTask>& tasks);
+
+	/**
+	 * @brief Filters a single file and appends one task per destination it has to be copied to
+	 *
+	 * @param relativeDir directory of the file relative to the source root (DirectoryListing::relativeDir)
+	 * @param file the file to plan
+	 * @param pathState path pattern state of the file's directory (DirectoryListing::pathState)
+	 * @param tasks receives the planned tasks
+	 * @param knownStat size and mtime already known for the file (e.g. from the git index), nullptr to stat it
+	 */
+	void planFile(const std::filesystem::path& relativeDir, const std::filesystem::path& file,
+		const FilterSet::PathState& pathState, std::vector<FileTask>& tasks, const FileStat* knownStat = nullptr);
+
+	/**
+	 * @brief Resolves the final destination path for a given file, based on options and mode
+	 *
+	 * Built lexically from the relative directory the walker carries along,
+	 * without asking the filesystem (no fs::relative / canonicalization).
+	 *
+	 * @param relativeDir directory of the file relative to the source root (empty for the root)
+	 * @param currentFile the current file being processed (only its filename is used)
+	 * @param destRoot root path of the destination directory
+	 * @return resolved target path for the file
+	 */
+	std::filesystem::path resolveTargetPath(const std::filesystem::path& relativeDir,
+		const std::filesystem::path& currentFile,
+		const std::filesystem::path& destRoot) const;
+
+	/**
+	 * @brief Checks whether a target exists on disk or was already planned in this run (thread-safe)
+	 *
+	 * @param target the target file path
+	 * @return true, if writing the target would replace a file
+	 */
+	bool targetExists(const std::filesystem::path& target) const;
+
+	/**
+	 * @brief Reserves a target if it is neither on disk nor planned yet (thread-safe)
+	 *
+	 * @param target the target file path
+	 * @return true, if the target was free and is now reserved
+	 */
+	bool claimTarget(const std::filesystem::path& target);
+
+	/**
+	 * @brief Resolves filename conflicts by appending suffixes like (1), (2), ...
+	 *
+	 * @param originalPath Path where conflict might occur
+	 * @return Unique path that doesn't exist
+	 */
+	std::filesystem::path resolveFileNameConflict(const std::filesystem::path& originalPath) const;
+
+	/**
+	 * @brief Defers conflicts instead of prompting: they are emitted as TaskAction::Conflict
+	 * tasks and answered later by a PromptBroker
+	 *
+	 * @param defer true to defer conflict prompts
+	 */
+	void setDeferConflicts(bool defer);
+
+	/**
+	 * @brief Answers existence checks from a pre-built destination index instead of the filesystem
+	 *
+	 * @param index the index (must outlive the planning), nullptr to query the filesystem again
+	 */
+	void setDestinationIndex(const DestinationIndex* index);
+
+	/**
+	 * @brief Records a target written by a task of this run (flatten or several sources only)
+	 *
+	 * @param target the target file path
+	 * @return 0 for the first task writing the target, otherwise a generation greater than
+	 *         every one handed out before, which orders the task after the earlier writes (thread-safe)
+	 */
+	std::uint64_t planTarget(const std::filesystem::path& target);
+
+protected:
+
+	/**
+	 * @brief Checks the destination itself (index if available, otherwise the filesystem)
+	 *
+	 * @param target the target file path
+	 * @return true, if the target exists before this run
+	 */
+	bool existsOnDisk(const std::filesystem::path& target) const;
+
+	/**
+	 * @brief Checks whether a target was already handed out in this run (thread-safe)
+	 *
+	 * @param target the target file path
+	 * @return true, if the target was planned before
+	 */
+	bool isPlanned(const std::filesystem::path& target) const;
+
+	/**
+	 * @brief Reads size and mtime of an existing target (index if available, otherwise one stat call)
+	 *
+	 * @param target the target file path
+	 * @return the metadata (exists = false if there is no regular file)
+	 */
+	FileStat statOnDisk(const std::filesystem::path& target) const;
+
+	/**
+	 * @brief Decides for --only-newer whether the target is outdated
+	 * according to the compare policy (size and/or mtime with tolerance)
+	 *
+	 * @param source metadata of the source file
+	 * @param target metadata of the existing target
+	 * @return true, if the source has to be copied
+	 */
+	bool isOutdated(const FileStat& source, const FileStat& target) const;
+
+	/**
+	 * @brief Prompts the user how to handle an existing file when overwrite is not forced
+	 *
+	 * @param targetFile the target file path
+	 * @return true, if the user wants to overwrite the file
+	 */
+	bool handleOverwritePrompt(const std::filesystem::path& targetFile);
+
+	/**
+	 * @brief Prompts the user how to handle a file conflict when flattening is enabled
+	 *
+	 * @param targetFile the target file path
+	 * @return true, if the user wants to overwrite the file
+	 */
+	bool handleFlattenConflictPrompt(std::filesystem::path& targetFile);
+
+protected:
+	PruneOptions& m_options;                          ///< Options of the running operation (shared with the FileCopier)
+	std::ofstream* m_logFile;                         ///< Optional pointer to an ofstream for logging output
+	std::unordered_set<std::string> m_plannedTargets; ///< Targets already handed out in this run
+	mutable std::mutex m_targetsMutex;                ///< Guards m_plannedTargets (shared with the PromptBroker)
+	bool m_deferConflicts = false;                    ///< Emit conflicts as tasks instead of prompting
+	const DestinationIndex* m_index = nullptr;        ///< Optional destination index (read-only)
+	std::uint64_t m_generation = 0;                   ///< Last generation handed out (guarded by m_targetsMutex)
+};
@@ -0,0 +1,100 @@
+/*****************************************************************//**
+ * @file   TaskQueue.hpp
+ * @brief  Bounded blocking queue connecting the pipeline stages
+ *
+ * @author Patrik Neunteufel
+ * @date   May 2025
+ *********************************************************************/
+
+#pragma once
+#include <deque>
+#include <vector>
+#include <algorithm>
+#include <mutex>
+#include <condition_variable>
+
+/**
+ * @brief Thread-safe FIFO queue with a fixed capacity.
+ *
+ * push() blocks while the queue is full (back pressure for the producer),
+ * pop() blocks while it is empty. After close() producers are rejected and
+ * consumers drain the remaining items before pop() returns false.
+ *
+ * @tparam T Item type (must be movable)
+ */
+template <typename T>
+class TaskQueue {
+public:
+	/**
+	 * @brief Constructs a queue holding at most capacity items.
+	 * @param capacity Maximum number of queued items (at least 1)
+	 */
+	explicit TaskQueue(size_t capacity) : m_capacity(capacity == 0 ? 1 : capacity) {}
+
+	/**
+	 * @brief Appends an item, waiting while the queue is full.
+	 * @param item The item to enqueue
+	 * @return false if the queue was closed (item is dropped)
+	 */
+	bool push(T item) {
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_notFull.wait(lock, [&] { return m_closed || m_items.size() < m_capacity; });
+		if (m_closed) return false;
+		m_items.push_back(std::move(item));
+		m_notEmpty.notify_one();
+		return true;
+	}
+
+	/**
+	 * @brief Takes the oldest item, waiting while the queue is empty.
+	 * @param item Receives the dequeued item
+	 * @return false if the queue is closed and fully drained
+	 */
+	bool pop(T& item) {
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_notEmpty.wait(lock, [&] { return m_closed || !m_items.empty(); });
+		if (m_items.empty()) return false;
+		item = std::move(m_items.front());
+		m_items.pop_front();
+		m_notFull.notify_one();
+		return true;
+	}
+
+	/**
+	 * @brief Takes up to max of the oldest items, waiting while the queue is empty.
+	 * @param items Receives the dequeued items (cleared first)
+	 * @param max Maximum number of items to take (at least 1)
+	 * @return false if the queue is closed and fully drained
+	 */
+	bool popBatch(std::vector<T>& items, size_t max) {
+		items.clear();
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_notEmpty.wait(lock, [&] { return m_closed || !m_items.empty(); });
+		if (m_items.empty()) return false;
+		const size_t count = std::min(std::max<size_t>(max, 1), m_items.size());
+		for (size_t i = 0; i < count; ++i) {
+			items.push_back(std::move(m_items.front()));
+			m_items.pop_front();
+		}
+		m_notFull.notify_all();
+		return true;
+	}
+
+	/**
+	 * @brief Closes the queue: no more pushes, wakes all waiting threads.
+	 */
+	void close() {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_closed = true;
+		m_notFull.notify_all();
+		m_notEmpty.notify_all();
+	}
+
+private:
+	std::mutex m_mutex;                   ///< Guards all members below
+	std::condition_variable m_notFull;    ///< Signalled when space becomes available
+	std::condition_variable m_notEmpty;   ///< Signalled when an item was added
+	std::deque<T> m_items;                ///< Queued items
+	size_t m_capacity;                    ///< Maximum queue length
+	bool m_closed = false;                ///< Set by close()
+};
@@ -0,0 +1,393 @@
+/*****************************************************************//**
+ * @file   UringCopier.cpp
+ * @brief  Implements the batched io_uring copy backend
+ *
+ * @author Patrik Neunteufel
+ * @date   May 2025
+ *********************************************************************/
+
+#include "core/UringCopier.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+#include <system_error>
+#include <vector>
+
+#if defined(__linux__) && defined(PRUNECOPY_WITH_URING) && __has_include(<liburing.h>)
+#define PRUNECOPY_HAS_URING 1
+#include <liburing.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+#ifdef PRUNECOPY_HAS_URING
+
+namespace {
+
+    constexpr unsigned kChunkSize = 256 * 1024; // bytes per read/write submission
+    constexpr int kDrainRetries = 100;         // transient wait errors tolerated while draining a failed ring
+
+    // Steps of a single file, in order
+    enum class Step { OpenSource = 0, Stat, StatTarget, OpenTarget, Read, Write, CloseSource, CloseTarget, Count };
+
+    struct Slot;
+
+    // user_data of a submission: which file and which step completed
+    struct Op {
+        Slot* slot = nullptr;
+        Step step = Step::OpenSource;
+    };
+
+    // Memory the kernel writes into while a file is in flight
+    struct SlotBuffers {
+        struct statx source {};
+        struct statx target {};
+        std::vector<char> data;
+    };
+
+    // State of one file in flight
+    struct Slot {
+        const FileTask* task = nullptr;
+        int source = -1;
+        int target = -1;
+        bool targetExists = false;     // the target statx succeeded
+        std::unique_ptr<SlotBuffers> io = std::make_unique<SlotBuffers>();
+        std::uint64_t offset = 0;      // bytes copied so far
+        unsigned chunkLength = 0;      // bytes of the current chunk
+        unsigned chunkWritten = 0;     // bytes of the current chunk already written
+        int pending = 0;               // submissions not yet completed
+        int error = 0;                 // first errno of this file
+        const char* what = nullptr;    // error message if not a plain failed call
+        Op ops[static_cast<int>(Step::Count)];
+    };
+
+}
+
+struct UringCopier::Ring {
+    io_uring ring{};
+};
+
+// Constructor
+// Sets up the ring and probes the required opcodes (openat/statx/read/write/close need Linux 5.6)
+// A file has at most three submissions queued at once (openat + two statx), so the queue never fills up
+UringCopier::UringCopier(unsigned depth)
+    : m_depth(depth == 0 ? 1 : depth) {
+    auto ring = std::make_unique<Ring>();
+    if (io_uring_queue_init(m_depth * 3, &ring->ring, 0) < 0) return; // no io_uring (ENOSYS, EPERM, ...)
+
+    io_uring_probe* probe = io_uring_get_probe_ring(&ring->ring);
+    bool supported = probe != nullptr;
+    for (int op : { IORING_OP_OPENAT, IORING_OP_STATX, IORING_OP_READ, IORING_OP_WRITE, IORING_OP_CLOSE }) {
+        supported = supported && io_uring_opcode_supported(probe, op);
+    }
+    if (probe) io_uring_free_probe(probe);
+
+    if (!supported) {
+        io_uring_queue_exit(&ring->ring);
+        return;
+    }
+    m_ring = std::move(ring);
+}
+
+// Destructor
+UringCopier::~UringCopier() {
+    if (m_ring) io_uring_queue_exit(&m_ring->ring);
+}
+
+// Keeps up to m_depth files in flight; each completion advances its file by one step
+void UringCopier::copy(std::span<const FileTask> tasks, const CopiedHandler& onCopied) {
+    if (!m_ring) throw std::logic_error("io_uring is not available");
+    io_uring* ring = &m_ring->ring;
+
+    std::vector<Slot> slots(std::min<size_t>(m_depth, tasks.size()));
+    std::vector<Slot*> freeSlots;
+    for (auto& slot : slots) {
+        slot.io->data.resize(kChunkSize);
+        for (int i = 0; i < static_cast<int>(Step::Count); ++i) {
+            slot.ops[i] = { &slot, static_cast<Step>(i) };
+        }
+        freeSlots.push_back(&slot);
+    }
+
+    size_t next = 0;
+    size_t active = 0;
+    size_t inFlight = 0; // submitted to the kernel, completion not yet reaped
+    std::exception_ptr firstError;
+
+    // Hands the queued submissions to the kernel
+    auto flush = [&] {
+        const int ret = io_uring_submit(ring);
+        if (ret > 0) inFlight += static_cast<size_t>(ret);
+        return ret;
+    };
+
+    // The ring itself failed: the kernel may still write into the buffers (statx, read chunks) of
+    // every submission in flight, so all of them are reaped before the slots go out of scope.
+    // Nothing new is submitted; descriptors opened meanwhile are closed directly and the ring,
+    // which may still hold unsubmitted entries pointing at the slots, is torn down.
+    // If reaping fails as well, there is no way left to learn when the kernel is done (closing the
+    // ring cancels its requests asynchronously), so the buffers of the slots still waiting are
+    // released unfreed: at most m_depth of them, once per copier, as the ring is gone afterwards
+    auto failRing = [&](const char* what, int error) {
+        int transient = 0;
+        while (inFlight > 0) {
+            io_uring_cqe* cqe = nullptr;
+            const int ret = io_uring_wait_cqe(ring, &cqe);
+            if (ret == -EINTR) continue;
+            if ((ret == -EAGAIN || ret == -EBUSY) && ++transient < kDrainRetries) continue;
+            if (ret < 0) {
+                for (auto& slot : slots) {
+                    if (slot.pending > 0) static_cast<void>(slot.io.release());
+                }
+                break;
+            }
+            const Op* op = static_cast<const Op*>(io_uring_cqe_get_data(cqe));
+            const int res = cqe->res;
+            io_uring_cqe_seen(ring, cqe);
+            --inFlight;
+            --op->slot->pending;
+            if (res >= 0 && (op->step == Step::OpenSource || op->step == Step::OpenTarget)) {
+                ::close(res);
+            }
+        }
+        for (auto& slot : slots) {
+            if (slot.source >= 0) ::close(slot.source);
+            if (slot.target >= 0) ::close(slot.target);
+        }
+        io_uring_queue_exit(ring);
+        m_ring.reset();
+        throw fs::filesystem_error(what, std::error_code(error, std::generic_category()));
+    };
+
+    // Queues a submission for the slot (flushes the submission queue if it is full)
+    auto submit = [&](Slot& slot, Step step, auto prepare) {
+        io_uring_sqe* sqe = io_uring_get_sqe(ring);
+        while (!sqe) {
+            const int ret = flush();
+            if (ret < 0 && ret != -EINTR && ret != -EAGAIN && ret != -EBUSY) {
+                failRing("io_uring_submit failed", -ret);
+            }
+            sqe = io_uring_get_sqe(ring);
+        }
+        prepare(sqe);
+        io_uring_sqe_set_data(sqe, &slot.ops[static_cast<int>(step)]);
+        ++slot.pending;
+    };
+
+    auto fail = [](Slot& slot, int error) {
+        if (slot.error == 0) slot.error = error;
+    };
+
+    auto finish = [&](Slot& slot) {
+        if (slot.error == 0) {
+            try {
+                onCopied(*slot.task);
+            }
+            catch (...) {
+                if (!firstError) firstError = std::current_exception();
+            }
+        }
+        else if (!firstError) {
+            firstError = std::make_exception_ptr(fs::filesystem_error(slot.what ? slot.what : "io_uring copy failed",
+                slot.task->source, slot.task->target, std::error_code(slot.error, std::generic_category())));
+        }
+        freeSlots.push_back(&slot);
+        --active;
+    };
+
+    auto closeFiles = [&](Slot& slot) {
+        if (slot.source >= 0) submit(slot, Step::CloseSource, [&](io_uring_sqe* e) { io_uring_prep_close(e, slot.source); });
+        if (slot.target >= 0) submit(slot, Step::CloseTarget, [&](io_uring_sqe* e) { io_uring_prep_close(e, slot.target); });
+        slot.source = slot.target = -1;
+        if (slot.pending == 0) finish(slot);
+    };
+
+    auto readNext = [&](Slot& slot) {
+        if (slot.offset >= slot.io->source.stx_size) {
+            closeFiles(slot);
+            return;
+        }
+        slot.chunkLength = static_cast<unsigned>(std::min<std::uint64_t>(kChunkSize, slot.io->source.stx_size - slot.offset));
+        slot.chunkWritten = 0;
+        submit(slot, Step::Read, [&](io_uring_sqe* e) {
+            io_uring_prep_read(e, slot.source, slot.io->data.data(), slot.chunkLength, slot.offset);
+            });
+    };
+
+    auto writeChunk = [&](Slot& slot) {
+        submit(slot, Step::Write, [&](io_uring_sqe* e) {
+            io_uring_prep_write(e, slot.target, slot.io->data.data() + slot.chunkWritten,
+                slot.chunkLength - slot.chunkWritten, slot.offset + slot.chunkWritten);
+            });
+    };
+
+    auto start = [&](Slot& slot, const FileTask& task) {
+        slot.task = &task;
+        slot.source = slot.target = -1;
+        slot.targetExists = false;
+        slot.offset = 0;
+        slot.pending = 0;
+        slot.error = 0;
+        slot.what = nullptr;
+        submit(slot, Step::OpenSource, [&](io_uring_sqe* e) {
+            io_uring_prep_openat(e, AT_FDCWD, task.source.c_str(), O_RDONLY | O_CLOEXEC, 0);
+            });
+        submit(slot, Step::Stat, [&](io_uring_sqe* e) {
+            io_uring_prep_statx(e, AT_FDCWD, task.source.c_str(), 0, STATX_MODE | STATX_SIZE | STATX_INO, &slot.io->source);
+            });
+        // For the same-file check below; a failure just means there is no target yet
+        submit(slot, Step::StatTarget, [&](io_uring_sqe* e) {
+            io_uring_prep_statx(e, AT_FDCWD, task.target.c_str(), 0, STATX_INO, &slot.io->target);
+            });
+    };
+
+    // Advances a file after one of its submissions completed
+    auto complete = [&](const Op& op, int res) {
+        Slot& slot = *op.slot;
+        --slot.pending;
+
+        switch (op.step) {
+        case Step::OpenSource:
+        case Step::Stat:
+        case Step::StatTarget:
+            if (op.step == Step::StatTarget) slot.targetExists = res == 0;
+            else if (res < 0) fail(slot, -res);
+            else if (op.step == Step::OpenSource) slot.source = res;
+            if (slot.pending > 0) return; // wait for the other two
+            if (slot.error) {
+                closeFiles(slot);
+                return;
+            }
+            // Never truncate the source by copying a file onto itself (same check as CopyEngine)
+            if (slot.targetExists &&
+                slot.io->target.stx_dev_major == slot.io->source.stx_dev_major &&
+                slot.io->target.stx_dev_minor == slot.io->source.stx_dev_minor &&
+                slot.io->target.stx_ino == slot.io->source.stx_ino) {
+                slot.what = "source and target are the same file";
+                fail(slot, EEXIST);
+                closeFiles(slot);
+                return;
+            }
+            submit(slot, Step::OpenTarget, [&](io_uring_sqe* e) {
+                io_uring_prep_openat(e, AT_FDCWD, slot.task->target.c_str(),
+                    O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, slot.io->source.stx_mode & 07777);
+                });
+            return;
+
+        case Step::OpenTarget:
+            if (res < 0) {
+                fail(slot, -res);
+                closeFiles(slot);
+                return;
+            }
+            slot.target = res;
+            // openat applies the umask to a new target and an existing one keeps its mode (as in CopyEngine)
+            ::fchmod(slot.target, slot.io->source.stx_mode & 07777);
+            readNext(slot);
+            return;
+
+        case Step::Read:
+            if (res < 0) {
+                fail(slot, -res);
+                closeFiles(slot);
+            }
+            else if (res == 0) {
+                closeFiles(slot); // source shrank while copying
+            }
+            else {
+                slot.chunkLength = static_cast<unsigned>(res);
+                writeChunk(slot);
+            }
+            return;
+
+        case Step::Write:
+            if (res <= 0) {
+                fail(slot, res < 0 ? -res : EIO);
+                closeFiles(slot);
+                return;
+            }
+            slot.chunkWritten += static_cast<unsigned>(res);
+            if (slot.chunkWritten < slot.chunkLength) {
+                writeChunk(slot); // short write
+                return;
+            }
+            slot.offset += slot.chunkLength;
+            readNext(slot);
+            return;
+
+        case Step::CloseSource:
+        case Step::CloseTarget:
+            if (res < 0 && op.step == Step::CloseTarget) fail(slot, -res); // delayed write errors
+            if (slot.pending == 0) finish(slot);
+            return;
+
+        default:
+            return;
+        }
+    };
+
+    while (next < tasks.size() || active > 0) {
+        while (!freeSlots.empty() && next < tasks.size()) {
+            Slot* slot = freeSlots.back();
+            freeSlots.pop_back();
+            ++active;
+            start(*slot, tasks[next++]);
+        }
+
+        int ret = flush();
+        if (ret < 0 && ret != -EINTR && ret != -EAGAIN && ret != -EBUSY) {
+            failRing("io_uring_submit failed", -ret);
+        }
+
+        io_uring_cqe* cqe = nullptr;
+        ret = io_uring_wait_cqe(ring, &cqe);
+        if (ret == -EINTR) continue;
+        if (ret < 0) {
+            failRing("io_uring_wait_cqe failed", -ret);
+        }
+
+        // Reap everything that is already complete
+        do {
+            const Op* op = static_cast<const Op*>(io_uring_cqe_get_data(cqe));
+            const int res = cqe->res;
+            io_uring_cqe_seen(ring, cqe);
+            --inFlight;
+            complete(*op, res);
+        } while (io_uring_peek_cqe(ring, &cqe) == 0);
+    }
+
+    if (firstError) {
+        std::rethrow_exception(firstError);
+    }
+}
+
+#else
+
+struct UringCopier::Ring {};
+
+// Constructor (built without io_uring support: never ready)
+UringCopier::UringCopier(unsigned depth)
+    : m_depth(depth == 0 ? 1 : depth) {
+}
+
+// Destructor
+UringCopier::~UringCopier() = default;
+
+// Not available in this build
+void UringCopier::copy(std::span<const FileTask>, const CopiedHandler&) {
+    throw std::logic_error("PruneCopy was built without io_uring support");
+}
+
+#endif
+
+// A ring only exists if setup and the opcode probe succeeded
+bool UringCopier::ready() const {
+    return m_ring != nullptr;
+}
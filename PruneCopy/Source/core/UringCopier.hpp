@@ -0,0 +1,74 @@
+/*****************************************************************//**
+ * @file   UringCopier.hpp
+ * @brief  Batched io_uring copy backend (Linux, optional at build time)
+ *
+ * @author Patrik Neunteufel
+ * @date   May 2025
+ *********************************************************************/
+
+#pragma once
+#include <span>
+#include <memory>
+#include <functional>
+
+#include "core/FileTask.hpp"
+
+/**
+ * @brief Copies many FileTasks at once through a single io_uring.
+ *
+ * Every file runs through openat + statx (source and target) -> openat(target)
+ * -> read/write chunks -> close, and up to depth files are in flight at the same time,
+ * so the syscalls of many small files are submitted in a few batches.
+ *
+ * Only compiled in with PRUNECOPY_WITH_URING and liburing (link -luring).
+ * Without it, or when the kernel lacks io_uring or one of the opcodes,
+ * ready() returns false and the caller uses the CopyEngine instead.
+ * A ring belongs to one thread.
+ */
+class UringCopier {
+public:
+	/**
+	 * @brief Handler called for every file that was copied completely
+	 */
+	using CopiedHandler = std::function<void(const FileTask&)>;
+
+	/**
+	 * @brief Sets up the ring.
+	 * @param depth Maximum number of files in flight (at least 1)
+	 */
+	explicit UringCopier(unsigned depth);
+
+	/**
+	 * @brief Releases the ring.
+	 */
+	~UringCopier();
+
+	UringCopier(const UringCopier&) = delete;
+	UringCopier& operator=(const UringCopier&) = delete;
+
+	/**
+	 * @brief Whether the ring is usable (built with liburing and supported by the kernel).
+	 */
+	bool ready() const;
+
+	/**
+	 * @brief Copies all tasks; target directories must exist.
+	 *
+	 * Failed files don't stop the other files in flight; the first error is
+	 * thrown once the batch has drained. A source that is the target itself
+	 * fails without being touched. If the ring itself fails, every submission
+	 * in flight is reaped before the error is thrown and the ring is closed
+	 * (ready() returns false afterwards). Should reaping fail too, the buffers
+	 * of the files still in flight stay allocated (at most depth of them).
+	 *
+	 * @param tasks Tasks to copy
+	 * @param onCopied Called (on this thread) for every completed file
+	 * @throws std::filesystem::filesystem_error for the first failed file or a failed ring
+	 */
+	void copy(std::span<const FileTask> tasks, const CopiedHandler& onCopied);
+
+private:
+	struct Ring;                  ///< liburing state (defined in the .cpp)
+	std::unique_ptr<Ring> m_ring; ///< Null if io_uring is not available
+	unsigned m_depth;             ///< Files in flight
+};
@@ -151,6 +151,8 @@ void LogManager::log(LogType type, const std::string& message, std::ostream* str
     std::string rawTag = tagFromType(type);              // Aligned tag (e.g., [Copied   ])
     std::string coloredTag = applyColor(level, rawTag);  // Apply color for terminal output
 
+    std::lock_guard<std::mutex> lock(s_mutex);
+
     // Only show on console if log level permits
     if (stream && stream == &std::cout && shouldLog(level)) {
         *stream << coloredTag << " " << message << std::endl;
@@ -181,6 +183,8 @@ void LogManager::log(LogLevel level, const std::string& message, std::ostream* s
     std::string rawTag = oss.str();
     std::string coloredTag = applyColor(level, rawTag);
 
+    std::lock_guard<std::mutex> lock(s_mutex);
+
     // Log to console if level is allowed
     if (stream && stream == &std::cout && shouldLog(level)) {
         *stream << coloredTag << " " << message << std::endl;
@@ -198,6 +202,7 @@ void LogManager::logAlwaysToConsole(LogType type, const std::string& message) {
     LogLevel level = logLevelFromType(type);
     std::string tag = tagFromType(type);
     std::string colored = applyColor(level, tag);
+    std::lock_guard<std::mutex> lock(s_mutex);
     std::cout << colored << " " << message << std::endl;
 }
 
@@ -205,6 +210,7 @@ void LogManager::logAlwaysToConsole(LogType type, const std::string& message) {
 void LogManager::logAlwaysToConsole(LogLevel level, const std::string& message) {
     std::string tag = tagFromType(LogType::Info); // Default label for level-based logging
     std::string colored = applyColor(level, tag);
+    std::lock_guard<std::mutex> lock(s_mutex);
     std::cout << colored << " " << message << std::endl;
 }
 
@@ -12,6 +12,7 @@
 #include <string>
 #include <fstream>
 #include <iostream>
+#include <mutex>
 
 #include "core/PruneOptions.hpp"
 
@@ -133,4 +134,5 @@ private:
 	static inline LogLevel s_consoleLogLevel = LogLevel::Info;  ///< Current log level for console output
 	static inline std::ofstream* s_logFile = nullptr;           ///< Output file stream for logging
 	static inline bool s_ansiColorEnabled = false;              ///< Flag to indicate if ANSI color codes are enabled
+	static inline std::mutex s_mutex;                           ///< Serializes output of concurrent copy workers
 };
@@ -9,6 +9,7 @@
 #include "log/LogManager.hpp"
 #include "core/PruneOptions.hpp"
 #include "test/TestRunner.hpp"
+#include "test/BenchmarkRunner.hpp"
 
 
 
@@ -40,6 +41,10 @@ int main(int argc, char* argv[]) {
         TestRunner::runAllTests();
         return 0;
     }
+    else if (ArgumentParser::checkBenchmark(argc, argv)) {
+        BenchmarkRunner::runAllBenchmarks();
+        return 0;
+    }
 
     try {
         // Parse arguments into PruneOptions and controlFlags and configure logging
@@ -87,10 +92,6 @@ int main(int argc, char* argv[]) {
             }
         }
 
-        // Preprocess patterns for filtering
-        auto typePatterns = PatternUtils::wildcardsToRegex(options.types);
-        auto excludeFilePatterns = PatternUtils::wildcardsToRegex(options.excludeFiles);
-
         // Set up logging to file, if enabled
         std::ofstream logFile;
         std::string logFilePath;
@@ -177,16 +178,12 @@ int main(int argc, char* argv[]) {
         // Run the file copy based on selected mode
         switch (options.parallelMode) {
         case ParallelMode::None:
+        case ParallelMode::Thread:
+        case ParallelMode::Async:
+        case ParallelMode::OpenMP:
             FileCopier::copyFiltered(options,
                 options.enableLogging ? &logFile : nullptr);
             break;
-        case ParallelMode::Async:
-            LogManager::log(LogLevel::Error, "Parallel async with user prompts not implemented.");
-            return 3;
-        case ParallelMode::Thread:
-        case ParallelMode::OpenMP:
-            LogManager::log(LogLevel::Error, "Parallel mode not yet implemented.");
-            return 2;
         }
 
         LogManager::log(LogLevel::Info, "Copy process completed successfully.");
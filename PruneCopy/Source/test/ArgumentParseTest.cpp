@@ -11,9 +11,12 @@
 
 #include "cli/ArgumentParser.hpp"
 #include "core/PruneOptions.hpp"
+#include "util/FilterSet.hpp"
 
 #include <iostream>
 #include <sstream>
+#include <stdexcept>
+#include <vector>
 
  // Entry point for running all ArgumentParser-related unit tests
 bool ArgumentParseTest::run() {
@@ -26,6 +29,9 @@ bool ArgumentParseTest::run() {
     success &= testColorMode();
     success &= testDeprecatedDetection();
     success &= testDeprecatedClear();
+    success &= testOnlyNewerOptions();
+    success &= testExcludeDirPatterns();
+    success &= testFilesFromStdin();
 
     // Report overall result
     if (success)
@@ -150,3 +156,98 @@ bool ArgumentParseTest::testDeprecatedClear() {
     return TestUtils::assertEqual(std::string(""), out.str(), "Deprecated: no output after clear");
 }
 
+// Tests the incremental copy options; --compare implies --only-newer
+bool ArgumentParseTest::testOnlyNewerOptions() {
+    const char* argv[] = {
+        "prunecopy",
+        "--source", "src",
+        "--destination", "dst",
+        "--compare", "size,mtime",
+        "--mtime-tolerance", "2"
+    };
+    int argc = sizeof(argv) / sizeof(argv[0]);
+    PruneOptions opts;
+    ParsedCliControl controlFlags;
+
+    ArgumentParser::parse(argc, const_cast<char**>(argv), opts, controlFlags);
+
+    bool success = true;
+    success &= TestUtils::assertTrue(opts.onlyNewer, "OnlyNewer: implied by --compare");
+    success &= TestUtils::assertTrue(opts.compareSize, "OnlyNewer: compare size");
+    success &= TestUtils::assertTrue(opts.compareMtime, "OnlyNewer: compare mtime");
+    success &= TestUtils::assertEqual(static_cast<long long>(2000000000), static_cast<long long>(opts.mtimeToleranceNs), "OnlyNewer: tolerance in ns");
+
+    const char* argvSize[] = { "prunecopy", "src", "dst", "--only-newer", "--compare", "size" };
+    PruneOptions sizeOpts;
+    ArgumentParser::parse(6, const_cast<char**>(argvSize), sizeOpts, controlFlags);
+    success &= TestUtils::assertTrue(sizeOpts.onlyNewer && sizeOpts.compareSize && !sizeOpts.compareMtime, "OnlyNewer: size only");
+
+    // Tolerances that don't fit the nanosecond count are rejected before converting
+    auto toleranceAccepted = [&](const char* seconds) {
+        const char* argvTolerance[] = { "prunecopy", "src", "dst", "--mtime-tolerance", seconds };
+        PruneOptions toleranceOpts;
+        try {
+            ArgumentParser::parse(5, const_cast<char**>(argvTolerance), toleranceOpts, controlFlags);
+            return true;
+        }
+        catch (const std::runtime_error&) {
+            return false;
+        }
+    };
+    success &= TestUtils::assertTrue(toleranceAccepted("1e9"), "OnlyNewer: tolerance of 1e9 seconds accepted");
+    success &= TestUtils::assertFalse(toleranceAccepted("-1"), "OnlyNewer: negative tolerance rejected");
+    success &= TestUtils::assertFalse(toleranceAccepted("1e10"), "OnlyNewer: tolerance above 1e9 seconds rejected");
+    success &= TestUtils::assertFalse(toleranceAccepted("nan"), "OnlyNewer: NaN tolerance rejected");
+
+    return success;
+}
+
+// Tests that --exclude-dirs is compiled into PruneOptions::filters by parse
+bool ArgumentParseTest::testExcludeDirPatterns() {
+    const char* argv[] = {
+        "prunecopy",
+        "--source", "src",
+        "--destination", "dst",
+        "--exclude-dirs", "build", ".git*"
+    };
+    int argc = sizeof(argv) / sizeof(argv[0]);
+    PruneOptions opts;
+    ParsedCliControl controlFlags;
+
+    ArgumentParser::parse(argc, const_cast<char**>(argv), opts, controlFlags);
+
+    bool success = true;
+    success &= TestUtils::assertTrue(opts.filters != nullptr, "ExcludeDirPatterns: compiled by parse");
+    if (!opts.filters) return false;
+    success &= TestUtils::assertEqual(static_cast<size_t>(2), opts.filters->excludeDirs().size(), "ExcludeDirPatterns: both patterns compiled");
+    success &= TestUtils::assertTrue(opts.filters->isExcludedDir("BUILD"), "ExcludeDirPatterns: build excluded (case-insensitive)");
+    success &= TestUtils::assertTrue(opts.filters->isExcludedDir(".github"), "ExcludeDirPatterns: .github excluded by .git*");
+    success &= TestUtils::assertFalse(opts.filters->isExcludedDir("builds"), "ExcludeDirPatterns: builds not excluded");
+    return success;
+}
+
+// Tests that --files-from - needs an overwrite policy, since prompts would read the list as answers
+bool ArgumentParseTest::testFilesFromStdin() {
+    auto accepted = [](std::vector<const char*> args) {
+        std::vector<const char*> argv = { "prunecopy", "--source", "src", "--destination", "dst", "--files-from", "-" };
+        argv.insert(argv.end(), args.begin(), args.end());
+        PruneOptions opts;
+        ParsedCliControl controlFlags;
+        try {
+            ArgumentParser::parse(static_cast<int>(argv.size()), const_cast<char**>(argv.data()), opts, controlFlags);
+            return true;
+        }
+        catch (const std::runtime_error&) {
+            return false;
+        }
+    };
+
+    bool success = true;
+    success &= TestUtils::assertFalse(accepted({}), "FilesFromStdin: rejected with prompts");
+    success &= TestUtils::assertTrue(accepted({ "--force-overwrite" }), "FilesFromStdin: --force-overwrite");
+    success &= TestUtils::assertTrue(accepted({ "--no-overwrite" }), "FilesFromStdin: --no-overwrite");
+    success &= TestUtils::assertTrue(accepted({ "--only-newer" }), "FilesFromStdin: --only-newer");
+    success &= TestUtils::assertFalse(accepted({ "--only-newer", "--flatten" }), "FilesFromStdin: flatten conflicts still prompt");
+    success &= TestUtils::assertTrue(accepted({ "--only-newer", "--flatten", "--flatten-auto-rename" }), "FilesFromStdin: flatten auto-rename");
+    return success;
+}
@@ -53,5 +53,23 @@ private:
      * @return True if no output is generated after clearing.
      */
     static bool testDeprecatedClear();
+
+    /**
+     * @brief Tests parsing of --only-newer, --compare and --mtime-tolerance.
+     * @return True if the incremental copy options are parsed correctly.
+     */
+    static bool testOnlyNewerOptions();
+
+    /**
+     * @brief Tests that parse compiles the exclude-dir patterns once.
+     * @return True if the compiled patterns match like the raw ones.
+     */
+    static bool testExcludeDirPatterns();
+
+    /**
+     * @brief Tests that --files-from - is rejected while conflict prompts could read stdin.
+     * @return True if only prompt-free combinations are accepted.
+     */
+    static bool testFilesFromStdin();
 };
 
@@ -11,10 +11,15 @@
 #include "../util/ConvertUtils.hpp"
 #include "../util/PathUtils.hpp"
 #include "../util/PatternUtils.hpp"
+#include "../util/FilterSet.hpp"
+#include "../util/IgnoreStack.hpp"
 #include "../core/PruneOptions.hpp"
 
 #include <iostream>
 #include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
 
 namespace fs = std::filesystem;
 
@@ -32,6 +37,24 @@ bool BasicFunctionTest::run() {
     // Validate wildcard and regex pattern utility logic
     success &= testPatternUtils();
 
+    // Validate compiled glob matching against the regex conversions
+    success &= testGlobPattern();
+
+    // Validate the classified matchers of FilterSet
+    success &= testFilterSet();
+
+    // Validate the combined multi-pattern automaton
+    success &= testGlobAutomaton();
+
+    // Validate path patterns evaluated level by level
+    success &= testPathPatterns();
+
+    // Validate ordered rules (first match wins)
+    success &= testRuleSet();
+
+    // Validate layered .gitignore / .prunecopyignore matchers
+    success &= testIgnoreStack();
+
     // Validate default state and parsing logic of PruneOptions
     success &= testPruneOptionsParsing();
 
@@ -119,11 +142,8 @@ bool BasicFunctionTest::testPruneOptionsParsing() {
     options.flatten = true;
     options.parallelMode = ParallelMode::Async;
 
-    // Simulate pre-parsed regex patterns
-    options.typePatterns = {
-        std::regex(R"(.*\.cpp)"),
-        std::regex(R"(.*\.hpp)")
-    };
+    // Simulate pre-compiled patterns
+    options.filters = std::make_shared<const FilterSet>(options.types, options.excludeFiles, options.excludeDirs);
 
     bool success = true;
 
@@ -134,7 +154,263 @@ bool BasicFunctionTest::testPruneOptionsParsing() {
     success &= TestUtils::assertEqual(std::string("test"), options.excludeDirs[0], "PruneOptions 'excludeDirs' entry check");
     success &= TestUtils::assertTrue(options.flatten, "PruneOptions 'flatten' flag set");
     success &= TestUtils::assertTrue(options.parallelMode == ParallelMode::Async, "PruneOptions 'parallelMode' set to Async");
-    success &= TestUtils::assertTrue(options.typePatterns.size() == 2, "PruneOptions 'typePatterns' size check");
+    success &= TestUtils::assertTrue(options.filters->types().size() == 2, "PruneOptions 'filters' types size check");
+    success &= TestUtils::assertTrue(options.filters->isExcludedDir("test"), "PruneOptions 'filters' excludeDirs check");
+
+    return success;
+}
+
+// Compares GlobPattern with the regex it replaces for both conversions on a table of names
+bool BasicFunctionTest::testGlobPattern() {
+    const std::vector<std::string> patterns = {
+        "*.txt", "*.TXT", "file?.txt", "*", "?", "", "a*b*c", "*a*", "**", "*.tar.gz",
+        "test", "*Test.cpp", "x?*?y", "[ab].txt", "a+b.txt", "(tmp)*", "a{2}.txt", "a|b"
+    };
+    const std::vector<std::string> names = {
+        "", "a", "file.txt", "FILE.TXT", "file1.txt", "file12.txt", "abc", "aXbYc", "acb",
+        "archive.tar.gz", "test", "Test", "MainTest.cpp", "xy", "xay", "xaby", "a.txt", "b.txt",
+        "[ab].txt", "aab.txt", "a+b.txt", "tmp", "(tmp)x", "a.h", "aa.txt", "a|b", "b",
+        "line\nbreak.txt", "file\n.txt", "\xC3\x84rger.txt"
+    };
+
+    bool success = true;
+    for (const auto& pattern : patterns) {
+        const PatternUtils::GlobPattern glob(pattern, PatternUtils::GlobSyntax::Glob);
+        const PatternUtils::GlobPattern wildcard(pattern, PatternUtils::GlobSyntax::Wildcard);
+        const std::vector<std::regex> globRegex = PatternUtils::convertToRegex({ pattern });
+        const std::vector<std::regex> wildcardRegex = PatternUtils::wildcardsToRegex({ pattern });
+
+        for (const auto& name : names) {
+            if (glob.matches(name) != PatternUtils::matchesPattern(name, globRegex)) {
+                success &= TestUtils::assertTrue(false, "GlobPattern parity (glob) '" + pattern + "' with '" + name + "'");
+            }
+            if (wildcard.matches(name) != PatternUtils::matchesPattern(name, wildcardRegex)) {
+                success &= TestUtils::assertTrue(false, "GlobPattern parity (wildcard) '" + pattern + "' with '" + name + "'");
+            }
+        }
+    }
+    success &= TestUtils::assertTrue(success, "GlobPattern matches like the regex conversions");
+
+    // Only patterns with regex syntax need the fallback
+    success &= TestUtils::assertFalse(PatternUtils::GlobPattern("*.cpp").usesRegex(), "GlobPattern without regex for *.cpp");
+    success &= TestUtils::assertTrue(PatternUtils::GlobPattern("[ab].txt").usesRegex(), "GlobPattern regex fallback for [ab].txt");
+    success &= TestUtils::assertFalse(PatternUtils::GlobPattern("[ab].txt", PatternUtils::GlobSyntax::Wildcard).usesRegex(), "GlobPattern wildcard [ab].txt is literal");
+
+    return success;
+}
+
+// Checks the class of typical patterns and compares each single-pattern list with GlobPattern
+bool BasicFunctionTest::testFilterSet() {
+    using PatternClass = PatternList::PatternClass;
+    bool success = true;
+
+    success &= TestUtils::assertTrue(PatternList::classify("Makefile") == PatternClass::Exact, "FilterSet classify exact name");
+    success &= TestUtils::assertTrue(PatternList::classify("*.cpp") == PatternClass::Extension, "FilterSet classify extension");
+    success &= TestUtils::assertTrue(PatternList::classify("build*") == PatternClass::Prefix, "FilterSet classify prefix");
+    success &= TestUtils::assertTrue(PatternList::classify("*.tar.gz") == PatternClass::Glob, "FilterSet classify multi-dot suffix as glob");
+    success &= TestUtils::assertTrue(PatternList::classify("*Test.cpp") == PatternClass::Glob, "FilterSet classify general glob");
+    success &= TestUtils::assertTrue(PatternList::classify("[ab]*") == PatternClass::Glob, "FilterSet classify regex syntax as glob");
+
+    const std::vector<std::string> patterns = { "Makefile", "*.cpp", "*.H", "build*", "*", ".git*", "*.tar.gz", "file?.txt", "[ab]*" };
+    const std::vector<std::string> names = {
+        "", "makefile", "Makefile.am", "main.cpp", "MAIN.CPP", ".cpp", "main.cpp.bak", "a.h", "build", "builds",
+        "xbuild", ".git", ".github", "a.tar.gz", "file1.txt", "a.b", "line\n.cpp", "build\n"
+    };
+    bool parity = true;
+    for (const auto& pattern : patterns) {
+        const PatternList list({ pattern });
+        const PatternUtils::GlobPattern glob(pattern);
+        for (const auto& name : names) {
+            if (list.matches(name) != glob.matches(name)) {
+                parity &= TestUtils::assertTrue(false, "FilterSet parity '" + pattern + "' with '" + name + "'");
+            }
+        }
+    }
+    success &= TestUtils::assertTrue(parity, "FilterSet classes match like GlobPattern");
+
+    const FilterSet filters({ "*.cpp", "*.h" }, { "*Test.cpp" }, { "build*" });
+    success &= TestUtils::assertTrue(filters.isIncluded("main.cpp") && !filters.isIncluded("readme.md"), "FilterSet includes");
+    success &= TestUtils::assertTrue(filters.isExcludedFile("MainTest.cpp") && !filters.isExcludedFile("main.cpp"), "FilterSet excluded files");
+    success &= TestUtils::assertTrue(filters.isExcludedDir("build_x64") && !filters.isExcludedDir("src"), "FilterSet excluded dirs");
+    success &= TestUtils::assertTrue(FilterSet().isIncluded("anything"), "FilterSet without types includes everything");
+
+    // Many extensions are answered by one lookup of the last extension
+    const PatternList extensions({ "*.h", "*.HPP", "*.inl", "*.cpp", "*.c", "*.cc" });
+    success &= TestUtils::assertTrue(extensions.matches("Vector.Hpp") && extensions.matches("x.inl"), "FilterSet extension set hits");
+    success &= TestUtils::assertFalse(extensions.matches("main.cpp.orig") || extensions.matches("cpp") || extensions.matches("main.cxx"), "FilterSet extension set misses");
+    success &= TestUtils::assertTrue(extensions.matches("archive.tar.c"), "FilterSet extension set uses the last dot");
+
+    return success;
+}
+
+// Compares the automaton for single patterns and for the whole list with GlobPattern
+bool BasicFunctionTest::testGlobAutomaton() {
+    const std::vector<std::string> patterns = {
+        "*Test.cpp", "file?.txt", "a*b*c", "*a*", "**", "*.tar.gz", "x?*?y", "?", "*~", "#*#", "*.o??", "*", ""
+    };
+    const std::vector<std::string> names = {
+        "", "a", "MainTest.cpp", "test.cpp", "file1.txt", "FILE12.txt", "abc", "aXbYc", "acb", "archive.TAR.GZ",
+        "xy", "xay", "xaby", "notes.txt~", "#autosave#", "main.obj", "main.o", "line\nbreak", "\xC3\x84rger.txt"
+    };
+
+    bool success = true;
+    for (size_t i = 0; i < patterns.size(); ++i) {
+        const PatternUtils::GlobPattern glob(patterns[i]);
+        const PatternUtils::GlobAutomaton single({ patterns[i] });
+        // The whole list without the catch-all patterns at the end
+        const std::vector<std::string> prefix(patterns.begin(), patterns.begin() + std::min(i + 1, patterns.size() - 2));
+        const PatternUtils::GlobAutomaton combined(prefix);
+        const std::vector<PatternUtils::GlobPattern> globs = PatternUtils::compileGlobs(prefix);
+
+        for (const auto& name : names) {
+            if (single.matches(name) != glob.matches(name)) {
+                success &= TestUtils::assertTrue(false, "GlobAutomaton single '" + patterns[i] + "' with '" + name + "'");
+            }
+            if (combined.matches(name) != PatternUtils::matchesPattern(name, globs)) {
+                success &= TestUtils::assertTrue(false, "GlobAutomaton list of " + std::to_string(prefix.size()) + " with '" + name + "'");
+            }
+        }
+    }
+    success &= TestUtils::assertTrue(success, "GlobAutomaton matches like the single patterns");
+
+    // Too many states: not ready, PatternList falls back to per-pattern matching
+    const PatternUtils::GlobAutomaton limited({ "*a*b*c*", "*c*b*a*" }, 2);
+    success &= TestUtils::assertFalse(limited.ready(), "GlobAutomaton state limit");
+    const PatternList list({ "*Test.cpp", "*.tar.gz", "[ab]*" });
+    success &= TestUtils::assertTrue(list.matches("MainTest.cpp") && list.matches("x.tar.gz") && list.matches("Bob"), "PatternList with automaton and regex glob");
+    success &= TestUtils::assertFalse(list.matches("main.cpp"), "PatternList with automaton miss");
+
+    return success;
+}
+
+// Walks path pattern states down by hand and checks matches and liveness
+bool BasicFunctionTest::testPathPatterns() {
+    bool success = true;
+
+    // Descends along a relative directory path
+    auto stateOf = [](const PathPatternList& list, const std::vector<std::string>& dirs) {
+        PathPatternList::State state = list.rootState();
+        for (const auto& dir : dirs) state = list.descend(state, dir);
+        return state;
+    };
+
+    success &= TestUtils::assertTrue(PathPatternList::isPathPattern("src/*.h"), "PathPattern: src/*.h is a path");
+    success &= TestUtils::assertFalse(PathPatternList::isPathPattern("build/") || PathPatternList::isPathPattern("*.h"), "PathPattern: names stay names");
+
+    const PathPatternList generated({ "src/**/generated/*.h" });
+    success &= TestUtils::assertTrue(generated.matches(stateOf(generated, { "src", "generated" }), "a.H"), "PathPattern: ** matches no directory");
+    success &= TestUtils::assertTrue(generated.matches(stateOf(generated, { "src", "a", "b", "generated" }), "a.h"), "PathPattern: ** matches several directories");
+    success &= TestUtils::assertFalse(generated.matches(stateOf(generated, { "src", "a" }), "a.h"), "PathPattern: generated is required");
+    success &= TestUtils::assertFalse(generated.matches(stateOf(generated, { "lib", "generated" }), "a.h"), "PathPattern: anchored at the root");
+    success &= TestUtils::assertFalse(generated.alive(stateOf(generated, { "lib" })), "PathPattern: subtree outside src is dead");
+    success &= TestUtils::assertTrue(generated.alive(stateOf(generated, { "src", "x", "y" })), "PathPattern: subtree below ** stays alive");
+
+    const PathPatternList thirdParty({ "third_party/*/test" });
+    success &= TestUtils::assertTrue(thirdParty.matches(stateOf(thirdParty, { "third_party", "zlib" }), "test"), "PathPattern: * is one directory");
+    success &= TestUtils::assertFalse(thirdParty.matches(stateOf(thirdParty, { "third_party", "zlib", "x" }), "test"), "PathPattern: * is not several directories");
+
+    const PathPatternList below({ "/src/**" });
+    success &= TestUtils::assertFalse(below.matches(below.rootState(), "src"), "PathPattern: trailing ** doesn't match the directory itself");
+    success &= TestUtils::assertTrue(below.matches(stateOf(below, { "src", "deep" }), "file.txt"), "PathPattern: trailing ** matches everything below");
+
+    // FilterSet mixes names and paths; only path-only include lists prune
+    const FilterSet paths({ "src/**/*.h" }, { "src/legacy/*" }, { "third_party/*/test" });
+    const FilterSet::PathState srcState = paths.descend(paths.rootState(), "src");
+    success &= TestUtils::assertTrue(paths.hasPathPatterns(), "FilterSet: path patterns detected");
+    success &= TestUtils::assertTrue(paths.isIncluded("a.h", srcState) && !paths.isIncluded("a.h"), "FilterSet: include by path");
+    success &= TestUtils::assertTrue(paths.isExcludedFile("old.h", paths.descend(srcState, "legacy")), "FilterSet: exclude file by path");
+    success &= TestUtils::assertFalse(paths.canContainIncluded(paths.descend(paths.rootState(), "docs")), "FilterSet: prunes subtree without include match");
+    const FilterSet mixed({ "src/**/*.h", "*.md" }, {}, {});
+    success &= TestUtils::assertTrue(mixed.canContainIncluded(mixed.descend(mixed.rootState(), "docs")), "FilterSet: name patterns keep every subtree");
+
+    return success;
+}
+
+// Tests rules file parsing and first-match-wins decisions
+bool BasicFunctionTest::testRuleSet() {
+    bool success = true;
+
+    const fs::path rulesFile = "test_rules.txt";
+    std::ofstream(rulesFile) << "# headers only\n\n+ *.h\r\n- *Impl.h\n; comment\n+ private/**\n- build/\n- *\n";
+    const std::vector<Rule> rules = RuleSet::load(rulesFile);
+    success &= TestUtils::assertEqual(rules.size(), size_t(5), "RuleSet: comments and blank lines skipped");
+    success &= TestUtils::assertTrue(rules[0].include && rules[0].pattern == "*.h" && !rules[1].include, "RuleSet: signs and patterns parsed");
+
+    // First match wins: *Impl.h is included by the earlier + *.h
+    const RuleSet set(rules);
+    const RuleSet::State root = set.rootState();
+    success &= TestUtils::assertTrue(set.decideFile("FooImpl.h", root) == RuleDecision::Include, "RuleSet: first match wins");
+    success &= TestUtils::assertTrue(set.decideFile("main.cpp", root) == RuleDecision::Exclude, "RuleSet: catch-all exclude");
+    success &= TestUtils::assertTrue(set.decideFile("notes.txt", set.descend(root, "private")) == RuleDecision::Include, "RuleSet: path rule below private");
+    success &= TestUtils::assertTrue(set.decideDir("build", root) == RuleDecision::Exclude, "RuleSet: directory rule");
+    success &= TestUtils::assertTrue(set.decideDir("src", root) == RuleDecision::None, "RuleSet: file rules don't decide directories");
+    success &= TestUtils::assertTrue(set.decideFile("build", root) == RuleDecision::Exclude, "RuleSet: directory rules don't decide files");
+
+    const RuleSet order({ { false, "*Impl.h" }, { true, "*.h" } });
+    success &= TestUtils::assertTrue(order.decideFile("FooImpl.h", order.rootState()) == RuleDecision::Exclude &&
+        order.decideFile("Foo.h", order.rootState()) == RuleDecision::Include, "RuleSet: rule order decides");
+    success &= TestUtils::assertTrue(order.decideFile("Foo.cpp", order.rootState()) == RuleDecision::None, "RuleSet: no match falls through");
+
+    // Only include path rules before a catch-all exclude keep a subtree alive
+    const RuleSet pathsOnly({ { true, "src/**/*.h" }, { false, "*" } });
+    success &= TestUtils::assertFalse(pathsOnly.canContainIncluded(pathsOnly.descend(pathsOnly.rootState(), "docs")), "RuleSet: prunes below catch-all exclude");
+    success &= TestUtils::assertTrue(pathsOnly.canContainIncluded(pathsOnly.descend(pathsOnly.rootState(), "src")), "RuleSet: keeps subtree of an include path");
+    success &= TestUtils::assertTrue(set.canContainIncluded(set.descend(root, "docs")), "RuleSet: name includes keep every subtree");
+
+    // Rules override the --types / --exclude-* lists, unmatched entries fall through
+    const FilterSet filters({ "*.cpp" }, { "*Test.cpp" }, { "build" }, { { true, "keep/" }, { true, "MainTest.cpp" }, { false, "*.tmp" } });
+    const FilterSet::PathState state = filters.rootState();
+    success &= TestUtils::assertTrue(filters.classifyFile("MainTest.cpp", state) == FilterSet::FileDecision::Copy, "FilterSet: rule include beats exclude-files");
+    success &= TestUtils::assertTrue(filters.classifyFile("OtherTest.cpp", state) == FilterSet::FileDecision::Excluded, "FilterSet: exclude-files without rule match");
+    success &= TestUtils::assertTrue(filters.classifyFile("a.tmp", state) == FilterSet::FileDecision::Excluded, "FilterSet: rule exclude");
+    success &= TestUtils::assertTrue(filters.classifyFile("a.h", state) == FilterSet::FileDecision::NotIncluded, "FilterSet: types without rule match");
+    success &= TestUtils::assertTrue(filters.isExcludedDir("build", state) && !filters.isExcludedDir("keep", state), "FilterSet: directory rules before exclude-dirs");
+
+    // Malformed lines name file and line
+    std::ofstream(rulesFile) << "+ *.h\n*.cpp\n";
+    std::string error;
+    try {
+        RuleSet::load(rulesFile);
+    }
+    catch (const std::runtime_error& e) {
+        error = e.what();
+    }
+    success &= TestUtils::assertTrue(error.find("test_rules.txt:2") != std::string::npos, "RuleSet: invalid line reported");
+
+    fs::remove(rulesFile);
+    return success;
+}
+
+// Tests gitignore parsing (last match wins, negation, directory-only lines) and nested ignore files
+bool BasicFunctionTest::testIgnoreStack() {
+    bool success = true;
 
+    std::istringstream lines("# comment\n\n*.log\n!keep.log\nbuild/\n/out\n\\#literal\ndocs/**/*.tmp  \n");
+    const std::vector<Rule> rules = IgnoreStack::parse(lines);
+    success &= TestUtils::assertEqual(rules.size(), size_t(11), "IgnoreStack: file and directory rule per line");
+    success &= TestUtils::assertTrue(rules.front().pattern == "docs/**/*.tmp/" && rules.back().pattern == "*.log", "IgnoreStack: reversed, trailing blanks trimmed");
+
+    const fs::path root = "test_ignore";
+    fs::remove_all(root);
+    fs::create_directories(root / "sub" / "deep");
+    std::ofstream(root / ".gitignore") << "*.log\n!keep.log\nbuild/\n/out\n";
+    std::ofstream(root / "sub" / ".prunecopyignore") << "!debug.log\nsecret*\n";
+
+    const auto top = IgnoreStack::enter(nullptr, root);
+    success &= TestUtils::assertTrue(top->isIgnored("a.log", false) && !top->isIgnored("keep.log", false), "IgnoreStack: negation after a match");
+    success &= TestUtils::assertTrue(top->isIgnored("build", true) && !top->isIgnored("build", false), "IgnoreStack: trailing / only matches directories");
+    success &= TestUtils::assertTrue(top->isIgnored("out", true) && top->isIgnored("out", false), "IgnoreStack: anchored line at its own level");
+
+    const auto sub = IgnoreStack::enter(top, root / "sub");
+    success &= TestUtils::assertFalse(sub->isIgnored("out", true), "IgnoreStack: anchored line not below its level");
+    success &= TestUtils::assertTrue(sub->isIgnored("a.log", false) && !sub->isIgnored("debug.log", false), "IgnoreStack: nested file overrides its parent");
+    success &= TestUtils::assertTrue(sub->isIgnored("secret.txt", false), "IgnoreStack: nested file adds lines");
+
+    // Without path lines a directory without ignore file reuses its parent's stack
+    const auto nameOnly = IgnoreStack::enter(nullptr, root / "sub");
+    success &= TestUtils::assertTrue(IgnoreStack::enter(nameOnly, root / "sub" / "deep") == nameOnly, "IgnoreStack: directory without changes shares its parent's stack");
+    success &= TestUtils::assertFalse(IgnoreStack::enter(sub, root / "sub" / "deep") == sub, "IgnoreStack: path lines advance per directory");
+
+    fs::remove_all(root);
     return success;
 }
@@ -40,6 +40,36 @@ private:
      */
     static bool testPatternUtils();
 
+    /**
+     * @brief Tests that compiled glob patterns match exactly like the regex conversions.
+     */
+    static bool testGlobPattern();
+
+    /**
+     * @brief Tests pattern classification of FilterSet and that every class matches like its glob.
+     */
+    static bool testFilterSet();
+
+    /**
+     * @brief Tests that the combined glob automaton matches like the single patterns and honours its state limit.
+     */
+    static bool testGlobAutomaton();
+
+    /**
+     * @brief Tests path patterns with "**" and their per-directory states.
+     */
+    static bool testPathPatterns();
+
+    /**
+     * @brief Tests rules file parsing and first-match-wins decisions for files and directories.
+     */
+    static bool testRuleSet();
+
+    /**
+     * @brief Tests gitignore parsing and the layering of nested ignore files.
+     */
+    static bool testIgnoreStack();
+
     /**
      * @brief Tests manual initialization and parsing behavior of PruneOptions.
      */
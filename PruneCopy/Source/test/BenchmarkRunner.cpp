@@ -0,0 +1,325 @@
+/*****************************************************************//**
+ * @file   BenchmarkRunner.cpp
+ * @brief  Implements the internal performance benchmarks
+ * 
+ * @author Patrik Neunteufel
+ * @date   May 2025
+ *********************************************************************/
+
+#include "BenchmarkRunner.hpp"
+#include "../util/PatternUtils.hpp"
+#include "../util/FilterSet.hpp"
+#include "../core/DirectoryReader.hpp"
+#include "../core/DirectoryWalker.hpp"
+#include "../core/ScanCache.hpp"
+#include "../core/TaskPlanner.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+    // Runs the callable and returns the elapsed time in milliseconds
+    template <typename Fn>
+    double timeMs(Fn&& fn) {
+        const auto start = std::chrono::steady_clock::now();
+        fn();
+        const auto stop = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::milli>(stop - start).count();
+    }
+
+    // Filenames with the mix of extensions a source tree typically has
+    std::vector<std::string> makeFilenames(size_t count) {
+        static const char* const stems[] = { "main", "FileCopier", "README", "test_utils", "build", "Image0042", "config" };
+        static const char* const extensions[] = { ".cpp", ".hpp", ".h", ".TXT", ".md", ".obj", ".png", ".json", ".tmp", "" };
+        std::vector<std::string> names;
+        names.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            names.push_back(std::string(stems[i % 7]) + std::to_string(i) + extensions[(i / 7) % 10]);
+        }
+        return names;
+    }
+
+}
+
+// Executes all benchmarks and prints a summary to the console
+bool BenchmarkRunner::runAllBenchmarks() {
+    bool allEqual = true;
+
+    std::cout << "[BENCH] Running pattern matching benchmark...\n";
+    allEqual &= benchmarkPatternMatching();
+
+    std::cout << "[BENCH] Running extension set benchmark...\n";
+    allEqual &= benchmarkExtensionSet();
+
+    std::cout << "[BENCH] Running glob automaton benchmark...\n";
+    allEqual &= benchmarkGlobAutomaton();
+
+    std::cout << "[BENCH] Running target path benchmark...\n";
+    allEqual &= benchmarkTargetPaths();
+
+    std::cout << "[BENCH] Running directory reader benchmark...\n";
+    allEqual &= benchmarkDirectoryReader();
+
+    std::cout << "[BENCH] Running scan cache benchmark...\n";
+    allEqual &= benchmarkScanCache();
+
+    std::cout << (allEqual ? "[BENCH] DONE\n" : "[BENCH] RESULT MISMATCH DETECTED\n");
+    return allEqual;
+}
+
+// Filters the same filenames through the regex, the compiled glob and the classified FilterSet path (same patterns as the CLI)
+bool BenchmarkRunner::benchmarkPatternMatching() {
+    const std::vector<std::string> types = { "*.cpp", "*.hpp", "*.h", "*.txt", "config?.json" };
+    const std::vector<std::string> names = makeFilenames(200000);
+
+    const std::vector<std::regex> regexPatterns = PatternUtils::convertToRegex(types);
+    const std::vector<PatternUtils::GlobPattern> globPatterns = PatternUtils::compileGlobs(types);
+    const PatternList patternList(types);
+
+    size_t regexMatches = 0;
+    size_t globMatches = 0;
+    size_t listMatches = 0;
+    const double regexMs = timeMs([&] {
+        for (const auto& name : names) {
+            if (PatternUtils::matchesPattern(name, regexPatterns)) ++regexMatches;
+        }
+        });
+    const double globMs = timeMs([&] {
+        for (const auto& name : names) {
+            if (PatternUtils::matchesPattern(name, globPatterns)) ++globMatches;
+        }
+        });
+    const double listMs = timeMs([&] {
+        for (const auto& name : names) {
+            if (patternList.matches(name)) ++listMatches;
+        }
+        });
+
+    std::cout << std::fixed << std::setprecision(1)
+        << "[BENCH] " << names.size() << " names x " << types.size() << " patterns\n"
+        << "[BENCH]   std::regex:  " << regexMs << " ms (" << regexMatches << " matches)\n"
+        << "[BENCH]   GlobPattern: " << globMs << " ms (" << globMatches << " matches)\n"
+        << "[BENCH]   FilterSet:   " << listMs << " ms (" << listMatches << " matches)\n"
+        << "[BENCH]   speedup:     " << (globMs > 0.0 ? regexMs / globMs : 0.0) << "x (GlobPattern), "
+        << (listMs > 0.0 ? regexMs / listMs : 0.0) << "x (FilterSet)\n";
+
+    return regexMatches == globMatches && regexMatches == listMatches;
+}
+
+// Typical long --types list: the GlobPattern path grows with the list, the hash set doesn't
+bool BenchmarkRunner::benchmarkExtensionSet() {
+    std::vector<std::string> types;
+    for (const char* ext : { "h", "hh", "hpp", "hxx", "inl", "ipp", "c", "cc", "cpp", "cxx", "m", "mm", "cs", "java", "kt",
+                             "py", "rb", "go", "rs", "swift", "js", "ts", "tsx", "jsx", "lua", "sh", "ps1", "bat", "cmake", "txt",
+                             "md", "rst", "ini", "cfg", "toml", "yaml", "yml", "xml", "json", "TXT" }) {
+        types.push_back(std::string("*.") + ext);
+    }
+    const std::vector<std::string> names = makeFilenames(200000);
+
+    const std::vector<PatternUtils::GlobPattern> globPatterns = PatternUtils::compileGlobs(types);
+    const PatternList patternList(types);
+
+    size_t globMatches = 0;
+    size_t listMatches = 0;
+    const double globMs = timeMs([&] {
+        for (const auto& name : names) {
+            if (PatternUtils::matchesPattern(name, globPatterns)) ++globMatches;
+        }
+        });
+    const double listMs = timeMs([&] {
+        for (const auto& name : names) {
+            if (patternList.matches(name)) ++listMatches;
+        }
+        });
+
+    std::cout << std::fixed << std::setprecision(1)
+        << "[BENCH] " << names.size() << " names x " << types.size() << " extension patterns\n"
+        << "[BENCH]   GlobPattern: " << globMs << " ms (" << globMatches << " matches)\n"
+        << "[BENCH]   FilterSet:   " << listMs << " ms (" << listMatches << " matches)\n"
+        << "[BENCH]   speedup:     " << (listMs > 0.0 ? globMs / listMs : 0.0) << "x\n";
+
+    return globMatches == listMatches;
+}
+
+// Exclude lists of 60 patterns are common; every general glob is tested in one pass
+bool BenchmarkRunner::benchmarkGlobAutomaton() {
+    std::vector<std::string> patterns;
+    for (const char* stem : { "*Test", "test_*", "*Copier?*", "*.generated", "*~", "#*#", "*.orig", "*.rej", "*.bak?", "*.sw?" }) {
+        for (const char* suffix : { "", ".cpp", ".h", ".txt", ".json", "?" }) {
+            patterns.push_back(std::string(stem) + suffix);
+        }
+    }
+    const std::vector<std::string> names = makeFilenames(200000);
+
+    const std::vector<PatternUtils::GlobPattern> globPatterns = PatternUtils::compileGlobs(patterns);
+    const auto buildStart = std::chrono::steady_clock::now();
+    const PatternUtils::GlobAutomaton automaton(patterns);
+    const double buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - buildStart).count();
+    if (!automaton.ready()) {
+        std::cout << "[BENCH]   automaton hit the state limit, skipped\n";
+        return true;
+    }
+
+    size_t globMatches = 0;
+    size_t automatonMatches = 0;
+    const double globMs = timeMs([&] {
+        for (const auto& name : names) {
+            if (PatternUtils::matchesPattern(name, globPatterns)) ++globMatches;
+        }
+        });
+    const double automatonMs = timeMs([&] {
+        for (const auto& name : names) {
+            if (automaton.matches(name)) ++automatonMatches;
+        }
+        });
+
+    std::cout << std::fixed << std::setprecision(1)
+        << "[BENCH] " << names.size() << " names x " << patterns.size() << " glob patterns ("
+        << automaton.stateCount() << " DFA states, built in " << buildMs << " ms)\n"
+        << "[BENCH]   GlobPattern:   " << globMs << " ms (" << globMatches << " matches)\n"
+        << "[BENCH]   GlobAutomaton: " << automatonMs << " ms (" << automatonMatches << " matches)\n"
+        << "[BENCH]   speedup:       " << (automatonMs > 0.0 ? globMs / automatonMs : 0.0) << "x\n";
+
+    return globMatches == automatonMatches;
+}
+
+// fs::relative canonicalizes both paths (several stat/readlink calls per file); the walker already knows the relative directory
+// Run under `strace -c -f` to see the system calls the lexical path saves
+bool BenchmarkRunner::benchmarkTargetPaths() {
+    namespace fs = std::filesystem;
+    const fs::path root = "bench_target_paths";
+    const fs::path dst = root / "out";
+    fs::remove_all(root);
+    const fs::path src = root / "src";
+    for (int a = 0; a < 10; ++a) {
+        for (int b = 0; b < 10; ++b) {
+            const fs::path dir = src / ("module" + std::to_string(a)) / ("part" + std::to_string(b));
+            fs::create_directories(dir);
+            for (int f = 0; f < 20; ++f) {
+                std::ofstream(dir / ("file" + std::to_string(f) + ".txt"));
+            }
+        }
+    }
+
+    const std::vector<DirectoryListing> listings = DirectoryWalker(std::make_shared<const FilterSet>()).collect(src);
+    PruneOptions options;
+    const TaskPlanner planner(options);
+
+    std::vector<fs::path> relativeTargets;
+    std::vector<fs::path> lexicalTargets;
+    const double relativeMs = timeMs([&] {
+        for (const auto& listing : listings) {
+            for (const auto& file : listing.files) {
+                relativeTargets.push_back(dst / fs::relative(file, src));
+            }
+        }
+        });
+    const double lexicalMs = timeMs([&] {
+        for (const auto& listing : listings) {
+            for (const auto& file : listing.files) {
+                lexicalTargets.push_back(planner.resolveTargetPath(listing.relativeDir, file, dst));
+            }
+        }
+        });
+    fs::remove_all(root);
+
+    std::cout << std::fixed << std::setprecision(1)
+        << "[BENCH] " << lexicalTargets.size() << " files in " << listings.size() << " directories\n"
+        << "[BENCH]   fs::relative: " << relativeMs << " ms\n"
+        << "[BENCH]   lexical:      " << lexicalMs << " ms\n"
+        << "[BENCH]   speedup:      " << (lexicalMs > 0.0 ? relativeMs / lexicalMs : 0.0) << "x\n";
+
+    return relativeTargets == lexicalTargets;
+}
+
+// directory_iterator may stat entries to classify them; the native reader takes the type from d_type
+// Run under `strace -c -f` to compare the getdents64/statx counts of both walks
+bool BenchmarkRunner::benchmarkDirectoryReader() {
+    namespace fs = std::filesystem;
+    if (!DirectoryReader::supported()) {
+        std::cout << "[BENCH]   native reader not supported on this platform, skipped\n";
+        return true;
+    }
+
+    const fs::path root = "bench_directory_reader";
+    fs::remove_all(root);
+    for (int a = 0; a < 20; ++a) {
+        for (int b = 0; b < 10; ++b) {
+            const fs::path dir = root / ("module" + std::to_string(a)) / ("part" + std::to_string(b));
+            fs::create_directories(dir);
+            for (int f = 0; f < 100; ++f) {
+                std::ofstream(dir / ("file" + std::to_string(f) + ".txt"));
+            }
+        }
+    }
+
+    auto walk = [&](bool native, size_t& files) {
+        DirectoryWalker walker(std::make_shared<const FilterSet>(), 1);
+        walker.setUseNativeReader(native);
+        walker.walk(root, [&](DirectoryListing& listing) { files += listing.files.size(); });
+    };
+    size_t iteratorFiles = 0;
+    size_t nativeFiles = 0;
+    walk(true, nativeFiles); // warm the dentry cache so neither walk pays for it
+    nativeFiles = 0;
+    const double iteratorMs = timeMs([&] { walk(false, iteratorFiles); });
+    const double nativeMs = timeMs([&] { walk(true, nativeFiles); });
+    fs::remove_all(root);
+
+    std::cout << std::fixed << std::setprecision(1)
+        << "[BENCH] " << nativeFiles << " files in 221 directories\n"
+        << "[BENCH]   directory_iterator: " << iteratorMs << " ms\n"
+        << "[BENCH]   getdents64:         " << nativeMs << " ms\n"
+        << "[BENCH]   speedup:            " << (nativeMs > 0.0 ? iteratorMs / nativeMs : 0.0) << "x\n";
+
+    return iteratorFiles == nativeFiles;
+}
+
+// A warm cache replaces every readdir by one stat of the directory (load and save of the cache file included)
+bool BenchmarkRunner::benchmarkScanCache() {
+    namespace fs = std::filesystem;
+    const fs::path root = "bench_scan_cache";
+    const fs::path src = root / "src";
+    const fs::path cacheDir = root / "cache";
+    fs::remove_all(root);
+    for (int a = 0; a < 40; ++a) {
+        for (int b = 0; b < 25; ++b) {
+            const fs::path dir = src / ("module" + std::to_string(a)) / ("part" + std::to_string(b));
+            fs::create_directories(dir);
+            for (int f = 0; f < 50; ++f) {
+                std::ofstream(dir / ("file" + std::to_string(f) + ".txt"));
+            }
+        }
+    }
+
+    // Every walk uses a fresh cache object, like a new run; the tree is older than the racy window of 0
+    auto walk = [&](bool useCache, size_t& files) {
+        std::unique_ptr<ScanCache> cache = useCache ? std::make_unique<ScanCache>(cacheDir, src, 0) : nullptr;
+        DirectoryWalker walker(std::make_shared<const FilterSet>(), 1);
+        walker.setScanCache(cache.get());
+        walker.walk(src, [&](DirectoryListing& listing) { files += listing.files.size(); });
+        if (cache) cache->save();
+    };
+    size_t coldFiles = 0;
+    size_t warmFiles = 0;
+    size_t scanFiles = 0;
+    const double coldMs = timeMs([&] { walk(true, coldFiles); });
+    const double scanMs = timeMs([&] { walk(false, scanFiles); });
+    const double warmMs = timeMs([&] { walk(true, warmFiles); });
+    fs::remove_all(root);
+
+    std::cout << std::fixed << std::setprecision(1)
+        << "[BENCH] " << scanFiles << " files in 1041 directories\n"
+        << "[BENCH]   walk:                " << scanMs << " ms\n"
+        << "[BENCH]   walk + cache (cold): " << coldMs << " ms\n"
+        << "[BENCH]   warm cache:          " << warmMs << " ms\n"
+        << "[BENCH]   speedup:             " << (warmMs > 0.0 ? scanMs / warmMs : 0.0) << "x\n";
+
+    return coldFiles == scanFiles && warmFiles == scanFiles;
+}
@@ -0,0 +1,60 @@
+/*****************************************************************//**
+ * @file   BenchmarkRunner.hpp
+ * @brief  Internal performance benchmarks (--benchmark)
+ * 
+ * @author Patrik Neunteufel
+ * @date   May 2025
+ *********************************************************************/
+
+#pragma once
+
+namespace BenchmarkRunner {
+	/**
+	 * @brief Runs all benchmarks and prints the timings to the console.
+	 *
+	 * @return true if every benchmark produced the same results on all compared paths
+	 */
+	bool runAllBenchmarks();
+
+	/**
+	 * @brief Times filename filtering with the compiled glob patterns and FilterSet against std::regex.
+	 *
+	 * @return true if both paths matched the same files
+	 */
+	bool benchmarkPatternMatching();
+
+	/**
+	 * @brief Times a long list of "*.ext" patterns: one GlobPattern per extension against the FilterSet hash set.
+	 *
+	 * @return true if both paths matched the same files
+	 */
+	bool benchmarkExtensionSet();
+
+	/**
+	 * @brief Times a long exclude list of general globs: per-pattern GlobPattern against the combined automaton.
+	 *
+	 * @return true if both paths matched the same files
+	 */
+	bool benchmarkGlobAutomaton();
+
+	/**
+	 * @brief Times target path resolution: fs::relative per file against the lexical path built from the walker's relative directory.
+	 *
+	 * @return true if both paths produced the same targets
+	 */
+	bool benchmarkTargetPaths();
+
+	/**
+	 * @brief Times a directory walk with std::filesystem::directory_iterator against the getdents64 DirectoryReader.
+	 *
+	 * @return true if both readers found the same files
+	 */
+	bool benchmarkDirectoryReader();
+
+	/**
+	 * @brief Times a full directory walk against a walk served from a warm scan cache.
+	 *
+	 * @return true if both walks found the same files
+	 */
+	bool benchmarkScanCache();
+} // namespace BenchmarkRunner
@@ -1,4 +1,4 @@
-/*****************************************************************//**
+﻿/*****************************************************************//**
  * @file   FileCopierTest.cpp
  * @brief  
  * 
@@ -8,12 +8,29 @@
 #include "FileCopierTest.hpp"
 #include "TestUtils.hpp"
 #include "core/FileCopier.hpp"
+#include "core/CopyEngine.hpp"
+#include "core/DestinationIndex.hpp"
+#include "core/DirectoryCache.hpp"
+#include "core/DirectoryHandles.hpp"
+#include "core/DirectoryReader.hpp"
+#include "core/DirectoryWalker.hpp"
+#include "core/FanOutCopier.hpp"
+#include "core/FileList.hpp"
+#include "core/GitIndex.hpp"
+#include "core/PromptBroker.hpp"
+#include "core/ScanCache.hpp"
+#include "core/TaskPlanner.hpp"
+#include "core/UringCopier.hpp"
 #include "util/PatternUtils.hpp"
 
 #include <iostream>
 #include <fstream>
 #include <thread>
 #include <chrono>
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <iterator>
 
  
 // Executes all test cases related to FileCopier functionality
@@ -35,6 +52,75 @@ bool FileCopierTest::run() {
     // Test auto-renaming logic in flatten mode
     success &= testFlattenAutoRename();
 
+    // Test parallel directory walking (ParallelMode::Thread)
+    success &= testParallelWalker();
+
+    // Test the threaded pipeline (planner + copy workers)
+    success &= testThreadPipeline();
+
+    // Test async mode with the prompt broker
+    success &= testAsyncPromptBroker();
+
+    // Test OpenMP mode (serial fallback when built without OpenMP)
+    success &= testOpenMPMode();
+
+    // Test the copy engine modes (kernel-side copy and fallbacks)
+    success &= testCopyEngine();
+
+    // Test reflink cloning and its fallback
+    success &= testReflink();
+
+    // Test the batched io_uring engine
+    success &= testIoUringEngine();
+
+    // Test fan-out copies to multiple destinations
+    success &= testFanOut();
+
+    // Test the destination index pre-pass
+    success &= testDestinationIndex();
+
+    // Test incremental copies (--only-newer)
+    success &= testOnlyNewer();
+
+    // Test path patterns with ** (relative to the source root)
+    success &= testPathPatterns();
+
+    // Test ordered include/exclude rules (--rules)
+    success &= testRules();
+
+    // Test .gitignore / .prunecopyignore support
+    success &= testIgnoreFiles();
+
+    // Test enumerating sources from the git index
+    success &= testGitIndex();
+
+    // Test copying an explicit file list (--files-from)
+    success &= testFilesFrom();
+
+    // Test target paths built from the walker's relative directories
+    success &= testTargetPaths();
+
+    // Test the cache of created target directories
+    success &= testDirectoryCache();
+
+    // Test copying relative to directory descriptors (--fd-relative)
+    success &= testFdRelative();
+
+    // Test the native directory reader against std::filesystem
+    success &= testNativeReader();
+
+    // Test serving unchanged directories from the scan cache
+    success &= testScanCache();
+
+    // Test that concurrent tasks for one target are written one after another
+    success &= testSharedTargets();
+
+    // Test that prompts without any input left skip instead of asking forever
+    success &= testPromptEndOfInput();
+
+    // Test that broker errors reach the caller and a stopped broker asks nothing
+    success &= testPromptBrokerErrors();
+
     // Optional: deliberately failing overwrite test
     // success &= testOverwriteFalsify();
 
@@ -89,9 +175,9 @@ bool FileCopierTest::testCopyFiltered() {
     PruneOptions options;
     options.sources = { srcDir };
     options.destinations = { dstDir };
-    options.typePatterns = PatternUtils::wildcardsToRegex({ "*.txt", "*.cpp" });  // allowed types
-    options.excludeFilePatterns = PatternUtils::wildcardsToRegex({ "*.tmp" });    // exclude *.tmp
-    options.excludeDirs = { "build" };                                            // exclude build folders
+    options.types = { "*.txt", "*.cpp" };    // allowed types
+    options.excludeFiles = { "*.tmp" };      // exclude *.tmp
+    options.excludeDirs = { "build" };       // exclude build folders
     options.quiet = true; // deprecated → suppress output
 
     // Perform filtered copy
@@ -147,7 +233,7 @@ bool FileCopierTest::testMatchesPattern() {
     PruneOptions options;
     options.sources = { srcDir };
     options.destinations = { dstDir };
-    options.typePatterns = PatternUtils::wildcardsToRegex({ "*.txt", "*.cpp" });
+    options.types = { "*.txt", "*.cpp" };
     options.noOverwrite = true;
     options.quiet = true; // deprecated
 
@@ -218,7 +304,7 @@ bool FileCopierTest::testOverwriteFalsify() {
     PruneOptions options;
     options.sources = { srcDir };
     options.destinations = { dstDir };
-    options.typePatterns = PatternUtils::wildcardsToRegex({ "*.txt", "*.cpp" });
+    options.types = { "*.txt", "*.cpp" };
     options.noOverwrite = true;
     options.quiet = true; // deprecated
 
@@ -262,7 +348,7 @@ bool FileCopierTest::testFlattenSuffixNaming() {
     options.destinations = { dstDir };
     options.flatten = true;
     options.flattenWithSuffix = true;
-    options.typePatterns = PatternUtils::wildcardsToRegex({ "*.txt" });
+    options.types = { "*.txt" };
 
     FileCopier::copyFiltered(options);
 
@@ -293,7 +379,7 @@ bool FileCopierTest::testFlattenAutoRename() {
     options.destinations = { dstDir };
     options.flatten = true;
     options.flattenAutoRename = true;
-    options.typePatterns = PatternUtils::wildcardsToRegex({ "*.txt" });
+    options.types = { "*.txt" };
 
     FileCopier::copyFiltered(options);
 
@@ -304,3 +390,1428 @@ bool FileCopierTest::testFlattenAutoRename() {
     fs::remove_all(testRoot);
     return ok;
 }
+
+// Tests that the work-stealing walker finds the same files as the serial walk,
+// prunes excluded directories and that thread mode copies the filtered set
+bool FileCopierTest::testParallelWalker() {
+    const fs::path testRoot = "test_workspace";
+    const fs::path srcDir = testRoot / "source";
+    const fs::path dstDir = testRoot / "destination";
+
+    setupTestEnvironment(testRoot, srcDir);
+    for (int i = 0; i < 8; ++i) {
+        const fs::path sub = srcDir / ("dir" + std::to_string(i)) / "nested";
+        fs::create_directories(sub);
+        std::ofstream(sub / ("deep" + std::to_string(i) + ".txt")) << "deep";
+    }
+
+    auto flatten = [](const std::vector<DirectoryListing>& listings) {
+        std::vector<std::string> files;
+        for (const auto& listing : listings) {
+            for (const auto& file : listing.files) files.push_back(file.generic_string());
+            for (const auto& dir : listing.skippedDirs) files.push_back("skipped:" + dir.generic_string());
+        }
+        return files;
+    };
+
+    const auto serial = flatten(DirectoryWalker({ "build" }, 1).collect(srcDir));
+    const auto parallel = flatten(DirectoryWalker({ "build" }, 4).collect(srcDir));
+
+    bool ok = true;
+    ok &= TestUtils::assertEqual(serial, parallel, "Parallel walk matches serial walk");
+    ok &= TestUtils::assertTrue(std::find(serial.begin(), serial.end(), "skipped:" + (srcDir / "build").generic_string()) != serial.end(),
+        "build directory is reported as pruned");
+
+    PruneOptions options;
+    options.sources = { srcDir };
+    options.destinations = { dstDir };
+    options.types = { "*.txt", "*.cpp" };
+    options.excludeDirs = { "build" };
+    options.parallelMode = ParallelMode::Thread;
+
+    FileCopier::copyFiltered(options);
+
+    ok &= TestUtils::assertTrue(fs::exists(dstDir / "subdir/file3.cpp"), "Thread mode: file3.cpp copied");
+    ok &= TestUtils::assertTrue(fs::exists(dstDir / "dir7/nested/deep7.txt"), "Thread mode: nested file copied");
+    ok &= TestUtils::assertFalse(fs::exists(dstDir / "build/temp/excluded.cpp"), "Thread mode: excluded dir not copied");
+
+    cleanupTestEnvironment(testRoot);
+    return ok;
+}
+
+// Tests that the threaded pipeline copies many files with a small worker pool and that
+// conflicts between files planned in the same run are resolved before copying
+bool FileCopierTest::testThreadPipeline() {
+    const fs::path testRoot = "test_thread_pipeline";
+    const fs::path srcDir = testRoot / "src";
+    const fs::path dstDir = testRoot / "out";
+
+    fs::remove_all(testRoot);
+    for (int d = 0; d < 10; ++d) {
+        const fs::path sub = srcDir / ("d" + std::to_string(d));
+        fs::create_directories(sub);
+        for (int f = 0; f < 20; ++f) {
+            std::ofstream(sub / ("f" + std::to_string(f) + ".txt")) << d << "/" << f;
+        }
+        std::ofstream(sub / "same.txt") << "from " << d;
+    }
+
+    PruneOptions options;
+    options.sources = { srcDir };
+    options.destinations = { dstDir };
+    options.types = { "*.txt" };
+    options.parallelMode = ParallelMode::Thread;
+    options.threadCount = 3;
+
+    FileCopier::copyFiltered(options);
+
+    bool ok = true;
+    size_t copied = 0;
+    for (const auto& entry : fs::recursive_directory_iterator(dstDir)) {
+        if (entry.is_regular_file()) ++copied;
+    }
+    ok &= TestUtils::assertEqual(210u, copied, "Thread pipeline: all files copied");
+
+    // Flatten: all ten same.txt files must end up under distinct names
+    const fs::path flatDir = testRoot / "flat";
+    options.destinations = { flatDir };
+    options.flatten = true;
+    options.flattenAutoRename = true;
+    options.types = { "same.txt" };
+
+    FileCopier::copyFiltered(options);
+
+    ok &= TestUtils::assertTrue(fs::exists(flatDir / "same.txt"), "Thread pipeline: first same.txt copied");
+    ok &= TestUtils::assertTrue(fs::exists(flatDir / "same(9).txt"), "Thread pipeline: conflicts renamed up to same(9).txt");
+
+    cleanupTestEnvironment(testRoot);
+    return ok;
+}
+
+// Tests async mode with simulated console input: the first conflict is declined,
+// the second answered with [a]ll, which must be applied to every pending conflict
+bool FileCopierTest::testAsyncPromptBroker() {
+    const fs::path testRoot = "test_async_broker";
+    const fs::path srcDir = testRoot / "src";
+    const fs::path dstDir = testRoot / "out";
+
+    fs::remove_all(testRoot);
+    fs::create_directories(srcDir);
+    fs::create_directories(dstDir);
+    for (int i = 0; i < 6; ++i) {
+        std::ofstream(srcDir / ("f" + std::to_string(i) + ".txt")) << "new";
+        if (i < 4) std::ofstream(dstDir / ("f" + std::to_string(i) + ".txt")) << "old";
+    }
+
+    PruneOptions options;
+    options.sources = { srcDir };
+    options.destinations = { dstDir };
+    options.parallelMode = ParallelMode::Async;
+    options.threadCount = 2;
+
+    // Simulate the user: [n]o for the first conflict, [a]ll for the second
+    std::istringstream input("n\na\n");
+    std::streambuf* originalCin = std::cin.rdbuf(input.rdbuf());
+    FileCopier::copyFiltered(options);
+    std::cin.rdbuf(originalCin);
+
+    auto read = [](const fs::path& file) {
+        std::ifstream in(file);
+        std::string content;
+        std::getline(in, content);
+        return content;
+    };
+
+    bool ok = true;
+    ok &= TestUtils::assertEqual(std::string("old"), read(dstDir / "f0.txt"), "Async: declined conflict keeps old content");
+    ok &= TestUtils::assertEqual(std::string("new"), read(dstDir / "f3.txt"), "Async: [a]ll overwrites pending conflicts");
+    ok &= TestUtils::assertEqual(std::string("new"), read(dstDir / "f5.txt"), "Async: non-conflicting file copied");
+
+    cleanupTestEnvironment(testRoot);
+    return ok;
+}
+
+// Tests that OpenMP mode copies the planned file list and honours the filters
+bool FileCopierTest::testOpenMPMode() {
+    const fs::path testRoot = "test_workspace";
+    const fs::path srcDir = testRoot / "source";
+    const fs::path dstDir = testRoot / "destination";
+
+    setupTestEnvironment(testRoot, srcDir);
+
+    PruneOptions options;
+    options.sources = { srcDir };
+    options.destinations = { dstDir };
+    options.types = { "*.txt", "*.cpp" };
+    options.excludeDirs = { "build" };
+    options.parallelMode = ParallelMode::OpenMP;
+    options.threadCount = 2;
+
+    FileCopier::copyFiltered(options);
+
+    bool ok = true;
+    ok &= TestUtils::assertTrue(fs::exists(dstDir / "file1.txt"), "OpenMP: file1.txt copied");
+    ok &= TestUtils::assertTrue(fs::exists(dstDir / "subdir/file3.cpp"), "OpenMP: file3.cpp copied");
+    ok &= TestUtils::assertFalse(fs::exists(dstDir / "file2.tmp"), "OpenMP: file2.tmp filtered");
+    ok &= TestUtils::assertFalse(fs::exists(dstDir / "build/temp/excluded.cpp"), "OpenMP: excluded dir not copied");
+
+    cleanupTestEnvironment(testRoot);
+    return ok;
+}
+
+// Copies the same file with every engine mode and compares the contents
+bool FileCopierTest::testCopyEngine() {
+    const fs::path testRoot = "test_workspace";
+    fs::remove_all(testRoot);
+    fs::create_directories(testRoot);
+
+    // Larger than one read/write buffer, with a non-repeating pattern
+    std::string content;
+    content.reserve(1024 * 1024 + 17);
+    for (size_t i = 0; i < 1024 * 1024 + 17; ++i) {
+        content.push_back(static_cast<char>((i * 31 + i / 251) & 0xFF));
+    }
+    const fs::path source = testRoot / "big.bin";
+    std::ofstream(source, std::ios::binary) << content;
+
+    auto readAll = [](const fs::path& p) {
+        std::ifstream in(p, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    };
+
+    bool ok = true;
+    const std::vector<std::pair<CopyEngineMode, std::string>> modes = {
+        { CopyEngineMode::Auto, "auto" }, { CopyEngineMode::Kernel, "kernel" }, { CopyEngineMode::ReadWrite, "rw" } };
+
+    for (const auto& [mode, name] : modes) {
+        CopyEngine engine(mode);
+        const fs::path target = testRoot / ("copy_" + name + ".bin");
+
+        // An existing, larger target must be truncated
+        std::ofstream(target, std::ios::binary) << content << content;
+
+        const CopyMethod method = engine.copyFile(source, target);
+        ok &= TestUtils::assertTrue(readAll(target) == content, "CopyEngine " + name + ": content equal");
+        if (mode == CopyEngineMode::ReadWrite) {
+            ok &= TestUtils::assertTrue(method == CopyMethod::ReadWrite, "CopyEngine rw: read/write loop used");
+        }
+    }
+
+    // Copying a file onto itself must fail without destroying it
+    bool threw = false;
+    try {
+        CopyEngine(CopyEngineMode::Auto).copyFile(source, source);
+    }
+    catch (const fs::filesystem_error&) {
+        threw = true;
+    }
+    ok &= TestUtils::assertTrue(threw, "CopyEngine: copy onto itself rejected");
+    ok &= TestUtils::assertEqual(static_cast<int>(fs::file_size(source)), static_cast<int>(content.size()),
+        "CopyEngine: source intact");
+
+#ifdef __linux__
+    // Pseudo files report no size (procfs) or a size the kernel copy doesn't deliver (sysfs)
+    for (const fs::path& pseudo : { fs::path("/proc/self/mounts"), fs::path("/sys/kernel/mm/transparent_hugepage/enabled") }) {
+        if (readAll(pseudo).empty()) continue;
+        const fs::path target = testRoot / pseudo.filename();
+        CopyEngine(CopyEngineMode::Kernel, ReflinkMode::Never).copyFile(pseudo, target);
+        ok &= TestUtils::assertFalse(readAll(target).empty(), "CopyEngine: " + pseudo.string() + " copied with content");
+    }
+#endif
+
+    cleanupTestEnvironment(testRoot);
+    return ok;
+}
+
+// Clones a file with every reflink mode; on filesystems without CoW support
+// auto must fall back to a copy and always must fail without leaving a target
+bool FileCopierTest::testReflink() {
+    const fs::path testRoot = "test_workspace";
+    fs::remove_all(testRoot);
+    fs::create_directories(testRoot);
+
+    const std::string content = "reflink test content";
+    const fs::path source = testRoot / "source.txt";
+    std::ofstream(source, std::ios::binary) << content;
+
+    auto readAll = [](const fs::path& p) {
+        std::ifstream in(p, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    };
+
+    bool ok = true;
+
+    const fs::path autoTarget = testRoot / "auto.txt";
+    CopyEngine(CopyEngineMode::Auto, ReflinkMode::Auto).copyFile(source, autoTarget);
+    ok &= TestUtils::assertTrue(readAll(autoTarget) == content, "Reflink auto: content equal");
+
+    const fs::path neverTarget = testRoot / "never.txt";
+    const CopyMethod neverMethod = CopyEngine(CopyEngineMode::Auto, ReflinkMode::Never).copyFile(source, neverTarget);
+    ok &= TestUtils::assertTrue(neverMethod != CopyMethod::Reflink, "Reflink never: data copied");
+    ok &= TestUtils::assertTrue(readAll(neverTarget) == content, "Reflink never: content equal");
+
+    const fs::path alwaysTarget = testRoot / "always.txt";
+    try {
+        const CopyMethod method = CopyEngine(CopyEngineMode::Auto, ReflinkMode::Always).copyFile(source, alwaysTarget);
+        ok &= TestUtils::assertTrue(method == CopyMethod::Reflink, "Reflink always: cloned");
+        ok &= TestUtils::assertTrue(readAll(alwaysTarget) == content, "Reflink always: content equal");
+    }
+    catch (const fs::filesystem_error&) {
+        ok &= TestUtils::assertFalse(fs::exists(alwaysTarget), "Reflink always: no target left on failure");
+    }
+
+    // A failed clone must leave an existing target (and no temporary file) behind
+    const fs::path existingTarget = testRoot / "existing.txt";
+    std::ofstream(existingTarget, std::ios::binary) << "keep me";
+    try {
+        CopyEngine(CopyEngineMode::Auto, ReflinkMode::Always).copyFile(source, existingTarget);
+        ok &= TestUtils::assertTrue(readAll(existingTarget) == content, "Reflink always: existing target replaced by the clone");
+    }
+    catch (const fs::filesystem_error&) {
+        ok &= TestUtils::assertTrue(readAll(existingTarget) == "keep me", "Reflink always: existing target kept on failure");
+    }
+
+    // The temporary name of a target with a name of (almost) NAME_MAX bytes must still be valid
+    const fs::path longTarget = testRoot / (std::string(250, 'l') + ".txt");
+    try {
+        CopyEngine(CopyEngineMode::Auto, ReflinkMode::Always).copyFile(source, longTarget);
+        ok &= TestUtils::assertTrue(readAll(longTarget) == content, "Reflink always: long name cloned");
+    }
+    catch (const fs::filesystem_error& e) {
+        ok &= TestUtils::assertTrue(e.code() != std::errc::filename_too_long, "Reflink always: long name fits the temporary file");
+    }
+
+#ifdef __linux__
+    // A symlinked target keeps its link, the file it points to receives the clone
+    const fs::path linkedFile = testRoot / "linked.txt";
+    const fs::path link = testRoot / "link.txt";
+    std::ofstream(linkedFile, std::ios::binary) << "keep me";
+    fs::create_symlink("linked.txt", link);
+    try {
+        CopyEngine(CopyEngineMode::Auto, ReflinkMode::Always).copyFile(source, link);
+        ok &= TestUtils::assertTrue(readAll(linkedFile) == content, "Reflink always: symlinked target's file cloned");
+    }
+    catch (const fs::filesystem_error&) {
+        ok &= TestUtils::assertTrue(readAll(linkedFile) == "keep me", "Reflink always: symlinked target kept on failure");
+    }
+    ok &= TestUtils::assertTrue(fs::is_symlink(link), "Reflink always: symlink kept");
+#endif
+    size_t temporary = 0;
+    for (const auto& entry : fs::directory_iterator(testRoot)) {
+        temporary += entry.path().extension() == ".prunecopy";
+    }
+    ok &= TestUtils::assertEqual(size_t(0), temporary, "Reflink always: no temporary file left");
+
+    cleanupTestEnvironment(testRoot);
+    return ok;
+}
+
+// Copies a tree with many small files and one multi-chunk file through io_uring,
+// in serial and thread mode; without io_uring the default engine must take over
+bool FileCopierTest::testIoUringEngine() {
+    const fs::path testRoot = "test_workspace";
+    const fs::path srcDir = testRoot / "source";
+
+    fs::remove_all(testRoot);
+    for (int d = 0; d < 3; ++d) {
+        fs::create_directories(srcDir / ("dir" + std::to_string(d)));
+        for (int f = 0; f < 20; ++f) {
+            std::ofstream(srcDir / ("dir" + std::to_string(d)) / ("file" + std::to_string(f) + ".txt"))
+                << "content " << d << "/" << f;
+        }
+    }
+    std::string big(600 * 1024 + 5, '\0');
+    for (size_t i = 0; i < big.size(); ++i) big[i] = static_cast<char>(i % 253);
+    std::ofstream(srcDir / "big.bin", std::ios::binary) << big;
+
+    auto readAll = [](const fs::path& p) {
+        std::ifstream in(p, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    };
+
+    bool ok = true;
+    for (ParallelMode mode : { ParallelMode::None, ParallelMode::Thread }) {
+        const std::string name = mode == ParallelMode::None ? "serial" : "thread";
+        const fs::path dstDir = testRoot / ("destination_" + name);
+
+        PruneOptions options;
+        options.sources = { srcDir };
+        options.destinations = { dstDir };
+        options.copyEngine = CopyEngineMode::IoUring;
+        options.ioDepth = 4;  // fewer slots than files, so slots are reused
+        options.parallelMode = mode;
+        options.threadCount = 2;
+        options.logLevel = LogLevel::Warning;
+
+        FileCopier::copyFiltered(options);
+
+        size_t copied = 0;
+        for (const auto& entry : fs::recursive_directory_iterator(dstDir)) {
+            if (entry.is_regular_file()) ++copied;
+        }
+        ok &= TestUtils::assertEqual(61, static_cast<int>(copied), "io_uring " + name + ": all files copied");
+        ok &= TestUtils::assertTrue(readAll(dstDir / "dir2/file19.txt") == "content 2/19", "io_uring " + name + ": small file content");
+        ok &= TestUtils::assertTrue(readAll(dstDir / "big.bin") == big, "io_uring " + name + ": multi-chunk content");
+    }
+
+    // A missing source fails the batch after the other files were copied
+    UringCopier ring(2);
+    if (ring.ready()) {
+        std::vector<FileTask> tasks = {
+            { srcDir / "missing.txt", testRoot / "out_missing.txt", 0, TaskAction::Copy, {}, 0 },
+            { srcDir / "dir0/file0.txt", testRoot / "out_file0.txt", 11, TaskAction::Copy, {}, 0 } };
+        size_t done = 0;
+        bool threw = false;
+        try {
+            ring.copy(tasks, [&](const FileTask&) { ++done; });
+        }
+        catch (const fs::filesystem_error&) {
+            threw = true;
+        }
+        ok &= TestUtils::assertTrue(threw, "io_uring: missing source reported");
+        ok &= TestUtils::assertEqual(1, static_cast<int>(done), "io_uring: other file still copied");
+
+        // Copying a file onto itself fails before the target is opened (O_TRUNC would empty the source)
+        FileTask self;
+        self.source = srcDir / "dir1/file1.txt";
+        self.target = self.source;
+        self.action = TaskAction::Overwrite;
+        threw = false;
+        try {
+            ring.copy(std::span<const FileTask>(&self, 1), [](const FileTask&) {});
+        }
+        catch (const fs::filesystem_error&) {
+            threw = true;
+        }
+        ok &= TestUtils::assertTrue(threw, "io_uring: copy onto itself reported");
+        ok &= TestUtils::assertTrue(readAll(self.source) == "content 1/1", "io_uring: source not truncated");
+
+        // A new target gets the source mode, not the one the umask leaves of it
+        FileTask shared{ srcDir / "dir2/file2.txt", testRoot / "out_shared.txt", 11, TaskAction::Copy, {}, 0 };
+        const auto sharedPerms = fs::perms::owner_read | fs::perms::owner_write | fs::perms::group_write | fs::perms::others_write;
+        fs::permissions(shared.source, sharedPerms);
+        ring.copy(std::span<const FileTask>(&shared, 1), [](const FileTask&) {});
+        ok &= TestUtils::assertTrue(fs::status(shared.target).permissions() == sharedPerms, "io_uring: new target keeps the source mode");
+    }
+
+    cleanupTestEnvironment(testRoot);
+    return ok;
+}
+
+// Copies small and multi-chunk files to three destinations in serial and thread mode;
+// a file that exists in one destination is skipped there (--no-overwrite) but mirrored to the others
+bool FileCopierTest::testFanOut() {
+    const fs::path testRoot = "test_workspace";
+    const fs::path srcDir = testRoot / "source";
+
+    auto readAll = [](const fs::path& p) {
+        std::ifstream in(p, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    };
+
+    std::string big(FanOutCopier::ChunkSize * 3 + 123, '\0');
+    for (size_t i = 0; i < big.size(); ++i) big[i] = static_cast<char>((i * 7) % 251);
+
+    bool ok = true;
+    for (ParallelMode mode : { ParallelMode::None, ParallelMode::Thread }) {
+        const std::string name = mode == ParallelMode::None ? "serial" : "thread";
+
+        fs::remove_all(testRoot);
+        fs::create_directories(srcDir / "sub");
+        std::ofstream(srcDir / "small.txt") << "small";
+        std::ofstream(srcDir / "sub" / "big.bin", std::ios::binary) << big;
+
+        const std::vector<fs::path> destinations = { testRoot / "dstA", testRoot / "dstB", testRoot / "dstC" };
+        fs::create_directories(destinations[1]);
+        std::ofstream(destinations[1] / "small.txt") << "keep me";
+
+        PruneOptions options;
+        options.sources = { srcDir };
+        options.destinations = destinations;
+        options.noOverwrite = true;
+        options.parallelMode = mode;
+        options.threadCount = 2;
+        options.reflink = ReflinkMode::Never; // same filesystem: --reflink auto would clone per target instead
+        options.logLevel = LogLevel::Warning;
+
+        FileCopier::copyFiltered(options);
+
+        for (const auto& dst : destinations) {
+            ok &= TestUtils::assertTrue(readAll(dst / "sub" / "big.bin") == big,
+                "FanOut " + name + ": big.bin in " + dst.filename().string());
+        }
+        ok &= TestUtils::assertTrue(readAll(destinations[0] / "small.txt") == "small", "FanOut " + name + ": small.txt in dstA");
+        ok &= TestUtils::assertTrue(readAll(destinations[1] / "small.txt") == "keep me", "FanOut " + name + ": existing file kept in dstB");
+        ok &= TestUtils::assertTrue(readAll(destinations[2] / "small.txt") == "small", "FanOut " + name + ": small.txt in dstC");
+    }
+
+    // The source among the targets is reported and left intact, the other targets are still written
+    bool threw = false;
+    try {
+        FanOutCopier::copy(srcDir / "small.txt", { srcDir / "small.txt", testRoot / "other.txt" });
+    }
+    catch (const fs::filesystem_error&) {
+        threw = true;
+    }
+    ok &= TestUtils::assertTrue(threw, "FanOut: copy onto the source reported");
+    ok &= TestUtils::assertTrue(readAll(srcDir / "small.txt") == "small", "FanOut: source not truncated");
+    ok &= TestUtils::assertTrue(readAll(testRoot / "other.txt") == "small", "FanOut: other target written");
+
+    // The copy engine decides whether a clone may apply: same filesystem and a reflink mode that tries it
+    ok &= TestUtils::assertFalse(CopyEngine(CopyEngineMode::Auto, ReflinkMode::Never).mayClone(srcDir, testRoot / "new" / "dir"),
+        "FanOut: --reflink never never clones");
+#ifdef __linux__
+    ok &= TestUtils::assertTrue(CopyEngine(CopyEngineMode::Auto, ReflinkMode::Auto).mayClone(srcDir, testRoot / "new" / "dir"),
+        "FanOut: same filesystem may clone (missing target directory)");
+#endif
+
+    cleanupTestEnvironment(testRoot);
+    return ok;
+}
+
+// Builds an index over two destinations and checks lookups, then plans a flatten copy
+// with auto-rename against the index (existing names must be skipped by the renaming)
+bool FileCopierTest::testDestinationIndex() {
+    const fs::path testRoot = "test_workspace";
+    const fs::path srcDir = testRoot / "source";
+    const fs::path dstA = testRoot / "dstA";
+    const fs::path dstB = testRoot / "dstB";
+
+    fs::remove_all(testRoot);
+    fs::create_directories(srcDir / "x");
+    fs::create_directories(dstA / "deep" / "er");
+    std::ofstream(srcDir / "x" / "same.txt") << "new";
+    std::ofstream(dstA / "same.txt") << "old";
+    std::ofstream(dstA / "same(1).txt") << "old too";
+    std::ofstream(dstA / "deep" / "er" / "file.bin") << "12345";
+
+    bool ok = true;
+
+    DestinationIndex index;
+    index.build({ dstA, dstB / "" }, 2); // dstB does not exist yet, trailing separator on purpose
+    ok &= TestUtils::assertEqual(3, static_cast<int>(index.size()), "Index: all destination files indexed");
+
+    FileStat stat;
+    ok &= TestUtils::assertTrue(index.lookup(dstA / "deep" / "er" / "file.bin", stat) && stat.exists && stat.size == 5,
+        "Index: nested file found with size");
+    ok &= TestUtils::assertTrue(index.lookup(dstA / "missing.txt", stat) && !stat.exists, "Index: missing file answered from memory");
+    ok &= TestUtils::assertTrue(index.lookup(dstB / "a.txt", stat) && !stat.exists, "Index: missing root indexed as empty");
+    ok &= TestUtils::assertFalse(index.lookup(testRoot / "elsewhere.txt", stat), "Index: path outside the roots not covered");
+
+    PruneOptions options;
+    options.sources = { srcDir };
+    options.destinations = { dstA };
+    options.flatten = true;
+    options.flattenAutoRename = true;
+    options.indexDestinations = true;
+    options.logLevel = LogLevel::Warning;
+
+    FileCopier::copyFiltered(options);
+
+    std::ifstream renamed(dstA / "same(2).txt");
+    std::string content;
+    std::getline(renamed, content);
+    ok &= TestUtils::assertEqual(std::string("new"), content, "Index: auto-rename skips names found in the index");
+
+    // A target below a symlinked destination directory isn't in the index, but it does exist
+    const fs::path linked = testRoot / "linked";
+    fs::create_directories(linked);
+    fs::create_directories(srcDir / "link");
+    std::ofstream(linked / "same.txt") << "old";
+    std::ofstream(srcDir / "link" / "same.txt") << "new";
+    fs::create_directories(dstB);
+    std::error_code ec;
+    fs::create_directory_symlink(fs::absolute(linked), dstB / "link", ec);
+    if (!ec) { // creating symlinks may need extra rights on Windows
+        DestinationIndex linkedIndex;
+        linkedIndex.build({ dstB }, 1);
+        ok &= TestUtils::assertFalse(linkedIndex.lookup(dstB / "link" / "same.txt", stat), "Index: symlinked directory left to the filesystem");
+        ok &= TestUtils::assertFalse(linkedIndex.lookup(dstB / "link", stat), "Index: directory entry left to the filesystem");
+
+        options.destinations = { dstB };
+        options.flatten = false;
+        options.flattenAutoRename = false;
+        options.noOverwrite = true;
+        FileCopier::copyFiltered(options);
+        std::ifstream kept(linked / "same.txt");
+        std::getline(kept, content);
+        ok &= TestUtils::assertEqual(std::string("old"), content, "Index: --no-overwrite honoured below a symlinked directory");
+        ok &= TestUtils::assertTrue(fs::exists(dstB / "x" / "same.txt"), "Index: new file still copied");
+    }
+
+    cleanupTestEnvironment(testRoot);
+    return ok;
+}
+
+// Source files with controlled mtimes against existing targets:
+// older target -> copied, newer target -> kept, difference within tolerance -> kept,
+// size policy -> copied on size change only
+bool FileCopierTest::testOnlyNewer() {
+    const fs::path testRoot = "test_workspace";
+    const fs::path srcDir = testRoot / "source";
+    const fs::path dstDir = testRoot / "destination";
+
+    fs::remove_all(testRoot);
+    fs::create_directories(srcDir);
+    fs::create_directories(dstDir);
+
+    auto readAll = [](const fs::path& p) {
+        std::ifstream in(p, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    };
+    auto write = [](const fs::path& p, const std::string& content, fs::file_time_type time) {
+        std::ofstream(p, std::ios::binary) << content;
+        fs::last_write_time(p, time);
+    };
+
+    const auto now = fs::file_time_type::clock::now();
+    using std::chrono::seconds;
+
+    write(srcDir / "outdated.txt", "new", now);
+    write(dstDir / "outdated.txt", "old", now - seconds(60));
+    write(srcDir / "current.txt", "new", now - seconds(60));
+    write(dstDir / "current.txt", "old", now);
+    write(srcDir / "coarse.txt", "new", now);
+    write(dstDir / "coarse.txt", "old", now - seconds(1));  // FAT/SMB rounding
+    write(srcDir / "fresh.txt", "new", now);
+
+    PruneOptions options;
+    options.sources = { srcDir };
+    options.destinations = { dstDir };
+    options.onlyNewer = true;
+    options.mtimeToleranceNs = 2000000000;
+    options.logLevel = LogLevel::Warning;
+
+    FileCopier::copyFiltered(options);
+
+    bool ok = true;
+    ok &= TestUtils::assertEqual(std::string("new"), readAll(dstDir / "outdated.txt"), "OnlyNewer: outdated target replaced");
+    ok &= TestUtils::assertEqual(std::string("old"), readAll(dstDir / "current.txt"), "OnlyNewer: newer target kept");
+    ok &= TestUtils::assertEqual(std::string("old"), readAll(dstDir / "coarse.txt"), "OnlyNewer: difference within tolerance kept");
+    ok &= TestUtils::assertEqual(std::string("new"), readAll(dstDir / "fresh.txt"), "OnlyNewer: missing target copied");
+
+    // Size policy: same mtime order as "current", but a different size
+    write(srcDir / "current.txt", "newer content", now - seconds(60));
+    options.compareSize = true;
+    options.compareMtime = false;
+    options.indexDestinations = true; // answered from the destination index
+    FileCopier::copyFiltered(options);
+    ok &= TestUtils::assertEqual(std::string("newer content"), readAll(dstDir / "current.txt"), "OnlyNewer: size change copied");
+    ok &= TestUtils::assertEqual(std::string("old"), readAll(dstDir / "coarse.txt"), "OnlyNewer: same size kept");
+
+    cleanupTestEnvironment(testRoot);
+    return ok;
+}
+
+// Path patterns: only generated headers below src are copied, dead subtrees are never listed,
+// path excludes remove single directories and files
+bool FileCopierTest::testPathPatterns() {
+    const fs::path testRoot = "test_workspace";
+    const fs::path srcDir = testRoot / "source";
+    const fs::path dstDir = testRoot / "destination";
+
+    fs::remove_all(testRoot);
+    for (const char* file : { "src/a/generated/x.h", "src/a/generated/x.cpp", "src/b/y.h", "src/generated/z.h",
+                              "other/generated/w.h", "third_party/lib/test/t.h", "third_party/lib/src/s.h", "root.h" }) {
+        const fs::path path = srcDir / file;
+        fs::create_directories(path.parent_path());
+        std::ofstream(path) << file;
+    }
+
+    PruneOptions options;
+    options.sources = { srcDir };
+    options.destinations = { dstDir };
+    options.types = { "src/**/generated/*.h" };
+    options.logLevel = LogLevel::Warning;
+
+    FileCopier::copyFiltered(options);
+
+    bool ok = true;
+    ok &= TestUtils::assertTrue(fs::exists(dstDir / "src/a/generated/x.h"), "PathPatterns: generated header copied");
+    ok &= TestUtils::assertTrue(fs::exists(dstDir / "src/generated/z.h"), "PathPatterns: ** matches no directory");
+    ok &= TestUtils::assertFalse(fs::exists(dstDir / "src/a/generated/x.cpp"), "PathPatterns: other types skipped");
+    ok &= TestUtils::assertFalse(fs::exists(dstDir / "src/b/y.h"), "PathPatterns: header outside generated skipped");
+    ok &= TestUtils::assertFalse(fs::exists(dstDir / "other/generated/w.h"), "PathPatterns: pattern is anchored at the source root");
+    ok &= TestUtils::assertFalse(fs::exists(dstDir / "root.h"), "PathPatterns: root file skipped");
+
+    // Subtrees that can't match are not even scanned
+    const auto filters = std::make_shared<const FilterSet>(options.types, options.excludeFiles, options.excludeDirs);
+    bool scannedDeadSubtree = false;
+    for (const auto& listing : DirectoryWalker(filters, 1).collect(srcDir)) {
+        const std::string dir = listing.directory.generic_string();
+        scannedDeadSubtree |= dir.find("other") != std::string::npos || dir.find("third_party") != std::string::npos;
+    }
+    ok &= TestUtils::assertFalse(scannedDeadSubtree, "PathPatterns: dead subtrees pruned during descent");
+
+    // Path excludes next to name includes
+    fs::remove_all(dstDir);
+    options.types = { "*.h" };
+    options.excludeFiles = { "src/b/*" };
+    options.excludeDirs = { "third_party/*/test" };
+    FileCopier::copyFiltered(options);
+    ok &= TestUtils::assertFalse(fs::exists(dstDir / "third_party/lib/test/t.h"), "PathPatterns: directory excluded by path");
+    ok &= TestUtils::assertTrue(fs::exists(dstDir / "third_party/lib/src/s.h"), "PathPatterns: sibling directory kept");
+    ok &= TestUtils::assertFalse(fs::exists(dstDir / "src/b/y.h"), "PathPatterns: file excluded by path");
+    ok &= TestUtils::assertTrue(fs::exists(dstDir / "other/generated/w.h") && fs::exists(dstDir / "root.h"), "PathPatterns: name include still matches everywhere");
+
+    cleanupTestEnvironment(testRoot);
+    return ok;
+}
+
+// Tests an ordered rules file: first match wins, directory rules prune, no match falls through
+bool FileCopierTest::testRules() {
+    const fs::path testRoot = "test_workspace";
+    const fs::path srcDir = testRoot / "source";
+    const fs::path dstDir = testRoot / "destination";
+    const fs::path rulesFile = testRoot / "rules.txt";
+
+    fs::remove_all(testRoot);
+    for (const char* file : { "api.h", "ApiImpl.h", "main.cpp", "private/notes.txt", "private/deep/key.pem",
+                              "lib/util.h", "lib/build/gen.h", "docs/readme.md" }) {
+        const fs::path path = srcDir / file;
+        fs::create_directories(path.parent_path());
+        std::ofstream(path) << file;
+    }
+    std::ofstream(rulesFile) << "- *Impl.h\n+ *.h\n+ private/**\n- build/\n- *\n";
+
+    PruneOptions options;
+    options.sources = { srcDir };
+    options.destinations = { dstDir };
+    options.rulesFile = rulesFile;
+    options.logLevel = LogLevel::Warning;
+
+    FileCopier::copyFiltered(options);
+
+    bool ok = true;
+    ok &= TestUtils::assertTrue(fs::exists(dstDir / "api.h") && fs::exists(dstDir / "lib/util.h"), "Rules: headers included");
+    ok &= TestUtils::assertFalse(fs::exists(dstDir / "ApiImpl.h"), "Rules: earlier exclude wins");
+    ok &= TestUtils::assertTrue(fs::exists(dstDir / "private/notes.txt") && fs::exists(dstDir / "private/deep/key.pem"), "Rules: path include below private");
+    ok &= TestUtils::assertFalse(fs::exists(dstDir / "main.cpp") || fs::exists(dstDir / "docs/readme.md"), "Rules: catch-all exclude");
+    ok &= TestUtils::assertFalse(fs::exists(dstDir / "lib/build"), "Rules: directory rule prunes");
+
+    // Without a catch-all, unmatched files fall through to --types
+    fs::remove_all(dstDir);
+    std::ofstream(rulesFile) << "- *Impl.h\n+ docs/*\n";
+    options.types = { "*.h" };
+    options.filters.reset();
+    FileCopier::copyFiltered(options);
+    ok &= TestUtils::assertTrue(fs::exists(dstDir / "docs/readme.md") && fs::exists(dstDir / "api.h"), "Rules: rule include next to --types");
+    ok &= TestUtils::assertFalse(fs::exists(dstDir / "ApiImpl.h") || fs::exists(dstDir / "main.cpp"), "Rules: rule exclude and --types both apply");
+
+    cleanupTestEnvironment(testRoot);
+    return ok;
+}
+
+// Tests that ignore files are read while descending and ignored directories are never scanned
+bool FileCopierTest::testIgnoreFiles() {
+    const fs::path testRoot = "test_workspace";
+    const fs::path srcDir = testRoot / "source";
+    const fs::path dstDir = testRoot / "destination";
+
+    fs::remove_all(testRoot);
+    for (const char* file : { "main.cpp", "app.log", "keep.log", "build/out.o", "node_modules/pkg/index.js",
+                              "lib/util.cpp", "lib/cache.tmp", "lib/build/gen.cpp" }) {
+        const fs::path path = srcDir / file;
+        fs::create_directories(path.parent_path());
+        std::ofstream(path) << file;
+    }
+    std::ofstream(srcDir / ".gitignore") << "*.log\n!keep.log\n/build/\nnode_modules/\n";
+    std::ofstream(srcDir / "lib" / ".prunecopyignore") << "*.tmp\n";
+
+    PruneOptions options;
+    options.sources = { srcDir };
+    options.destinations = { dstDir };
+    options.useIgnoreFiles = true;
+    options.parallelMode = ParallelMode::Thread;
+    options.logLevel = LogLevel::Warning;
+
+    FileCopier::copyFiltered(options);
+
+    bool ok = true;
+    ok &= TestUtils::assertTrue(fs::exists(dstDir / "main.cpp") && fs::exists(dstDir / "lib/util.cpp"), "IgnoreFiles: other files copied");
+    ok &= TestUtils::assertFalse(fs::exists(dstDir / "app.log"), "IgnoreFiles: ignored file skipped");
+    ok &= TestUtils::assertTrue(fs::exists(dstDir / "keep.log"), "IgnoreFiles: negated file copied");
+    ok &= TestUtils::assertFalse(fs::exists(dstDir / "build") || fs::exists(dstDir / "node_modules"), "IgnoreFiles: ignored directories skipped");
+    ok &= TestUtils::assertTrue(fs::exists(dstDir / "lib/build/gen.cpp"), "IgnoreFiles: anchored directory only at the root");
+    ok &= TestUtils::assertFalse(fs::exists(dstDir / "lib/cache.tmp"), "IgnoreFiles: nested ignore file applied");
+
+    // Ignored directories are pruned before they are scanned
+    DirectoryWalker walker(std::make_shared<const FilterSet>(), 1);
+    walker.setUseIgnoreFiles(true);
+    bool scannedIgnored = false;
+    for (const auto& listing : walker.collect(srcDir)) {
+        scannedIgnored |= listing.directory.generic_string().find("node_modules") != std::string::npos;
+    }
+    ok &= TestUtils::assertFalse(scannedIgnored, "IgnoreFiles: ignored directory not scanned");
+
+    cleanupTestEnvironment(testRoot);
+    return ok;
+}
+
+// Tests that --source-list git copies exactly the tracked regular files, filtered like a walk
+bool FileCopierTest::testGitIndex() {
+    const fs::path testRoot = "test_workspace";
+    const fs::path repo = testRoot / "repo";
+    const fs::path dstDir = testRoot / "destination";
+
+    struct Entry {
+        std::string path;
+        std::uint32_t mode;
+        int stage;
+        std::uint32_t mtime;
+    };
+    // Sorted like git sorts them (byte-wise on the full path)
+    const std::vector<Entry> entries = {
+        { "a.h", 0100644, 0, 1 }, { "build/x.h", 0100644, 0, 1 }, { "conflict.h", 0100644, 2, 1 },
+        { "deleted.h", 0100644, 0, 1 }, { "link.h", 0120000, 0, 1 }, { "src/b.h", 0100644, 0, 1 }, { "src/c.cpp", 0100644, 0, 1 },
+        { "src/deep/d.h", 0100755, 0, 0xFFFFFFFF }
+    };
+
+    // Writes an index of the given version (all object ids zero, checksum not verified by the reader)
+    auto writeIndex = [&](std::uint32_t version) {
+        std::string data = "DIRC";
+        auto u32 = [&](std::uint32_t v) { for (int shift = 24; shift >= 0; shift -= 8) data.push_back(static_cast<char>((v >> shift) & 0xFF)); };
+        u32(version);
+        u32(static_cast<std::uint32_t>(entries.size()));
+        std::string previous;
+        for (const auto& entry : entries) {
+            const size_t start = data.size();
+            for (std::uint32_t field : { 0u, 0u, entry.mtime, 0u, 0u, 0u, entry.mode, 0u, 0u, static_cast<std::uint32_t>(entry.path.size()) }) u32(field);
+            data.append(20, '\0');
+            const std::uint32_t flags = (static_cast<std::uint32_t>(entry.stage) << 12) | static_cast<std::uint32_t>(entry.path.size());
+            data.push_back(static_cast<char>(flags >> 8));
+            data.push_back(static_cast<char>(flags & 0xFF));
+            if (version == 4) {
+                size_t common = 0;
+                while (common < previous.size() && common < entry.path.size() && previous[common] == entry.path[common]) ++common;
+                data.push_back(static_cast<char>(previous.size() - common)); // < 128 here, one varint byte
+                data += entry.path.substr(common);
+                data.push_back('\0');
+            }
+            else {
+                data += entry.path;
+                data.append(((62 + entry.path.size() + 8) & ~size_t(7)) - (data.size() - start), '\0');
+            }
+            previous = entry.path;
+        }
+        data.append(20, '\0');
+        std::ofstream(repo / ".git" / "index", std::ios::binary) << data;
+    };
+
+    bool ok = true;
+    for (std::uint32_t version : { 2u, 4u }) {
+        const std::string label = "GitIndex v" + std::to_string(version) + ": ";
+        fs::remove_all(testRoot);
+        fs::create_directories(repo / ".git");
+        for (const char* file : { "a.h", "build/x.h", "conflict.h", "link.h", "src/b.h", "src/c.cpp", "src/deep/d.h", "untracked.h" }) {
+            const fs::path path = repo / file;
+            fs::create_directories(path.parent_path());
+            std::ofstream(path) << file;
+        }
+        writeIndex(version);
+        // Modified after the index was written: the index still records the old size
+        std::ofstream(repo / "a.h") << "a.h modified";
+
+        // Every entry is checked in the worktree: deleted ones are skipped, sizes come from disk
+        const GitIndex index(repo);
+        std::vector<DirectoryListing> listings;
+        index.walk(FilterSet(), [&](DirectoryListing& listing) { listings.push_back(std::move(listing)); });
+        size_t files = 0;
+        bool statsOk = true;
+        for (const auto& listing : listings) {
+            files += listing.files.size();
+            for (size_t i = 0; i < listing.files.size(); ++i) {
+                statsOk &= listing.stats[i].exists && listing.stats[i].size == fs::file_size(listing.files[i]);
+            }
+        }
+        ok &= TestUtils::assertEqual(files, size_t(5), label + "only tracked regular files in stage 0 present in the worktree");
+        ok &= TestUtils::assertTrue(statsOk, label + "stat data taken from the worktree");
+
+        PruneOptions options;
+        options.sources = { repo };
+        options.destinations = { dstDir };
+        options.types = { "*.h" };
+        options.excludeDirs = { "build" };
+        options.sourceList = SourceListMode::Git;
+        options.logLevel = LogLevel::Warning;
+        FileCopier::copyFiltered(options);
+
+        ok &= TestUtils::assertTrue(fs::exists(dstDir / "a.h") && fs::exists(dstDir / "src/b.h") && fs::exists(dstDir / "src/deep/d.h"), label + "tracked headers copied");
+        ok &= TestUtils::assertTrue(fs::exists(dstDir / "a.h") && fs::file_size(dstDir / "a.h") == 12, label + "modified file copied whole");
+        ok &= TestUtils::assertFalse(fs::exists(dstDir / "deleted.h"), label + "deleted file skipped");
+        ok &= TestUtils::assertFalse(fs::exists(dstDir / "untracked.h"), label + "untracked file skipped");
+        ok &= TestUtils::assertFalse(fs::exists(dstDir / "conflict.h") || fs::exists(dstDir / "link.h"), label + "unmerged and symlink entries skipped");
+        ok &= TestUtils::assertFalse(fs::exists(dstDir / "build") || fs::exists(dstDir / "src/c.cpp"), label + "filters applied");
+
+        // A source inside the checkout only gets its own subtree
+        fs::remove_all(dstDir);
+        options.sources = { repo / "src" };
+        FileCopier::copyFiltered(options);
+        ok &= TestUtils::assertTrue(fs::exists(dstDir / "b.h") && fs::exists(dstDir / "deep/d.h") && !fs::exists(dstDir / "a.h"), label + "subdirectory source");
+    }
+
+    cleanupTestEnvironment(testRoot);
+    return ok;
+}
+
+// Tests that listed files are filtered and placed like scanned ones, and invalid entries are skipped
+bool FileCopierTest::testFilesFrom() {
+    const fs::path testRoot = "test_workspace";
+    const fs::path srcDir = testRoot / "source";
+    const fs::path dstDir = testRoot / "destination";
+    const fs::path listFile = testRoot / "files.lst";
+
+    fs::remove_all(testRoot);
+    for (const char* file : { "a.h", "src/b.cpp", "src/c.h", "src/d.h", "build/x.h", "with space.h" }) {
+        const fs::path path = srcDir / file;
+        fs::create_directories(path.parent_path());
+        std::ofstream(path) << file;
+    }
+    const std::string absolute = fs::absolute(srcDir / "src" / "c.h").string();
+
+    PruneOptions options;
+    options.sources = { srcDir };
+    options.destinations = { dstDir };
+    options.types = { "*.h" };
+    options.excludeDirs = { "build" };
+    options.logLevel = LogLevel::Warning;
+
+    bool ok = true;
+    for (const char delimiter : { '\0', '\n' }) {
+        const std::string label = delimiter == '\0' ? "FilesFrom NUL: " : "FilesFrom newline: ";
+        fs::remove_all(dstDir);
+        {
+            std::ofstream list(listFile, std::ios::binary);
+            for (const std::string& entry : { std::string("./a.h"), std::string("src/b.cpp"), absolute, std::string("build/x.h"),
+                                              std::string("../outside.h"), std::string("missing.h"), std::string("with space.h") }) {
+                list << entry << (delimiter == '\n' ? "\r\n" : "") << (delimiter == '\0' ? std::string(1, '\0') : "");
+            }
+        }
+        options.filesFrom = listFile;
+        options.filters.reset();
+        FileCopier::copyFiltered(options);
+
+        ok &= TestUtils::assertTrue(fs::exists(dstDir / "a.h") && fs::exists(dstDir / "with space.h"), label + "listed files copied");
+        ok &= TestUtils::assertTrue(fs::exists(dstDir / "src/c.h"), label + "absolute entry below the source");
+        ok &= TestUtils::assertFalse(fs::exists(dstDir / "src/d.h"), label + "unlisted file not copied");
+        ok &= TestUtils::assertFalse(fs::exists(dstDir / "src/b.cpp") || fs::exists(dstDir / "build"), label + "filters applied");
+    }
+
+    cleanupTestEnvironment(testRoot);
+    return ok;
+}
+
+// Tests that every listing producer reports the directory relative to the source root
+// and that the planner builds the same targets from it as the old fs::relative based code
+bool FileCopierTest::testTargetPaths() {
+    const fs::path testRoot = "test_workspace";
+    const fs::path srcDir = testRoot / "source";
+    const fs::path dstDir = testRoot / "destination";
+    const fs::path listFile = testRoot / "files.lst";
+
+    fs::remove_all(testRoot);
+    const std::vector<std::string> files = { "top.txt", "a/one.txt", "a/b/two.txt", "a/b/c/three.txt", "d/four.txt" };
+    for (const auto& file : files) {
+        const fs::path path = srcDir / file;
+        fs::create_directories(path.parent_path());
+        std::ofstream(path) << file;
+    }
+    {
+        std::ofstream list(listFile);
+        for (const auto& file : files) list << file << "\n";
+    }
+
+    // Relative directory of each listing must match its directory (empty for the root)
+    auto relativeDirsMatch = [&](const std::vector<DirectoryListing>& listings) {
+        size_t count = 0;
+        for (const auto& listing : listings) {
+            const fs::path expected = listing.directory == srcDir ? fs::path() : listing.directory.lexically_relative(srcDir);
+            if (listing.relativeDir != expected) return false;
+            count += listing.files.size();
+        }
+        return count == files.size();
+    };
+
+    const auto filters = std::make_shared<const FilterSet>();
+    std::vector<DirectoryListing> listed;
+    FileList(listFile).walk(srcDir, *filters, [&](DirectoryListing& listing) { listed.push_back(std::move(listing)); });
+
+    bool ok = true;
+    ok &= TestUtils::assertTrue(relativeDirsMatch(DirectoryWalker(filters, 1).collect(srcDir)), "TargetPaths: serial walker relative dirs");
+    ok &= TestUtils::assertTrue(relativeDirsMatch(DirectoryWalker(filters, 4).collect(srcDir)), "TargetPaths: parallel walker relative dirs");
+    ok &= TestUtils::assertTrue(relativeDirsMatch(listed), "TargetPaths: file list relative dirs");
+
+    PruneOptions options;
+    TaskPlanner planner(options);
+    const fs::path file = srcDir / "a" / "b" / "two.txt";
+    ok &= TestUtils::assertEqual((dstDir / "a" / "b" / "two.txt").string(),
+        planner.resolveTargetPath(fs::path("a") / "b", file, dstDir).string(), "TargetPaths: structure kept");
+    ok &= TestUtils::assertEqual((dstDir / "top.txt").string(),
+        planner.resolveTargetPath({}, srcDir / "top.txt", dstDir).string(), "TargetPaths: root file without separator");
+    options.flatten = true;
+    ok &= TestUtils::assertEqual((dstDir / "two.txt").string(),
+        planner.resolveTargetPath(fs::path("a") / "b", file, dstDir).string(), "TargetPaths: flatten");
+    options.flattenWithSuffix = true;
+    ok &= TestUtils::assertEqual((dstDir / "a_b_two.txt").string(),
+        planner.resolveTargetPath(fs::path("a") / "b", file, dstDir).string(), "TargetPaths: flatten with suffix");
+
+    cleanupTestEnvironment(testRoot);
+    return ok;
+}
+
+// Tests that directories are created once with their parents, in parallel, and that a file in the way is reported
+bool FileCopierTest::testDirectoryCache() {
+    const fs::path testRoot = "test_workspace";
+    const fs::path srcDir = testRoot / "source";
+    const fs::path dstDir = testRoot / "destination";
+
+    fs::remove_all(testRoot);
+    bool ok = true;
+
+    DirectoryCache cache;
+    cache.ensure(dstDir / "a" / "b" / "c");
+    ok &= TestUtils::assertTrue(fs::is_directory(dstDir / "a" / "b" / "c"), "DirectoryCache: nested directory created");
+    const size_t known = cache.size();
+    cache.ensure(dstDir / "a" / "b");
+    ok &= TestUtils::assertEqual(known, cache.size(), "DirectoryCache: parents were cached on the way");
+
+    std::vector<fs::path> dirs;
+    for (int i = 0; i < 200; ++i) {
+        dirs.push_back(dstDir / "wide" / ("d" + std::to_string(i % 50)) / ("e" + std::to_string(i % 7)));
+    }
+    cache.ensureAll(dirs, 8);
+    ok &= TestUtils::assertTrue(std::all_of(dirs.begin(), dirs.end(), [](const fs::path& dir) { return fs::is_directory(dir); }),
+        "DirectoryCache: parallel skeleton created");
+
+    std::ofstream(dstDir / "file") << "x";
+    bool threw = false;
+    try {
+        cache.ensure(dstDir / "file" / "sub");
+    }
+    catch (const fs::filesystem_error&) {
+        threw = true;
+    }
+    ok &= TestUtils::assertTrue(threw, "DirectoryCache: file in the way reported");
+
+    // OpenMP mode creates the skeleton before copying
+    fs::remove_all(dstDir);
+    for (const char* file : { "x/1.txt", "x/y/2.txt", "z/3.txt" }) {
+        fs::create_directories((srcDir / file).parent_path());
+        std::ofstream(srcDir / file) << file;
+    }
+    PruneOptions options;
+    options.sources = { srcDir };
+    options.destinations = { dstDir, testRoot / "mirror" };
+    options.types = { "*.txt" };
+    options.parallelMode = ParallelMode::OpenMP;
+    options.threadCount = 4;
+    options.logLevel = LogLevel::Warning;
+    FileCopier::copyFiltered(options);
+    ok &= TestUtils::assertTrue(fs::exists(dstDir / "x/y/2.txt") && fs::exists(testRoot / "mirror/z/3.txt"), "DirectoryCache: skeleton copy");
+
+    cleanupTestEnvironment(testRoot);
+    return ok;
+}
+
+// Tests that handles are bounded by the LRU capacity, stay usable after eviction,
+// and that deep trees are copied correctly relative to them
+bool FileCopierTest::testFdRelative() {
+    if (!DirectoryHandles::supported()) {
+        return TestUtils::assertFalse(false, "FdRelative: not supported on this platform, skipped");
+    }
+
+    const fs::path testRoot = "test_workspace";
+    const fs::path srcDir = testRoot / "source";
+
+    fs::remove_all(testRoot);
+    fs::path deep = srcDir;
+    for (int level = 0; level < 15; ++level) {
+        deep /= "level_" + std::to_string(level) + "_with_a_rather_long_directory_name";
+    }
+    fs::create_directories(deep);
+    for (const fs::path& dir : { srcDir, srcDir / "level_0_with_a_rather_long_directory_name", deep }) {
+        for (int f = 0; f < 5; ++f) {
+            std::ofstream(dir / ("file" + std::to_string(f) + ".txt")) << dir.string() << f;
+        }
+    }
+
+    bool ok = true;
+    DirectoryHandles handles(2);
+    const fs::path made = testRoot / "made" / "a" / "b";
+    const auto created = handles.open(made, true);
+    ok &= TestUtils::assertTrue(fs::is_directory(made) && created->fd() >= 0, "FdRelative: missing levels created");
+    handles.open(deep);
+    ok &= TestUtils::assertTrue(handles.size() <= 2, "FdRelative: cache bounded by its capacity");
+    ok &= TestUtils::assertTrue(handles.open(made) != created, "FdRelative: evicted directory reopened");
+
+    auto readAll = [](const fs::path& p) {
+        std::ifstream in(p, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    };
+    for (ParallelMode mode : { ParallelMode::None, ParallelMode::Thread }) {
+        const std::string name = mode == ParallelMode::None ? "serial" : "thread";
+        const fs::path dstDir = testRoot / ("destination_" + name);
+
+        PruneOptions options;
+        options.sources = { srcDir };
+        options.destinations = { dstDir };
+        options.fdRelative = true;
+        options.parallelMode = mode;
+        options.threadCount = 4;
+        options.logLevel = LogLevel::Warning;
+        FileCopier::copyFiltered(options);
+
+        const fs::path deepTarget = dstDir / deep.lexically_relative(srcDir) / "file4.txt";
+        ok &= TestUtils::assertEqual(readAll(deep / "file4.txt"), readAll(deepTarget), "FdRelative: deep file copied (" + name + ")");
+        ok &= TestUtils::assertEqual(readAll(srcDir / "file0.txt"), readAll(dstDir / "file0.txt"), "FdRelative: root file copied (" + name + ")");
+    }
+
+    cleanupTestEnvironment(testRoot);
+    return ok;
+}
+
+// Tests files, pruned and symlinked directories, links to files, dangling links,
+// stats and a directory larger than one getdents64 batch on both readers
+bool FileCopierTest::testNativeReader() {
+    if (!DirectoryReader::supported()) {
+        return TestUtils::assertFalse(false, "NativeReader: not supported on this platform, skipped");
+    }
+
+    const fs::path testRoot = "test_workspace";
+    const fs::path srcDir = testRoot / "source";
+
+    fs::remove_all(testRoot);
+    fs::create_directories(srcDir / "sub" / "deep");
+    fs::create_directories(srcDir / "build");
+    fs::create_directories(srcDir / "big");
+    std::ofstream(srcDir / "a.txt") << "a";
+    std::ofstream(srcDir / "sub" / "b.txt") << "bb";
+    std::ofstream(srcDir / "sub" / "deep" / "c.txt") << "ccc";
+    std::ofstream(srcDir / "build" / "skipped.txt") << "x";
+    for (int i = 0; i < 3000; ++i) {
+        std::ofstream(srcDir / "big" / ("a_rather_long_file_name_to_fill_the_buffer_" + std::to_string(i) + ".txt"));
+    }
+    fs::create_directory_symlink("sub", srcDir / "linkdir");
+    fs::create_directory_symlink("sub", srcDir / "build_link");
+    fs::create_symlink("a.txt", srcDir / "linkfile.txt");
+    fs::create_symlink("missing.txt", srcDir / "dangling.txt");
+
+    const auto filters = std::make_shared<const FilterSet>(std::vector<std::string>{}, std::vector<std::string>{},
+        std::vector<std::string>{ "build*" });
+    auto scan = [&](bool native, unsigned threads) {
+        DirectoryWalker walker(filters, threads);
+        walker.setUseNativeReader(native);
+        walker.setCollectStats(true);
+        return walker.collect(srcDir);
+    };
+    auto sameListings = [](const std::vector<DirectoryListing>& a, const std::vector<DirectoryListing>& b) {
+        if (a.size() != b.size()) return false;
+        for (size_t i = 0; i < a.size(); ++i) {
+            if (a[i].directory != b[i].directory || a[i].relativeDir != b[i].relativeDir ||
+                a[i].files != b[i].files || a[i].skippedDirs != b[i].skippedDirs || a[i].stats.size() != b[i].stats.size()) {
+                return false;
+            }
+            for (size_t f = 0; f < a[i].stats.size(); ++f) {
+                if (a[i].stats[f].size != b[i].stats[f].size || a[i].stats[f].mtimeNs != b[i].stats[f].mtimeNs) return false;
+            }
+        }
+        return true;
+    };
+
+    const std::vector<DirectoryListing> expected = scan(false, 1);
+    const std::vector<DirectoryListing> native = scan(true, 1);
+
+    bool ok = true;
+    ok &= TestUtils::assertTrue(sameListings(expected, native), "NativeReader: same listings as std::filesystem");
+    ok &= TestUtils::assertTrue(sameListings(expected, scan(true, 4)), "NativeReader: same listings with parallel walker");
+    ok &= TestUtils::assertEqual(size_t(4), native.size(), "NativeReader: symlinked directory not followed");
+    ok &= TestUtils::assertTrue(std::any_of(native.begin(), native.end(), [](const DirectoryListing& l) {
+        return l.files.size() == 3000; }), "NativeReader: large directory read over several batches");
+
+    cleanupTestEnvironment(testRoot);
+    return ok;
+}
+
+// Tests that a second walk serves unchanged directories from the cache with identical listings,
+// that changed directories are read again, racy stamps are not saved and a damaged file is ignored
+bool FileCopierTest::testScanCache() {
+    const fs::path testRoot = "test_workspace";
+    const fs::path srcDir = testRoot / "source";
+    const fs::path dstDir = testRoot / "destination";
+    const fs::path cacheDir = testRoot / "cache";
+
+    fs::remove_all(testRoot);
+    for (const char* file : { "a.txt", "sub/b.txt", "sub/deep/c.txt", "build/x.txt", "other/d.txt" }) {
+        fs::create_directories((srcDir / file).parent_path());
+        std::ofstream(srcDir / file) << file;
+    }
+
+    const auto filters = std::make_shared<const FilterSet>(std::vector<std::string>{}, std::vector<std::string>{},
+        std::vector<std::string>{ "build" });
+    // Walks with a fresh cache object (as a new run would); no racy window, the tree is older than the cache
+    auto walk = [&](ScanCache& cache) {
+        DirectoryWalker walker(filters, 2);
+        walker.setScanCache(&cache);
+        std::vector<DirectoryListing> listings = walker.collect(srcDir);
+        cache.save();
+        return listings;
+    };
+    auto sameFiles = [](const std::vector<DirectoryListing>& a, const std::vector<DirectoryListing>& b) {
+        if (a.size() != b.size()) return false;
+        for (size_t i = 0; i < a.size(); ++i) {
+            if (a[i].files != b[i].files || a[i].skippedDirs != b[i].skippedDirs || a[i].relativeDir != b[i].relativeDir) return false;
+        }
+        return true;
+    };
+
+    bool ok = true;
+    ScanCache first(cacheDir, srcDir, 0);
+    const std::vector<DirectoryListing> expected = walk(first);
+    ok &= TestUtils::assertEqual(size_t(4), first.misses(), "ScanCache: first run reads every directory");
+
+    ScanCache second(cacheDir, srcDir, 0);
+    ok &= TestUtils::assertTrue(sameFiles(expected, walk(second)), "ScanCache: cached listings identical");
+    ok &= TestUtils::assertEqual(size_t(4), second.hits(), "ScanCache: unchanged directories served from the cache");
+
+    std::ofstream(srcDir / "sub" / "new.txt") << "new";
+    ScanCache third(cacheDir, srcDir, 0);
+    const std::vector<DirectoryListing> changed = walk(third);
+    ok &= TestUtils::assertEqual(size_t(1), third.misses(), "ScanCache: only the changed directory is read");
+    ok &= TestUtils::assertTrue(std::any_of(changed.begin(), changed.end(), [&](const DirectoryListing& l) {
+        return std::find(l.files.begin(), l.files.end(), srcDir / "sub" / "new.txt") != l.files.end(); }), "ScanCache: new file found");
+
+    // Everything changed "just now" from the point of view of a large racy window
+    ScanCache racy(cacheDir, srcDir, 3600ll * 1000000000);
+    walk(racy);
+    ScanCache afterRacy(cacheDir, srcDir, 0);
+    walk(afterRacy);
+    ok &= TestUtils::assertEqual(size_t(0), afterRacy.hits(), "ScanCache: racy directories not saved");
+
+    std::ofstream(afterRacy.file(), std::ios::binary | std::ios::trunc) << "PCSC garbage";
+    ScanCache damaged(cacheDir, srcDir, 0);
+    ok &= TestUtils::assertTrue(sameFiles(changed, walk(damaged)) && damaged.hits() == 0,
+        "ScanCache: damaged cache ignored");
+
+    // End to end through the copier
+    PruneOptions options;
+    options.sources = { srcDir };
+    options.destinations = { dstDir };
+    options.excludeDirs = { "build" };
+    options.scanCacheDir = cacheDir;
+    options.logLevel = LogLevel::Warning;
+    FileCopier::copyFiltered(options);
+    fs::remove_all(dstDir);
+    FileCopier::copyFiltered(options);
+    ok &= TestUtils::assertTrue(fs::exists(dstDir / "sub" / "deep" / "c.txt") && !fs::exists(dstDir / "build"), "ScanCache: copy with cache");
+
+    cleanupTestEnvironment(testRoot);
+    return ok;
+}
+
+// Tests that flattened files with the same name are written whole (one source each) and the last
+// planned one wins, and that sources without colliding targets keep fan-out and io_uring batches
+bool FileCopierTest::testSharedTargets() {
+    const fs::path testRoot = "test_workspace";
+    const fs::path srcDir = testRoot / "source";
+
+    fs::remove_all(testRoot);
+    for (int d = 0; d < 40; ++d) {
+        const fs::path dir = srcDir / ("d" + std::to_string(10 + d));
+        fs::create_directories(dir);
+        std::ofstream(dir / "f.bin", std::ios::binary) << std::string(256 * 1024, static_cast<char>('A' + d % 26));
+    }
+    const std::string last(256 * 1024, static_cast<char>('A' + 39 % 26));
+
+    bool ok = true;
+    // Each file must come from a single source (a uniform byte pattern)
+    auto whole = [](const fs::path& file) {
+        std::ifstream in(file, std::ios::binary);
+        const std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        return data.size() == 256 * 1024 && data.find_first_not_of(data[0]) == std::string::npos;
+    };
+    for (const auto mode : { ParallelMode::None, ParallelMode::Thread, ParallelMode::Async, ParallelMode::OpenMP }) {
+        const fs::path dstDir = testRoot / ("destination" + std::to_string(static_cast<int>(mode)));
+        PruneOptions options;
+        options.sources = { srcDir };
+        options.destinations = { dstDir };
+        options.flatten = true;
+        options.forceOverwrite = true;
+        options.parallelMode = mode;
+        options.threadCount = 8;
+        options.copyEngine = CopyEngineMode::ReadWrite;
+        options.logLevel = LogLevel::Warning;
+        FileCopier::copyFiltered(options);
+
+        const std::string label = "SharedTargets (mode " + std::to_string(static_cast<int>(mode)) + "): ";
+        ok &= TestUtils::assertTrue(whole(dstDir / "f.bin"), label + "target written by one source");
+        if (mode == ParallelMode::None || mode == ParallelMode::OpenMP) {
+            // Planned in directory order, so the last directory wins
+            std::ifstream in(dstDir / "f.bin", std::ios::binary);
+            ok &= TestUtils::assertTrue(std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>()) == last,
+                label + "last planned source wins");
+        }
+    }
+
+    // Two sources without a common file: nothing is repeated, so the fast paths stay in use
+    const fs::path srcB = testRoot / "sourceB";
+    fs::create_directories(srcB);
+    std::ofstream(srcB / "g.bin", std::ios::binary) << "only in B";
+    auto methodCount = [](const FileCopier& copier, CopyMethod method) {
+        return copier.copyStats().files[static_cast<size_t>(method)].load();
+    };
+    PruneOptions options;
+    options.sources = { srcDir, srcB };
+    options.destinations = { testRoot / "fanA", testRoot / "fanB" };
+    options.reflink = ReflinkMode::Never;
+    options.logLevel = LogLevel::Warning;
+    FileCopier fanOut(options);
+    fanOut.execute();
+    ok &= TestUtils::assertEqual(size_t(82), methodCount(fanOut, CopyMethod::FanOut), "SharedTargets: sources without collisions fan out");
+
+    if (UringCopier(2).ready()) {
+        options.destinations = { testRoot / "uring" };
+        options.copyEngine = CopyEngineMode::IoUring;
+        options.parallelMode = ParallelMode::Thread;
+        options.threadCount = 2;
+        FileCopier uring(options);
+        uring.execute();
+        ok &= TestUtils::assertEqual(size_t(41), methodCount(uring, CopyMethod::IoUring), "SharedTargets: sources without collisions use io_uring");
+    }
+
+    cleanupTestEnvironment(testRoot);
+    return ok;
+}
+
+// Tests prompts at the end of stdin (closed, or drained by --files-from -): every
+// conflict is skipped, existing targets are kept and the other files are still copied
+bool FileCopierTest::testPromptEndOfInput() {
+    const fs::path testRoot = "test_workspace";
+    const fs::path srcA = testRoot / "srcA";
+    const fs::path srcB = testRoot / "srcB";
+    const fs::path dstDir = testRoot / "destination";
+
+    auto read = [](const fs::path& file) {
+        std::ifstream in(file);
+        std::string content;
+        std::getline(in, content);
+        return content;
+    };
+
+    bool ok = true;
+    for (const ParallelMode mode : { ParallelMode::None, ParallelMode::Async }) {
+        const std::string label = std::string("PromptEndOfInput ") + (mode == ParallelMode::None ? "serial" : "async") + ": ";
+        for (const bool flatten : { false, true }) {
+            fs::remove_all(testRoot);
+            for (const fs::path& src : { srcA, srcB }) {
+                fs::create_directories(src / "sub");
+                std::ofstream(src / "sub" / "same.txt") << "new";
+            }
+            std::ofstream(srcA / "only.txt") << "new";
+            fs::create_directories(dstDir / "sub");
+            std::ofstream(dstDir / "sub" / "same.txt") << "old";
+            std::ofstream(dstDir / "same.txt") << "old";
+
+            PruneOptions options;
+            options.sources = { srcA, srcB };
+            options.destinations = { dstDir };
+            options.flatten = flatten;
+            options.parallelMode = mode;
+            options.threadCount = 2;
+            options.logLevel = LogLevel::Warning;
+
+            std::istringstream input("");
+            std::streambuf* originalCin = std::cin.rdbuf(input.rdbuf());
+            FileCopier::copyFiltered(options);
+            std::cin.rdbuf(originalCin);
+            std::cin.clear();
+
+            const fs::path conflict = flatten ? dstDir / "same.txt" : dstDir / "sub" / "same.txt";
+            const std::string kind = flatten ? "flatten " : "overwrite ";
+            ok &= TestUtils::assertEqual(std::string("old"), read(conflict), label + kind + "existing target kept");
+            ok &= TestUtils::assertEqual(std::string("new"), read(dstDir / "only.txt"), label + kind + "other file copied");
+            ok &= TestUtils::assertFalse(fs::exists(dstDir / "same(1).txt"), label + kind + "no rename chosen");
+        }
+    }
+
+    // Input ending right after [r]ename (no name, no blank line) skips the conflict as well
+    fs::remove_all(testRoot);
+    for (const fs::path& src : { srcA, srcB }) {
+        fs::create_directories(src);
+        std::ofstream(src / "same.txt") << "new";
+    }
+    fs::create_directories(dstDir);
+    std::ofstream(dstDir / "same.txt") << "old";
+
+    PruneOptions options;
+    options.sources = { srcA, srcB };
+    options.destinations = { dstDir };
+    options.flatten = true;
+    options.logLevel = LogLevel::Warning;
+
+    std::istringstream input("r");
+    std::streambuf* originalCin = std::cin.rdbuf(input.rdbuf());
+    FileCopier::copyFiltered(options);
+    std::cin.rdbuf(originalCin);
+    std::cin.clear();
+
+    ok &= TestUtils::assertEqual(std::string("old"), read(dstDir / "same.txt"), "PromptEndOfInput rename: existing target kept");
+    ok &= TestUtils::assertFalse(fs::exists(dstDir / "same(1).txt"), "PromptEndOfInput rename: no rename chosen");
+
+    cleanupTestEnvironment(testRoot);
+    return ok;
+}
+
+// Tests the prompt broker on its own: an exception while resolving a request doesn't end
+// the broker thread and is rethrown by finish(); after stop() nothing is asked anymore
+bool FileCopierTest::testPromptBrokerErrors() {
+    PruneOptions options;
+    options.logLevel = LogLevel::Warning;
+    TaskPlanner planner(options);
+
+    FileTask conflict;
+    conflict.source = "test_broker/src/a.txt";
+    conflict.target = "test_broker/out/a.txt";
+    conflict.action = TaskAction::Conflict;
+
+    bool ok = true;
+
+    // Both requests are answered although handing over the first one failed
+    std::istringstream input("y\ny\n");
+    std::streambuf* originalCin = std::cin.rdbuf(input.rdbuf());
+    int accepted = 0;
+    bool threw = false;
+    {
+        PromptBroker broker(planner, false, nullptr, [&](FileTask&&) {
+            ++accepted;
+            throw std::runtime_error("accept failed");
+            });
+        broker.post(conflict);
+        broker.post(conflict);
+        try {
+            broker.finish();
+        }
+        catch (const std::runtime_error&) {
+            threw = true;
+        }
+    }
+    ok &= TestUtils::assertTrue(threw, "PromptBroker: error rethrown by finish()");
+    ok &= TestUtils::assertEqual(2, accepted, "PromptBroker: loop kept running after an error");
+
+    // A stopped broker drops its requests without reading the console
+    std::istringstream unread("y\n");
+    std::cin.rdbuf(unread.rdbuf());
+    accepted = 0;
+    {
+        PromptBroker broker(planner, false, nullptr, [&](FileTask&&) { ++accepted; });
+        broker.stop();
+        broker.post(conflict);
+        broker.finish();
+    }
+    std::cin.rdbuf(originalCin);
+    std::string rest;
+    std::getline(unread, rest);
+    ok &= TestUtils::assertEqual(0, accepted, "PromptBroker: nothing accepted after stop()");
+    ok &= TestUtils::assertEqual(std::string("y"), rest, "PromptBroker: no prompt after stop()");
+
+    return ok;
+}
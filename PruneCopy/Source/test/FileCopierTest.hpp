@@ -69,4 +69,119 @@ private:
      * @brief Tests auto-renaming behavior in flatten mode.
      */
     static bool testFlattenAutoRename();
+
+    /**
+     * @brief Tests the parallel directory walker against the serial walk and copies in thread mode.
+     */
+    static bool testParallelWalker();
+
+    /**
+     * @brief Tests the threaded scan/plan/copy pipeline including conflict planning.
+     */
+    static bool testThreadPipeline();
+
+    /**
+     * @brief Tests async mode: conflicts are answered by the prompt broker, sticky answers apply to all.
+     */
+    static bool testAsyncPromptBroker();
+
+    /**
+     * @brief Tests the OpenMP backend (or its serial fallback without OpenMP).
+     */
+    static bool testOpenMPMode();
+
+    /**
+     * @brief Tests every copy engine mode (content, truncation of larger targets, copy onto itself).
+     */
+    static bool testCopyEngine();
+
+    /**
+     * @brief Tests the reflink modes (clone where supported, fallback or error otherwise).
+     */
+    static bool testReflink();
+
+    /**
+     * @brief Tests the io_uring copy engine (or its fallback when io_uring is unavailable).
+     */
+    static bool testIoUringEngine();
+
+    /**
+     * @brief Tests the read-once, write-many fan-out to several destinations.
+     */
+    static bool testFanOut();
+
+    /**
+     * @brief Tests the destination index and planning against it.
+     */
+    static bool testDestinationIndex();
+
+    /**
+     * @brief Tests --only-newer with mtime tolerance and the size compare policy.
+     */
+    static bool testOnlyNewer();
+
+    /**
+     * @brief Tests path patterns in --types, --exclude-files and --exclude-dirs and subtree pruning.
+     */
+    static bool testPathPatterns();
+
+    /**
+     * @brief Tests an ordered --rules file and directory pruning by rules.
+     */
+    static bool testRules();
+
+    /**
+     * @brief Tests --ignore-files with nested ignore files, negation and pruned directories.
+     */
+    static bool testIgnoreFiles();
+
+    /**
+     * @brief Tests --source-list git with hand-written index files (versions 2 and 4).
+     */
+    static bool testGitIndex();
+
+    /**
+     * @brief Tests --files-from with NUL- and newline-delimited lists.
+     */
+    static bool testFilesFrom();
+
+    /**
+     * @brief Tests the relative directories of the listings and the lexical target resolution.
+     */
+    static bool testTargetPaths();
+
+    /**
+     * @brief Tests the DirectoryCache and the skeleton pre-pass.
+     */
+    static bool testDirectoryCache();
+
+    /**
+     * @brief Tests the directory handle cache and copying with --fd-relative.
+     */
+    static bool testFdRelative();
+
+    /**
+     * @brief Tests that the getdents64 reader produces the same listings as std::filesystem.
+     */
+    static bool testNativeReader();
+
+    /**
+     * @brief Tests the persistent scan cache (--scan-cache).
+     */
+    static bool testScanCache();
+
+    /**
+     * @brief Tests that tasks writing the same target never interleave and the last planned one wins.
+     */
+    static bool testSharedTargets();
+
+    /**
+     * @brief Tests that overwrite and flatten prompts skip their conflicts once stdin is exhausted.
+     */
+    static bool testPromptEndOfInput();
+
+    /**
+     * @brief Tests that the prompt broker hands back its errors and stops asking once stopped.
+     */
+    static bool testPromptBrokerErrors();
 };
@@ -0,0 +1,94 @@
+/*****************************************************************//**
+ * @file   FileStat.cpp
+ * @brief  Implements the single-call file metadata lookup
+ *
+ * @author Patrik Neunteufel
+ * @date   May 2025
+ *********************************************************************/
+
+#include "util/FileStat.hpp"
+
+#include <cerrno>
+#include <chrono>
+#include <system_error>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/stat.h>
+#endif
+
+namespace fs = std::filesystem;
+
+#ifndef _WIN32
+
+// POSIX: one stat call delivers size and mtime (std::filesystem would need two calls)
+FileStat FileStat::of(const fs::path& path) {
+    return at(AT_FDCWD, path.c_str());
+}
+
+// Linux uses statx and only requests the fields that are needed (cheaper on network filesystems)
+FileStat FileStat::at(int dirFd, const char* name) {
+    FileStat result;
+#if defined(__linux__) && defined(STATX_MTIME)
+    struct statx stx {};
+    if (::statx(dirFd, name, 0, STATX_TYPE | STATX_SIZE | STATX_MTIME, &stx) == 0) {
+        if (!S_ISREG(stx.stx_mode)) return result;
+        result.exists = true;
+        result.size = static_cast<std::uintmax_t>(stx.stx_size);
+        result.mtimeNs = static_cast<std::int64_t>(stx.stx_mtime.tv_sec) * 1000000000 + stx.stx_mtime.tv_nsec;
+        return result;
+    }
+    if (errno != ENOSYS) return result; // old kernels: fall through to stat()
+#endif
+    struct stat st {};
+    if (::fstatat(dirFd, name, &st, 0) != 0 || !S_ISREG(st.st_mode)) {
+        return result;
+    }
+    result.exists = true;
+    result.size = static_cast<std::uintmax_t>(st.st_size);
+    result.mtimeNs = static_cast<std::int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    return result;
+}
+
+// POSIX directory iteration only caches the file type, so stat the path
+FileStat FileStat::of(const fs::directory_entry& entry) {
+    return of(entry.path());
+}
+
+#else
+
+namespace {
+
+    // Converts a filesystem timestamp to nanoseconds since the Unix epoch
+    std::int64_t toUnixNs(fs::file_time_type time) {
+        const auto sys = std::chrono::file_clock::to_sys(time);
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(sys.time_since_epoch()).count();
+    }
+
+}
+
+// Windows: size and mtime come from a single attribute query
+FileStat FileStat::of(const fs::path& path) {
+    std::error_code ec;
+    return of(fs::directory_entry(path, ec));
+}
+
+// Windows: directory iteration already cached size and mtime in the entry
+FileStat FileStat::of(const fs::directory_entry& entry) {
+    FileStat result;
+    std::error_code ec;
+    if (!entry.is_regular_file(ec) || ec) {
+        return result;
+    }
+    const std::uintmax_t size = entry.file_size(ec);
+    if (ec) return result;
+    const fs::file_time_type time = entry.last_write_time(ec);
+    if (ec) return result;
+
+    result.exists = true;
+    result.size = size;
+    result.mtimeNs = toUnixNs(time);
+    return result;
+}
+
+#endif
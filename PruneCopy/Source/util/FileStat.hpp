@@ -0,0 +1,42 @@
+/*****************************************************************//**
+ * @file   FileStat.hpp
+ * @brief  Size and modification time of a file from a single stat call
+ *
+ * @author Patrik Neunteufel
+ * @date   May 2025
+ *********************************************************************/
+
+#pragma once
+#include <cstdint>
+#include <filesystem>
+
+/**
+ * @brief Metadata needed for copy decisions (existence, size, mtime).
+ */
+struct FileStat {
+	bool exists = false;      // Whether the path exists as a regular file
+	std::uintmax_t size = 0;  // File size in bytes
+	std::int64_t mtimeNs = 0; // Last write time in nanoseconds since the Unix epoch
+
+	/**
+	 * @brief Reads the metadata of a path with one stat call (never throws).
+	 * @param path The file to stat
+	 */
+	static FileStat of(const std::filesystem::path& path);
+
+	/**
+	 * @brief Reads the metadata of a directory entry (uses the data cached by the
+	 * directory iteration where the platform provides it, e.g. on Windows).
+	 * @param entry The directory entry
+	 */
+	static FileStat of(const std::filesystem::directory_entry& entry);
+
+#ifndef _WIN32
+	/**
+	 * @brief Reads the metadata of a name relative to an open directory (POSIX, never throws).
+	 * @param dirFd Directory descriptor (AT_FDCWD for the working directory)
+	 * @param name Filename (or path) relative to the directory
+	 */
+	static FileStat at(int dirFd, const char* name);
+#endif
+};
@@ -0,0 +1,529 @@
+/*****************************************************************//**
+ * @file   FilterSet.cpp
+ * @brief  Implements pattern classification, the ordered rules and the precompiled filter set
+ *
+ * @author Patrik Neunteufel
+ * @date   May 2025
+ *********************************************************************/
+
+#include "util/FilterSet.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+
+    // Characters that make a pattern a general glob (wildcards and regex syntax kept by globToRegex)
+    constexpr const char* kSpecialChars = "*?[](){}+^$|\\";
+
+    // ASCII-only folding, same as GlobPattern
+    char foldCase(char c) {
+        return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+    }
+
+    std::string toLower(std::string_view text) {
+        std::string result(text);
+        for (char& c : result) c = foldCase(c);
+        return result;
+    }
+
+    // Compares a part of the name with a lower-cased literal
+    bool equalsFolded(std::string_view part, const std::string& lowered) {
+        if (part.size() != lowered.size()) return false;
+        for (size_t i = 0; i < part.size(); ++i) {
+            if (foldCase(part[i]) != lowered[i]) return false;
+        }
+        return true;
+    }
+
+    // The part a '*' covers must not contain line terminators (ECMAScript '.')
+    bool wildcardSpan(std::string_view part) {
+        return part.find_first_of("\n\r") == std::string_view::npos;
+    }
+
+}
+
+// Sorts a pattern into the cheapest class that matches exactly like its glob
+PatternList::PatternClass PatternList::classify(const std::string& pattern) {
+    const size_t special = pattern.find_first_of(kSpecialChars);
+    if (special == std::string::npos) {
+        return PatternClass::Exact;
+    }
+    const std::string_view rest = std::string_view(pattern).substr(1);
+    if (pattern.size() > 2 && pattern[0] == '*' && pattern[1] == '.' &&
+        rest.find_first_of(kSpecialChars) == std::string_view::npos &&
+        rest.find('.', 1) == std::string_view::npos) {
+        return PatternClass::Extension;
+    }
+    if (special == pattern.size() - 1 && pattern.back() == '*') {
+        return PatternClass::Prefix;
+    }
+    return PatternClass::Glob;
+}
+
+// Constructor
+// Classifies every pattern once
+PatternList::PatternList(const std::vector<std::string>& patterns)
+    : m_size(patterns.size()) {
+    std::vector<std::string> plainGlobs;
+    for (const auto& pattern : patterns) {
+        switch (classify(pattern)) {
+        case PatternClass::Exact:
+            m_exact.push_back(toLower(pattern));
+            break;
+        case PatternClass::Extension:
+            m_maxExtension = std::max(m_maxExtension, pattern.size() - 1);
+            m_extensions.insert(toLower(std::string_view(pattern).substr(1)));
+            break;
+        case PatternClass::Prefix:
+            m_prefixes.push_back(toLower(std::string_view(pattern).substr(0, pattern.size() - 1)));
+            break;
+        default:
+            m_globs.emplace_back(pattern, PatternUtils::GlobSyntax::Glob);
+            if (!m_globs.back().usesRegex()) plainGlobs.push_back(pattern);
+            break;
+        }
+    }
+
+    // Several plain globs are cheaper as one automaton; the regex ones stay separate
+    if (plainGlobs.size() > 1) {
+        m_automaton = PatternUtils::GlobAutomaton(plainGlobs);
+        if (m_automaton.ready()) {
+            std::erase_if(m_globs, [](const PatternUtils::GlobPattern& glob) { return !glob.usesRegex(); });
+        }
+    }
+}
+
+// Tries the cheap classes first, the general globs last
+bool PatternList::matches(std::string_view name) const {
+    for (const auto& exact : m_exact) {
+        if (equalsFolded(name, exact)) return true;
+    }
+    if (!m_extensions.empty()) {
+        // Extensions in the set contain exactly one dot, so only the last one of the name can match
+        const size_t dot = name.rfind('.');
+        if (dot != std::string_view::npos && name.size() - dot <= m_maxExtension &&
+            m_extensions.count(toLower(name.substr(dot))) > 0 &&
+            wildcardSpan(name.substr(0, dot))) {
+            return true;
+        }
+    }
+    for (const auto& prefix : m_prefixes) {
+        if (name.size() >= prefix.size() &&
+            equalsFolded(name.substr(0, prefix.size()), prefix) &&
+            wildcardSpan(name.substr(prefix.size()))) {
+            return true;
+        }
+    }
+    if (m_automaton.ready() && m_automaton.matches(name)) {
+        return true;
+    }
+    for (const auto& glob : m_globs) {
+        if (glob.matches(name)) return true;
+    }
+    return false;
+}
+
+// A '/' before the last character makes a path pattern ("build/" is still a name)
+bool PathPatternList::isPathPattern(const std::string& pattern) {
+    const size_t slash = pattern.find('/');
+    return slash != std::string::npos && slash + 1 < pattern.size();
+}
+
+// Constructor
+// Splits every pattern at '/' into positions; empty and "." components are dropped
+PathPatternList::PathPatternList(const std::vector<std::string>& patterns) {
+    for (const auto& pattern : patterns) {
+        std::vector<std::string> components;
+        size_t begin = 0;
+        while (begin <= pattern.size()) {
+            size_t end = pattern.find('/', begin);
+            if (end == std::string::npos) end = pattern.size();
+            std::string component = pattern.substr(begin, end - begin);
+            if (!component.empty() && component != ".") {
+                components.push_back(std::move(component));
+            }
+            begin = end + 1;
+        }
+
+        const std::uint32_t index = static_cast<std::uint32_t>(m_starts.size());
+        m_starts.push_back(static_cast<std::uint32_t>(m_positions.size()));
+        for (size_t i = 0; i < components.size(); ++i) {
+            Position position;
+            position.pattern = index;
+            position.globstar = components[i] == "**";
+            position.last = i + 1 == components.size();
+            if (!position.globstar) {
+                position.glob = PatternUtils::GlobPattern(components[i]);
+            }
+            m_positions.push_back(std::move(position));
+        }
+        Position end;
+        end.end = true;
+        end.pattern = index;
+        m_positions.push_back(std::move(end));
+    }
+}
+
+// Adds a position and everything a "**" reaches by matching no directory
+// (a trailing "**" needs at least one entry: "src/**" matches below src, not src itself)
+void PathPatternList::addClosed(State& state, std::uint32_t position) const {
+    while (true) {
+        state.push_back(position);
+        const Position& p = m_positions[position];
+        if (!p.globstar || p.last) break;
+        ++position;
+    }
+}
+
+// All patterns start at their first component
+PathPatternList::State PathPatternList::rootState() const {
+    State state;
+    for (std::uint32_t start : m_starts) addClosed(state, start);
+    std::sort(state.begin(), state.end());
+    state.erase(std::unique(state.begin(), state.end()), state.end());
+    return state;
+}
+
+// "**" keeps its position, a matching component moves on to the next one
+PathPatternList::State PathPatternList::descend(const State& parent, std::string_view name) const {
+    State state;
+    for (std::uint32_t position : parent) {
+        const Position& p = m_positions[position];
+        if (p.end) continue;
+        if (p.globstar) {
+            addClosed(state, position);
+            if (p.last) state.push_back(position + 1);
+        }
+        else if (p.glob.matches(name)) {
+            addClosed(state, position + 1);
+        }
+    }
+    std::sort(state.begin(), state.end());
+    state.erase(std::unique(state.begin(), state.end()), state.end());
+    return state;
+}
+
+// An entry matches if consuming its name reaches the end of a pattern
+bool PathPatternList::matches(const State& dir, std::string_view name) const {
+    for (std::uint32_t position : dir) {
+        const Position& p = m_positions[position];
+        if (p.end) continue;
+        if (p.globstar ? p.last : (p.last && p.glob.matches(name))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Same as matches, but keeps looking for the lowest pattern index (positions are ordered by pattern)
+std::uint32_t PathPatternList::firstMatch(const State& dir, std::string_view name) const {
+    for (std::uint32_t position : dir) {
+        const Position& p = m_positions[position];
+        if (p.end) continue;
+        if (p.globstar ? p.last : (p.last && p.glob.matches(name))) {
+            return p.pattern;
+        }
+    }
+    return PatternUtils::GlobAutomaton::NoMatch;
+}
+
+// Alive as long as some pattern still has components left
+bool PathPatternList::alive(const State& dir) const {
+    for (std::uint32_t position : dir) {
+        if (!m_positions[position].end) return true;
+    }
+    return false;
+}
+
+namespace {
+
+    // Removes surrounding blanks (and the '\r' of CRLF files)
+    std::string trim(const std::string& text) {
+        const size_t begin = text.find_first_not_of(" \t\r");
+        if (begin == std::string::npos) return {};
+        const size_t end = text.find_last_not_of(" \t\r");
+        return text.substr(begin, end - begin + 1);
+    }
+
+    // A file rule that matches every name
+    bool isCatchAll(const std::string& pattern) {
+        return pattern == "*" || pattern == "**";
+    }
+
+}
+
+// Reads "+ pattern" / "- pattern" lines, skipping blanks and comments
+std::vector<Rule> RuleSet::load(const std::filesystem::path& file) {
+    std::ifstream in(file);
+    if (!in) {
+        throw std::runtime_error("Cannot read rules file: " + file.string());
+    }
+
+    std::vector<Rule> rules;
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(in, line)) {
+        ++lineNumber;
+        const std::string text = trim(line);
+        if (text.empty() || text[0] == '#' || text[0] == ';') continue;
+
+        Rule rule;
+        rule.include = text[0] == '+';
+        rule.pattern = text.size() > 2 ? trim(text.substr(1)) : std::string();
+        if ((text[0] != '+' && text[0] != '-') || (text[1] != ' ' && text[1] != '\t') || rule.pattern.empty()) {
+            throw std::runtime_error("Invalid rule in " + file.string() + ":" + std::to_string(lineNumber) +
+                " (expected '+ pattern' or '- pattern'): " + text);
+        }
+        rules.push_back(std::move(rule));
+    }
+    return rules;
+}
+
+// Sorts the patterns of one kind into automaton, single globs and path patterns
+void RuleSet::Matcher::build(const std::vector<std::pair<std::uint32_t, std::string>>& patterns) {
+    std::vector<std::string> plain;
+    std::vector<std::string> pathPatterns;
+    for (const auto& [rule, pattern] : patterns) {
+        if (PathPatternList::isPathPattern(pattern)) {
+            pathRules.push_back(rule);
+            pathPatterns.push_back(pattern);
+            continue;
+        }
+        PatternUtils::GlobPattern glob(pattern);
+        if (glob.usesRegex()) {
+            globs.emplace_back(rule, std::move(glob));
+        }
+        else {
+            nameRules.push_back(rule);
+            plain.push_back(pattern);
+        }
+    }
+
+    if (!plain.empty()) {
+        automaton = PatternUtils::GlobAutomaton(plain);
+        if (!automaton.ready()) {
+            // Too many states: match the plain patterns one by one as well
+            for (size_t i = 0; i < plain.size(); ++i) {
+                globs.emplace_back(nameRules[i], PatternUtils::GlobPattern(plain[i]));
+            }
+            std::sort(globs.begin(), globs.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+        }
+    }
+    paths = PathPatternList(pathPatterns);
+}
+
+// Lowest rule index among the automaton, the single globs and the path patterns
+std::uint32_t RuleSet::Matcher::firstMatch(std::string_view name, const PathPatternList::State& dir) const {
+    std::uint32_t best = PatternUtils::GlobAutomaton::NoMatch;
+    if (automaton.ready()) {
+        const std::uint32_t match = automaton.firstMatch(name);
+        if (match != PatternUtils::GlobAutomaton::NoMatch) best = nameRules[match];
+    }
+    for (const auto& [rule, glob] : globs) {
+        if (rule >= best) break;
+        if (glob.matches(name)) {
+            best = rule;
+            break;
+        }
+    }
+    if (!paths.empty()) {
+        const std::uint32_t match = paths.firstMatch(dir, name);
+        if (match != PatternUtils::GlobAutomaton::NoMatch) best = std::min(best, pathRules[match]);
+    }
+    return best;
+}
+
+// Constructor
+// Splits the rules into file and directory rules and finds the catch-all exclude
+RuleSet::RuleSet(const std::vector<Rule>& rules)
+    : m_rules(rules) {
+    std::vector<std::pair<std::uint32_t, std::string>> filePatterns;
+    std::vector<std::pair<std::uint32_t, std::string>> dirPatterns;
+    std::vector<std::string> includePaths;
+    bool catchAll = false;
+    bool includeNameBefore = false;
+
+    for (std::uint32_t i = 0; i < m_rules.size(); ++i) {
+        const Rule& rule = m_rules[i];
+        const bool pathRule = PathPatternList::isPathPattern(rule.pattern);
+        m_hasPathRules = m_hasPathRules || pathRule;
+        if (!rule.pattern.empty() && rule.pattern.back() == '/') {
+            dirPatterns.emplace_back(i, rule.pattern.substr(0, rule.pattern.size() - 1));
+            continue;
+        }
+        filePatterns.emplace_back(i, rule.pattern);
+        m_includesFiles = m_includesFiles || rule.include;
+        if (catchAll) continue;
+        if (!rule.include && isCatchAll(rule.pattern)) {
+            catchAll = true;
+        }
+        else if (rule.include && pathRule) {
+            includePaths.push_back(rule.pattern);
+        }
+        else if (rule.include) {
+            includeNameBefore = true;
+        }
+    }
+
+    m_files.build(filePatterns);
+    m_dirs.build(dirPatterns);
+    // Below a catch-all exclude only the include path rules before it can still copy something
+    m_pruneBelowCatchAll = catchAll && !includeNameBefore;
+    if (m_pruneBelowCatchAll) {
+        m_includePaths = PathPatternList(includePaths);
+    }
+}
+
+// Maps a rule index to its decision
+RuleDecision RuleSet::decide(std::uint32_t rule) const {
+    if (rule == PatternUtils::GlobAutomaton::NoMatch) return RuleDecision::None;
+    return m_rules[rule].include ? RuleDecision::Include : RuleDecision::Exclude;
+}
+
+// First matching file rule
+RuleDecision RuleSet::decideFile(std::string_view name, const State& dir) const {
+    return decide(m_files.firstMatch(name, dir.files));
+}
+
+// First matching directory rule
+RuleDecision RuleSet::decideDir(std::string_view name, const State& parent) const {
+    return decide(m_dirs.firstMatch(name, parent.dirs));
+}
+
+// Start states of the path rules
+RuleSet::State RuleSet::rootState() const {
+    return { m_files.paths.rootState(), m_dirs.paths.rootState(), m_includePaths.rootState() };
+}
+
+// Advances the path rules by one directory
+RuleSet::State RuleSet::descend(const State& parent, std::string_view name) const {
+    return {
+        m_files.paths.descend(parent.files, name),
+        m_dirs.paths.descend(parent.dirs, name),
+        m_includePaths.descend(parent.includes, name)
+    };
+}
+
+// Without a catch-all exclude every directory may contain files the rules don't decide
+bool RuleSet::canContainIncluded(const State& dir) const {
+    return !m_pruneBelowCatchAll || m_includePaths.alive(dir.includes);
+}
+
+namespace {
+
+    // Splits a pattern list into name patterns and path patterns
+    void splitPatterns(const std::vector<std::string>& patterns, std::vector<std::string>& names, std::vector<std::string>& paths) {
+        for (const auto& pattern : patterns) {
+            if (PathPatternList::isPathPattern(pattern)) {
+                paths.push_back(pattern);
+            }
+            else if (!pattern.empty() && pattern.back() == '/') {
+                names.push_back(pattern.substr(0, pattern.size() - 1));
+            }
+            else {
+                names.push_back(pattern);
+            }
+        }
+    }
+
+}
+
+// Constructor
+// Compiles include, exclude-file and exclude-dir patterns (names and paths separately)
+FilterSet::FilterSet(const std::vector<std::string>& types, const std::vector<std::string>& excludeFiles,
+    const std::vector<std::string>& excludeDirs, const std::vector<Rule>& rules)
+    : m_rules(rules) {
+    std::vector<std::string> names[3];
+    std::vector<std::string> paths[3];
+    splitPatterns(types, names[0], paths[0]);
+    splitPatterns(excludeFiles, names[1], paths[1]);
+    splitPatterns(excludeDirs, names[2], paths[2]);
+
+    m_types = PatternList(names[0]);
+    m_excludeFiles = PatternList(names[1]);
+    m_excludeDirs = PatternList(names[2]);
+    m_pathTypes = PathPatternList(paths[0]);
+    m_pathExcludeFiles = PathPatternList(paths[1]);
+    m_pathExcludeDirs = PathPatternList(paths[2]);
+    m_hasPathPatterns = !paths[0].empty() || !paths[1].empty() || !paths[2].empty() || m_rules.hasPathRules();
+}
+
+// The first matching rule decides; without one the include and exclude-file patterns do
+FilterSet::FileDecision FilterSet::classifyFile(std::string_view filename, const PathState& dir) const {
+    switch (m_rules.decideFile(filename, dir.rules)) {
+    case RuleDecision::Include:
+        return FileDecision::Copy;
+    case RuleDecision::Exclude:
+        return FileDecision::Excluded;
+    default:
+        break;
+    }
+    if (!isIncluded(filename, dir)) return FileDecision::NotIncluded;
+    if (isExcludedFile(filename, dir)) return FileDecision::Excluded;
+    return FileDecision::Copy;
+}
+
+// Without include patterns every file is included
+bool FilterSet::isIncluded(std::string_view filename) const {
+    return isIncluded(filename, rootState());
+}
+
+// Name patterns match anywhere, path patterns relative to the directory state
+bool FilterSet::isIncluded(std::string_view filename, const PathState& dir) const {
+    if (m_types.empty() && m_pathTypes.empty()) return true;
+    return m_types.matches(filename) || m_pathTypes.matches(dir.types, filename);
+}
+
+// Checks the exclude-file patterns
+bool FilterSet::isExcludedFile(std::string_view filename) const {
+    return isExcludedFile(filename, rootState());
+}
+
+// Checks the exclude-file patterns of a file inside a directory
+bool FilterSet::isExcludedFile(std::string_view filename, const PathState& dir) const {
+    return m_excludeFiles.matches(filename) || m_pathExcludeFiles.matches(dir.excludeFiles, filename);
+}
+
+// Checks the exclude-dir patterns
+bool FilterSet::isExcludedDir(std::string_view dirname) const {
+    return isExcludedDir(dirname, rootState());
+}
+
+// Directory rules decide first, then the exclude-dir patterns
+bool FilterSet::isExcludedDir(std::string_view dirname, const PathState& parent) const {
+    switch (m_rules.decideDir(dirname, parent.rules)) {
+    case RuleDecision::Include:
+        return false;
+    case RuleDecision::Exclude:
+        return true;
+    default:
+        break;
+    }
+    return m_excludeDirs.matches(dirname) || m_pathExcludeDirs.matches(parent.excludeDirs, dirname);
+}
+
+// Start states of all path pattern lists (empty without path patterns)
+FilterSet::PathState FilterSet::rootState() const {
+    if (!m_hasPathPatterns) return {};
+    return { m_pathTypes.rootState(), m_pathExcludeFiles.rootState(), m_pathExcludeDirs.rootState(), m_rules.rootState() };
+}
+
+// Advances all path pattern lists by one directory
+FilterSet::PathState FilterSet::descend(const PathState& parent, std::string_view dirname) const {
+    if (!m_hasPathPatterns) return {};
+    return {
+        m_pathTypes.descend(parent.types, dirname),
+        m_pathExcludeFiles.descend(parent.excludeFiles, dirname),
+        m_pathExcludeDirs.descend(parent.excludeDirs, dirname),
+        m_rules.descend(parent.rules, dirname)
+    };
+}
+
+// Only path-only include lists (unless a rule includes files) and catch-all exclude rules can rule out a whole subtree
+bool FilterSet::canContainIncluded(const PathState& dir) const {
+    if (!m_rules.canContainIncluded(dir.rules)) return false;
+    if (!m_types.empty() || m_pathTypes.empty() || m_rules.includesFiles()) return true;
+    return m_pathTypes.alive(dir.types);
+}
@@ -0,0 +1,403 @@
+/*****************************************************************//**
+ * @file   FilterSet.hpp
+ * @brief  Precompiled include/exclude filters and ordered rules shared by CLI, presets and the copier
+ *
+ * @author Patrik Neunteufel
+ * @date   May 2025
+ *********************************************************************/
+
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "util/PatternUtils.hpp"
+
+/**
+ * @brief One compiled pattern list (glob semantics of PatternUtils::compileGlobs).
+ *
+ * Every pattern is sorted into the cheapest class that answers it exactly:
+ * exact name ("Makefile"), pure extension ("*.cpp"), prefix ("build*") or
+ * general glob (everything else, including patterns with regex syntax).
+ * All pure extensions share one hash set, so a filename needs a single
+ * lookup of its extension no matter how many of them there are, and all
+ * general globs share one PatternUtils::GlobAutomaton that scans the name
+ * once (per-pattern matching if the automaton would get too large).
+ */
+class PatternList {
+public:
+	/**
+	 * @brief How a pattern is matched
+	 */
+	enum class PatternClass { Exact, Extension, Prefix, Glob };
+
+	PatternList() = default;
+
+	/**
+	 * @brief Classifies and compiles the patterns.
+	 * @param patterns Glob patterns (e.g. "*.hpp")
+	 */
+	explicit PatternList(const std::vector<std::string>& patterns);
+
+	/**
+	 * @brief Checks whether any pattern matches the whole name (case-insensitive).
+	 */
+	bool matches(std::string_view name) const;
+
+	/**
+	 * @brief Whether the list has no patterns.
+	 */
+	bool empty() const { return m_size == 0; }
+
+	/**
+	 * @brief Number of patterns in the list.
+	 */
+	size_t size() const { return m_size; }
+
+	/**
+	 * @brief Returns the class a pattern would be sorted into.
+	 */
+	static PatternClass classify(const std::string& pattern);
+
+private:
+	std::vector<std::string> m_exact;               ///< Lower-cased full names
+	std::unordered_set<std::string> m_extensions;   ///< Lower-cased extensions with dot ("*.cpp" -> ".cpp")
+	std::vector<std::string> m_prefixes;            ///< Lower-cased prefixes ("build*" -> "build")
+	std::vector<PatternUtils::GlobPattern> m_globs; ///< Globs not covered by m_automaton (regex syntax, or all if it isn't ready)
+	PatternUtils::GlobAutomaton m_automaton;        ///< Combined DFA of the plain globs
+	size_t m_maxExtension = 0;                      ///< Longest entry of m_extensions
+	size_t m_size = 0;
+};
+
+/**
+ * @brief Path patterns (components separated by '/', "**" for any number of directories)
+ *        matched against the path relative to the source root.
+ *
+ * A pattern is split at '/' into components; "**" stands for any number of
+ * directories (at the end: everything below), every other component is a
+ * GlobPattern for one name. Instead of matching whole paths, the walker
+ * carries a State per directory (the components reachable so far) and
+ * advances it by one name per level, so a subtree is known to be
+ * unmatchable as soon as its State is no longer alive().
+ */
+class PathPatternList {
+public:
+	/**
+	 * @brief Positions (pattern component indices) reachable in a directory, sorted
+	 */
+	using State = std::vector<std::uint32_t>;
+
+	PathPatternList() = default;
+
+	/**
+	 * @brief Splits and compiles the patterns.
+	 * @param patterns Path patterns with '/' as separator (on all platforms)
+	 */
+	explicit PathPatternList(const std::vector<std::string>& patterns);
+
+	/**
+	 * @brief State of the source root (nothing consumed yet).
+	 */
+	State rootState() const;
+
+	/**
+	 * @brief State of a subdirectory.
+	 * @param parent State of the parent directory
+	 * @param name Name of the subdirectory
+	 */
+	State descend(const State& parent, std::string_view name) const;
+
+	/**
+	 * @brief Whether a pattern matches the entry name inside a directory completely.
+	 * @param dir State of the directory that contains the entry
+	 * @param name Name of the file or subdirectory
+	 */
+	bool matches(const State& dir, std::string_view name) const;
+
+	/**
+	 * @brief Returns the index of the first pattern that matches the entry name inside a directory.
+	 * @return Pattern index, or PatternUtils::GlobAutomaton::NoMatch
+	 */
+	std::uint32_t firstMatch(const State& dir, std::string_view name) const;
+
+	/**
+	 * @brief Whether anything below a directory with this state can still match.
+	 */
+	bool alive(const State& dir) const;
+
+	/**
+	 * @brief Whether the list has no patterns.
+	 */
+	bool empty() const { return m_starts.empty(); }
+
+	/**
+	 * @brief Whether a pattern is a path pattern (contains '/' apart from a trailing one).
+	 */
+	static bool isPathPattern(const std::string& pattern);
+
+private:
+	/**
+	 * @brief One position: a component to consume next, or the end of a pattern
+	 */
+	struct Position {
+		bool end = false;           ///< Pattern fully consumed
+		bool globstar = false;      ///< Component is "**"
+		bool last = false;          ///< Component is the last one of its pattern
+		std::uint32_t pattern = 0;  ///< Index of the pattern the position belongs to
+		PatternUtils::GlobPattern glob{ "" }; ///< Name pattern (unused for "**" and ends)
+	};
+
+	void addClosed(State& state, std::uint32_t position) const;
+
+	std::vector<Position> m_positions;  ///< All positions of all patterns, pattern by pattern
+	std::vector<std::uint32_t> m_starts; ///< First position of every pattern
+};
+
+/**
+ * @brief One rule of a rules file ("+ pattern" or "- pattern")
+ */
+struct Rule {
+	bool include = false; ///< '+' includes, '-' excludes
+	std::string pattern;  ///< Name or path pattern; a trailing '/' makes it a directory rule
+};
+
+/**
+ * @brief What the rules decided for an entry
+ */
+enum class RuleDecision {
+	None,    // No rule matched, the --types/--exclude-* filters decide
+	Include, // First matching rule is '+'
+	Exclude  // First matching rule is '-'
+};
+
+/**
+ * @brief Ordered rules evaluated with first-match-wins semantics.
+ *
+ * Rules ending in '/' apply to directories (an excluded directory is pruned,
+ * an included one is walked even if --exclude-dirs matches it), all other
+ * rules apply to files. Name rules of a kind share one
+ * PatternUtils::GlobAutomaton that reports the lowest matching rule index;
+ * path rules (containing '/') are anchored at the source root and advanced
+ * per directory like PathPatternList. An entry is therefore decided with one
+ * scan of its name plus the path positions of its directory, no matter how
+ * many rules there are.
+ */
+class RuleSet {
+public:
+	/**
+	 * @brief Path match state of a directory (file and directory rules)
+	 */
+	struct State {
+		PathPatternList::State files;
+		PathPatternList::State dirs;
+		PathPatternList::State includes; ///< Include file path rules that can still match (see canContainIncluded)
+	};
+
+	RuleSet() = default;
+
+	/**
+	 * @brief Compiles the rules in the given order.
+	 * @param rules Rules as read by load
+	 */
+	explicit RuleSet(const std::vector<Rule>& rules);
+
+	/**
+	 * @brief Reads a rules file: one "+ pattern" or "- pattern" per line,
+	 *        empty lines and lines starting with '#' or ';' are ignored.
+	 * @param file Path of the rules file
+	 * @return Rules in file order
+	 * @throws std::runtime_error if the file can't be read or a line is not a rule
+	 */
+	static std::vector<Rule> load(const std::filesystem::path& file);
+
+	/**
+	 * @brief Decides a file by the first matching file rule.
+	 * @param name Name of the file
+	 * @param dir State of the containing directory
+	 */
+	RuleDecision decideFile(std::string_view name, const State& dir) const;
+
+	/**
+	 * @brief Decides a subdirectory by the first matching directory rule.
+	 * @param name Name of the subdirectory
+	 * @param parent State of the parent directory
+	 */
+	RuleDecision decideDir(std::string_view name, const State& parent) const;
+
+	/**
+	 * @brief State of the source root.
+	 */
+	State rootState() const;
+
+	/**
+	 * @brief State of a subdirectory.
+	 */
+	State descend(const State& parent, std::string_view name) const;
+
+	/**
+	 * @brief Whether a directory can still contain files a rule includes or leaves to the filters.
+	 * False only below a catch-all exclude ("- *" or "- **") when no include rule before it can match any more.
+	 */
+	bool canContainIncluded(const State& dir) const;
+
+	/**
+	 * @brief Whether path rules are set (otherwise States stay empty).
+	 */
+	bool hasPathRules() const { return m_hasPathRules; }
+
+	/**
+	 * @brief Whether any '+' rule applies to files.
+	 */
+	bool includesFiles() const { return m_includesFiles; }
+
+	/**
+	 * @brief Whether there are no rules.
+	 */
+	bool empty() const { return m_rules.empty(); }
+
+	const std::vector<Rule>& rules() const { return m_rules; } ///< Rules in evaluation order
+
+private:
+	/**
+	 * @brief Name and path patterns of one kind (file or directory rules) with their rule indices
+	 */
+	struct Matcher {
+		std::vector<std::uint32_t> nameRules;  ///< Rule index per automaton pattern
+		PatternUtils::GlobAutomaton automaton; ///< Plain name patterns
+		std::vector<std::pair<std::uint32_t, PatternUtils::GlobPattern>> globs; ///< Name patterns not in the automaton
+		std::vector<std::uint32_t> pathRules;  ///< Rule index per path pattern
+		PathPatternList paths;                 ///< Path patterns
+
+		void build(const std::vector<std::pair<std::uint32_t, std::string>>& patterns);
+		std::uint32_t firstMatch(std::string_view name, const PathPatternList::State& dir) const;
+	};
+
+	RuleDecision decide(std::uint32_t rule) const;
+
+	std::vector<Rule> m_rules;
+	Matcher m_files;
+	Matcher m_dirs;
+	PathPatternList m_includePaths;    ///< Include file path rules before the catch-all exclude
+	bool m_pruneBelowCatchAll = false; ///< A catch-all exclude decides every file not included earlier
+	bool m_hasPathRules = false;
+	bool m_includesFiles = false;
+};
+
+/**
+ * @brief Immutable set of all filename filters of a run (--types, --exclude-files, --exclude-dirs).
+ *
+ * Compiled exactly once by ArgumentParser::parse (and therefore PresetLoader)
+ * and held as std::shared_ptr<const FilterSet> in PruneOptions; all methods are
+ * const, so planners and scanner threads share one instance without locking.
+ * Patterns containing '/' are path patterns (PathPatternList) relative to the
+ * source root; their per-directory PathState is carried by the walker.
+ * Ordered rules (--rules) are checked first; only entries no rule matches
+ * fall through to the three lists.
+ */
+class FilterSet {
+public:
+	/**
+	 * @brief Match state of a directory for the path patterns of all three lists and the rules
+	 */
+	struct PathState {
+		PathPatternList::State types;
+		PathPatternList::State excludeFiles;
+		PathPatternList::State excludeDirs;
+		RuleSet::State rules;
+	};
+
+	/**
+	 * @brief Outcome of all file filters for one file
+	 */
+	enum class FileDecision {
+		Copy,        // Included and not excluded
+		NotIncluded, // Not matched by --types (silently ignored)
+		Excluded     // Excluded by a rule or --exclude-files (logged as skipped)
+	};
+
+	FilterSet() = default;
+
+	/**
+	 * @brief Compiles all three pattern lists and the rules.
+	 * @param types Include patterns (empty = every file)
+	 * @param excludeFiles File name patterns to skip
+	 * @param excludeDirs Directory name patterns to prune
+	 * @param rules Ordered rules checked before the lists (first match wins)
+	 */
+	FilterSet(const std::vector<std::string>& types, const std::vector<std::string>& excludeFiles,
+		const std::vector<std::string>& excludeDirs, const std::vector<Rule>& rules = {});
+
+	/**
+	 * @brief Applies the rules, then the include and exclude-file patterns, in one call.
+	 * @param filename Name of the file
+	 * @param dir PathState of the containing directory
+	 */
+	FileDecision classifyFile(std::string_view filename, const PathState& dir) const;
+
+	/**
+	 * @brief Whether a filename passes the include patterns (always true without --types).
+	 * @param filename Name of the file
+	 * @param dir PathState of the containing directory (root state if omitted)
+	 */
+	bool isIncluded(std::string_view filename) const;
+	bool isIncluded(std::string_view filename, const PathState& dir) const;
+
+	/**
+	 * @brief Whether a filename matches an exclude-file pattern.
+	 * @param filename Name of the file
+	 * @param dir PathState of the containing directory (root state if omitted)
+	 */
+	bool isExcludedFile(std::string_view filename) const;
+	bool isExcludedFile(std::string_view filename, const PathState& dir) const;
+
+	/**
+	 * @brief Whether a directory is pruned (directory rules first, then the exclude-dir patterns).
+	 * @param dirname Name of the directory
+	 * @param parent PathState of the parent directory (root state if omitted)
+	 */
+	bool isExcludedDir(std::string_view dirname) const;
+	bool isExcludedDir(std::string_view dirname, const PathState& parent) const;
+
+	/**
+	 * @brief Whether any path patterns are set (otherwise PathStates stay empty).
+	 */
+	bool hasPathPatterns() const { return m_hasPathPatterns; }
+
+	/**
+	 * @brief PathState of the source root.
+	 */
+	PathState rootState() const;
+
+	/**
+	 * @brief PathState of a subdirectory.
+	 * @param parent PathState of the parent directory
+	 * @param dirname Name of the subdirectory
+	 */
+	PathState descend(const PathState& parent, std::string_view dirname) const;
+
+	/**
+	 * @brief Whether a directory can still contain included files.
+	 * False when --types consists of path patterns and none of them can match below it,
+	 * or when the rules exclude every file below it (RuleSet::canContainIncluded).
+	 */
+	bool canContainIncluded(const PathState& dir) const;
+
+	const PatternList& types() const { return m_types; }               ///< Include patterns
+	const PatternList& excludeFiles() const { return m_excludeFiles; } ///< Exclude-file patterns
+	const PatternList& excludeDirs() const { return m_excludeDirs; }   ///< Exclude-dir patterns
+	const RuleSet& rules() const { return m_rules; }                   ///< Ordered rules
+
+private:
+	PatternList m_types;
+	PatternList m_excludeFiles;
+	PatternList m_excludeDirs;
+	PathPatternList m_pathTypes;
+	PathPatternList m_pathExcludeFiles;
+	PathPatternList m_pathExcludeDirs;
+	RuleSet m_rules;
+	bool m_hasPathPatterns = false;
+};
@@ -0,0 +1,104 @@
+/*****************************************************************//**
+ * @file   IgnoreStack.cpp
+ * @brief  Implements gitignore parsing and the layered ignore matchers
+ *
+ * @author Patrik Neunteufel
+ * @date   May 2025
+ *********************************************************************/
+
+#include "util/IgnoreStack.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+    // Trailing blanks are dropped unless escaped with a backslash
+    std::string trimTrailing(const std::string& line) {
+        size_t end = line.size();
+        while (end > 0 && (line[end - 1] == ' ' || line[end - 1] == '\t' || line[end - 1] == '\r')) {
+            if (line[end - 1] == ' ' && end > 1 && line[end - 2] == '\\') break;
+            --end;
+        }
+        return line.substr(0, end);
+    }
+
+}
+
+// Negation becomes an include rule; lines without a trailing '/' apply to files and directories
+std::vector<Rule> IgnoreStack::parse(std::istream& in) {
+    std::vector<Rule> rules;
+    std::string line;
+    while (std::getline(in, line)) {
+        std::string pattern = trimTrailing(line);
+        if (pattern.empty() || pattern[0] == '#') continue;
+
+        const bool negate = pattern[0] == '!';
+        if (negate) pattern.erase(0, 1);
+        if (!pattern.empty() && pattern[0] == '\\' && pattern.size() > 1 && (pattern[1] == '#' || pattern[1] == '!')) {
+            pattern.erase(0, 1);
+        }
+        if (pattern.empty() || pattern == "/") continue;
+
+        if (pattern.back() == '/') {
+            rules.push_back({ negate, pattern });
+        }
+        else {
+            rules.push_back({ negate, pattern });
+            rules.push_back({ negate, pattern + "/" });
+        }
+    }
+    // The last matching line wins in gitignore, the first matching rule in RuleSet
+    std::reverse(rules.begin(), rules.end());
+    return rules;
+}
+
+// Shares the parent's stack unless the directory adds an ignore file or path states move on
+std::shared_ptr<const IgnoreStack> IgnoreStack::enter(const std::shared_ptr<const IgnoreStack>& parent, const fs::path& dir) {
+    std::stringstream content;
+    bool found = false;
+    for (const char* name : FileNames) {
+        std::ifstream file(dir / name);
+        if (file) {
+            content << file.rdbuf() << '\n';
+            found = true;
+        }
+    }
+    std::vector<Rule> rules = found ? parse(content) : std::vector<Rule>{};
+
+    if (rules.empty() && parent && !parent->m_hasPathRules) {
+        return parent;
+    }
+
+    auto stack = std::make_shared<IgnoreStack>();
+    if (parent) {
+        const std::string name = dir.filename().string();
+        stack->m_layers.reserve(parent->m_layers.size() + 1);
+        for (const Layer& layer : parent->m_layers) {
+            stack->m_layers.push_back({ layer.rules, layer.rules->hasPathRules() ? layer.rules->descend(layer.state, name) : layer.state });
+        }
+        stack->m_hasPathRules = parent->m_hasPathRules;
+    }
+    if (!rules.empty()) {
+        auto compiled = std::make_shared<const RuleSet>(rules);
+        stack->m_hasPathRules = stack->m_hasPathRules || compiled->hasPathRules();
+        RuleSet::State state = compiled->rootState();
+        stack->m_layers.push_back({ std::move(compiled), std::move(state) });
+    }
+    return stack;
+}
+
+// The deepest ignore file with a matching line decides
+bool IgnoreStack::isIgnored(std::string_view name, bool isDirectory) const {
+    for (auto it = m_layers.rbegin(); it != m_layers.rend(); ++it) {
+        const RuleDecision decision = isDirectory ? it->rules->decideDir(name, it->state) : it->rules->decideFile(name, it->state);
+        if (decision != RuleDecision::None) {
+            return decision == RuleDecision::Exclude;
+        }
+    }
+    return false;
+}
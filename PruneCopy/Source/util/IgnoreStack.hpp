@@ -0,0 +1,75 @@
+/*****************************************************************//**
+ * @file   IgnoreStack.hpp
+ * @brief  Layered .gitignore / .prunecopyignore matchers carried by the directory walker
+ *
+ * @author Patrik Neunteufel
+ * @date   May 2025
+ *********************************************************************/
+
+#pragma once
+#include <filesystem>
+#include <istream>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "util/FilterSet.hpp"
+
+/**
+ * @brief Ignore files of a directory and all its ancestors below the source root.
+ *
+ * Every ignore file is compiled once into a RuleSet (gitignore lines in
+ * reverse order, so the first match of the RuleSet is the last match of the
+ * file) and kept as one layer. A directory shares its parent's stack as long
+ * as it has no ignore file of its own and no layer uses path patterns, so
+ * the walker only builds a new stack where something actually changes.
+ * Deeper layers are asked first; the first layer with a matching line
+ * decides, '!' lines un-ignore. Matching is ASCII case-insensitive like all
+ * PruneCopy patterns.
+ */
+class IgnoreStack {
+public:
+	/**
+	 * @brief Ignore files read in every directory (later ones take precedence)
+	 */
+	static constexpr const char* FileNames[] = { ".gitignore", ".prunecopyignore" };
+
+	/**
+	 * @brief Returns the stack of a directory.
+	 * @param parent Stack of the parent directory (nullptr for the source root)
+	 * @param dir The directory; its ignore files are read here
+	 */
+	static std::shared_ptr<const IgnoreStack> enter(const std::shared_ptr<const IgnoreStack>& parent,
+		const std::filesystem::path& dir);
+
+	/**
+	 * @brief Converts gitignore lines into rules with first-match-wins order.
+	 * @param in Content of one or more ignore files (later lines take precedence)
+	 * @return Rules for RuleSet (Exclude = ignored, Include = un-ignored by '!')
+	 */
+	static std::vector<Rule> parse(std::istream& in);
+
+	/**
+	 * @brief Whether an entry of the directory is ignored.
+	 * @param name Name of the file or subdirectory
+	 * @param isDirectory Whether the entry is a directory ("build/" lines only match directories)
+	 */
+	bool isIgnored(std::string_view name, bool isDirectory) const;
+
+	/**
+	 * @brief Whether no ignore file applies to the directory.
+	 */
+	bool empty() const { return m_layers.empty(); }
+
+private:
+	/**
+	 * @brief One ignore file and the path state of the current directory relative to it
+	 */
+	struct Layer {
+		std::shared_ptr<const RuleSet> rules;
+		RuleSet::State state;
+	};
+
+	std::vector<Layer> m_layers; ///< Outermost first
+	bool m_hasPathRules = false; ///< Some layer needs its state advanced per directory
+};
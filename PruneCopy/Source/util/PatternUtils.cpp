@@ -6,9 +6,39 @@
  * @date   April 2025
  *********************************************************************/
 
+#include <algorithm>
 #include <filesystem>
+#include <map>
 #include "util/PatternUtils.hpp"
 
+namespace {
+
+    // ECMAScript '.' (and therefore '*' and '?') doesn't match line terminators
+    bool isLineTerminator(char c) {
+        return c == '\n' || c == '\r';
+    }
+
+    // ASCII-only folding, the same the icase regex does in the classic locale
+    char foldCase(char c) {
+        return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+    }
+
+    // Compares a lower-cased segment against the name at a position ('?' matches one character)
+    bool segmentMatchesAt(std::string_view name, size_t pos, const std::string& segment) {
+        for (size_t i = 0; i < segment.size(); ++i) {
+            const char c = name[pos + i];
+            if (segment[i] == '?') {
+                if (isLineTerminator(c)) return false;
+            }
+            else if (foldCase(c) != segment[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+}
+
 
  // Converts a list of wildcard strings (e.g. "*.cpp", "file?.txt") to case-insensitive regex patterns.
 // Wildcards: * → .*, ? → . ; all other regex meta-characters are escaped.
@@ -60,8 +90,213 @@ std::vector<std::regex> PatternUtils::convertToRegex(const std::vector<std::stri
 // Supports glob wildcards: * matches any sequence of characters, ? matches a single character.
 // An exact name (no wildcards) must match the full directory name.
 bool PatternUtils::isExcludedDir(const std::filesystem::path& dir, const std::vector<std::string>& excludeDirs) {
+    return isExcludedDir(dir, compileGlobs(excludeDirs));
+}
+
+// Same check with patterns that were compiled once (hot path of the directory walk)
+bool PatternUtils::isExcludedDir(const std::filesystem::path& dir, const std::vector<GlobPattern>& excludeDirPatterns) {
     const std::string name = dir.filename().string();
-    const std::vector<std::regex> patterns = convertToRegex(excludeDirs);
-    return matchesPattern(name, patterns);
+    return matchesPattern(name, excludeDirPatterns);
+}
+
+// Compiles a pattern into '*'-separated segments; glob patterns with regex syntax keep a regex
+PatternUtils::GlobPattern::GlobPattern(const std::string& pattern, GlobSyntax syntax) {
+    if (syntax == GlobSyntax::Glob && pattern.find_first_of("[](){}+^$|\\") != std::string::npos) {
+        m_fallback.emplace(globToRegex(pattern), std::regex::icase);
+        return;
+    }
+
+    m_segments.emplace_back();
+    for (char c : pattern) {
+        if (c == '*') {
+            m_segments.emplace_back();
+        }
+        else {
+            m_segments.back() += foldCase(c);
+        }
+    }
 }
 
+// First and last segment are anchored, the ones in between are taken leftmost-first
+bool PatternUtils::GlobPattern::matches(std::string_view name) const {
+    if (m_fallback) {
+        return std::regex_match(name.begin(), name.end(), *m_fallback);
+    }
+
+    const std::string& prefix = m_segments.front();
+    if (m_segments.size() == 1) {
+        return name.size() == prefix.size() && segmentMatchesAt(name, 0, prefix);
+    }
+
+    const std::string& suffix = m_segments.back();
+    if (prefix.size() + suffix.size() > name.size() ||
+        !segmentMatchesAt(name, 0, prefix) ||
+        !segmentMatchesAt(name, name.size() - suffix.size(), suffix)) {
+        return false;
+    }
+
+    size_t pos = prefix.size();
+    const size_t end = name.size() - suffix.size();
+    for (size_t i = 1; i + 1 < m_segments.size(); ++i) {
+        const std::string& segment = m_segments[i];
+        // The earliest occurrence leaves the most room for the rest; a '*' can't skip a line terminator
+        while (true) {
+            if (pos + segment.size() > end) return false;
+            if (segmentMatchesAt(name, pos, segment)) break;
+            if (isLineTerminator(name[pos])) return false;
+            ++pos;
+        }
+        pos += segment.size();
+    }
+
+    // The last '*' covers the rest up to the suffix
+    for (; pos < end; ++pos) {
+        if (isLineTerminator(name[pos])) return false;
+    }
+    return true;
+}
+
+// Builds the DFA by subset construction over the positions of all patterns
+PatternUtils::GlobAutomaton::GlobAutomaton(const std::vector<std::string>& patterns, size_t stateLimit) {
+    // NFA: one state per (pattern, position); a position holds '*', '?', a lower-cased literal or the end
+    std::vector<std::string> tokens;
+    std::vector<std::uint32_t> offsets;
+    std::uint32_t nfaSize = 0;
+    for (const auto& pattern : patterns) {
+        std::string lowered;
+        for (char c : pattern) lowered += foldCase(c);
+        offsets.push_back(nfaSize);
+        nfaSize += static_cast<std::uint32_t>(lowered.size() + 1);
+        tokens.push_back(std::move(lowered));
+    }
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> positions; // NFA state -> (pattern, position)
+    for (std::uint32_t i = 0; i < tokens.size(); ++i) {
+        for (std::uint32_t j = 0; j <= tokens[i].size(); ++j) positions.emplace_back(i, j);
+    }
+
+    // Character classes: every literal gets its own class, terminators and the rest share one each
+    std::map<int, std::uint8_t> classIds;
+    std::vector<unsigned char> representative;
+    for (int b = 0; b < 256; ++b) {
+        const char c = static_cast<char>(b);
+        const char folded = foldCase(c);
+        bool literal = false;
+        for (const auto& t : tokens) {
+            if (t.find(folded) != std::string::npos && folded != '*' && folded != '?') {
+                literal = true;
+                break;
+            }
+        }
+        const int key = literal ? static_cast<unsigned char>(folded) : (isLineTerminator(c) ? 256 : 257);
+        auto [it, inserted] = classIds.emplace(key, static_cast<std::uint8_t>(classIds.size()));
+        if (inserted) representative.push_back(static_cast<unsigned char>(b));
+        m_classOf[b] = it->second;
+    }
+    m_classCount = representative.size();
+
+    // Adds a state and everything reachable over '*' matching nothing
+    auto addClosed = [&](std::vector<std::uint32_t>& set, std::uint32_t pattern, std::uint32_t pos) {
+        while (true) {
+            set.push_back(offsets[pattern] + pos);
+            if (pos == tokens[pattern].size() || tokens[pattern][pos] != '*') break;
+            ++pos;
+        }
+    };
+    auto normalize = [](std::vector<std::uint32_t>& set) {
+        std::sort(set.begin(), set.end());
+        set.erase(std::unique(set.begin(), set.end()), set.end());
+    };
+
+    std::map<std::vector<std::uint32_t>, std::uint32_t> ids;
+    std::vector<std::vector<std::uint32_t>> sets;
+    auto stateOf = [&](std::vector<std::uint32_t>&& set) -> std::uint32_t {
+        auto it = ids.find(set);
+        if (it != ids.end()) return it->second;
+        const std::uint32_t id = static_cast<std::uint32_t>(sets.size());
+        ids.emplace(set, id);
+        sets.push_back(std::move(set));
+        return id;
+    };
+
+    std::vector<std::uint32_t> start;
+    for (std::uint32_t i = 0; i < tokens.size(); ++i) addClosed(start, i, 0);
+    normalize(start);
+    stateOf(std::move(start));
+    m_dead = stateOf({});
+
+    std::vector<std::uint32_t> next;
+    std::vector<std::uint32_t> firstAccept;
+    for (std::uint32_t state = 0; state < sets.size(); ++state) {
+        if (sets.size() > stateLimit) {
+            return; // not ready: the caller matches pattern by pattern
+        }
+        std::uint32_t first = NoMatch;
+        for (std::uint32_t nfa : sets[state]) {
+            const auto [pattern, pos] = positions[nfa];
+            if (pos == tokens[pattern].size()) first = std::min(first, pattern);
+        }
+        firstAccept.push_back(first);
+
+        for (size_t cls = 0; cls < m_classCount; ++cls) {
+            const char c = static_cast<char>(representative[cls]);
+            std::vector<std::uint32_t> target;
+            for (std::uint32_t nfa : sets[state]) {
+                const auto [pattern, pos] = positions[nfa];
+                if (pos == tokens[pattern].size()) continue;
+                const char token = tokens[pattern][pos];
+                if (token == '*') {
+                    if (!isLineTerminator(c)) addClosed(target, pattern, pos);
+                }
+                else if (token == '?') {
+                    if (!isLineTerminator(c)) addClosed(target, pattern, pos + 1);
+                }
+                else if (token == foldCase(c)) {
+                    addClosed(target, pattern, pos + 1);
+                }
+            }
+            normalize(target);
+            next.push_back(stateOf(std::move(target))); // may be beyond the limit, checked on the next round
+        }
+    }
+
+    m_next = std::move(next);
+    m_firstAccept = std::move(firstAccept);
+}
+
+// One table lookup per character; stops early once no pattern can match any more
+std::uint32_t PatternUtils::GlobAutomaton::firstMatch(std::string_view name) const {
+    std::uint32_t state = 0;
+    for (char c : name) {
+        state = m_next[state * m_classCount + m_classOf[static_cast<unsigned char>(c)]];
+        if (state == m_dead) return NoMatch;
+    }
+    return m_firstAccept[state];
+}
+
+// Compiles glob patterns (same semantics as convertToRegex)
+std::vector<PatternUtils::GlobPattern> PatternUtils::compileGlobs(const std::vector<std::string>& patterns) {
+    std::vector<GlobPattern> result;
+    result.reserve(patterns.size());
+    for (const auto& pattern : patterns) {
+        result.emplace_back(pattern, GlobSyntax::Glob);
+    }
+    return result;
+}
+
+// Compiles wildcard patterns (same semantics as wildcardsToRegex)
+std::vector<PatternUtils::GlobPattern> PatternUtils::compileWildcards(const std::vector<std::string>& wildcards) {
+    std::vector<GlobPattern> result;
+    result.reserve(wildcards.size());
+    for (const auto& wildcard : wildcards) {
+        result.emplace_back(wildcard, GlobSyntax::Wildcard);
+    }
+    return result;
+}
+
+// Checks whether a given filename matches any of the compiled patterns.
+bool PatternUtils::matchesPattern(std::string_view filename, const std::vector<GlobPattern>& patterns) {
+    for (const auto& pattern : patterns) {
+        if (pattern.matches(filename)) return true;
+    }
+    return false;
+}
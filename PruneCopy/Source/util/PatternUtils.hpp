@@ -1,6 +1,6 @@
 /*****************************************************************//**
  * @file   PatternUtils.hpp
- * @brief  Provides pattern matching utilities (wildcard to regex)
+ * @brief  Provides pattern matching utilities (wildcard to regex, compiled globs)
  * 
  * @author Patrik Neunteufel
  * @date   April 2025
@@ -10,11 +10,137 @@
 
 #include <vector>
 #include <string>
+#include <array>
+#include <cstdint>
 #include <regex>
+#include <optional>
+#include <string_view>
 #include <filesystem>
 
 namespace PatternUtils {
 
+    /**
+     * @brief Which regex conversion a GlobPattern reproduces.
+     */
+    enum class GlobSyntax {
+        Glob,     // Same as globToRegex/convertToRegex: only * ? and . are translated, other regex syntax stays active
+        Wildcard  // Same as wildcardsToRegex: everything except * and ? is literal
+    };
+
+    /**
+     * @brief Compiled glob pattern matched without std::regex.
+     *
+     * The pattern is split at '*' into lower-cased segments once; matching
+     * anchors the first and last segment and finds the others leftmost-first,
+     * so there is no backtracking. Case folding is ASCII only and * / ? never
+     * match '\n' or '\r', exactly like the icase ECMAScript regex it replaces.
+     * Glob patterns that use other regex syntax ([ ] ( ) { } + ^ $ | \) keep
+     * the regex from globToRegex so results stay identical.
+     */
+    class GlobPattern {
+    public:
+        /**
+         * @brief Compiles a pattern.
+         * @param pattern The pattern (e.g. "*.hpp")
+         * @param syntax Which regex conversion to reproduce
+         */
+        explicit GlobPattern(const std::string& pattern, GlobSyntax syntax = GlobSyntax::Glob);
+
+        /**
+         * @brief Checks whether the whole name matches (case-insensitive).
+         * @param name The filename to test
+         * @return true on a match
+         */
+        bool matches(std::string_view name) const;
+
+        /**
+         * @brief Whether the pattern needed the regex fallback.
+         */
+        bool usesRegex() const { return m_fallback.has_value(); }
+
+    private:
+        std::vector<std::string> m_segments;  ///< Lower-cased parts between the '*' (size = stars + 1)
+        std::optional<std::regex> m_fallback; ///< Set for glob patterns with regex syntax
+    };
+
+    /**
+     * @brief All glob patterns of a list compiled into one DFA.
+     *
+     * A filename is scanned once, one table lookup per character, and the
+     * final state tells whether any of the patterns accepts it. Characters are
+     * grouped into classes (each literal of the patterns, line terminators,
+     * everything else) to keep the table small. Patterns must not need the
+     * regex fallback of GlobPattern (GlobPattern::usesRegex).
+     *
+     * Subset construction can blow up for many '*' patterns; if more than
+     * stateLimit states would be needed the automaton stays empty, ready()
+     * returns false and the caller keeps matching pattern by pattern.
+     */
+    class GlobAutomaton {
+    public:
+        static constexpr size_t DefaultStateLimit = 4096; ///< Upper bound for the number of DFA states
+        static constexpr std::uint32_t NoMatch = UINT32_MAX; ///< firstMatch result without a match
+
+        GlobAutomaton() = default;
+
+        /**
+         * @brief Builds the DFA (paid once per run).
+         * @param patterns Glob patterns with * and ? only
+         * @param stateLimit Maximum number of states before giving up
+         */
+        explicit GlobAutomaton(const std::vector<std::string>& patterns, size_t stateLimit = DefaultStateLimit);
+
+        /**
+         * @brief Whether the DFA was built (false if the state limit was hit).
+         */
+        bool ready() const { return !m_firstAccept.empty(); }
+
+        /**
+         * @brief Checks whether any pattern matches the whole name (case-insensitive).
+         */
+        bool matches(std::string_view name) const { return firstMatch(name) != NoMatch; }
+
+        /**
+         * @brief Returns the index of the first pattern (in construction order) that matches the whole name.
+         * @return Pattern index, or NoMatch
+         */
+        std::uint32_t firstMatch(std::string_view name) const;
+
+        /**
+         * @brief Number of DFA states (0 if not ready).
+         */
+        size_t stateCount() const { return m_firstAccept.size(); }
+
+    private:
+        std::array<std::uint8_t, 256> m_classOf{}; ///< Character class per byte
+        size_t m_classCount = 0;                   ///< Number of character classes
+        std::vector<std::uint32_t> m_next;         ///< Transition table [state * m_classCount + class]
+        std::vector<std::uint32_t> m_firstAccept;  ///< Lowest accepted pattern index per state (NoMatch if none)
+        std::uint32_t m_dead = 0;                  ///< State without any live pattern
+    };
+
+    /**
+     * @brief Compiles glob patterns with the semantics of convertToRegex.
+     * @param patterns Vector of glob strings (e.g., "*.hpp")
+     * @return Vector of compiled patterns
+     */
+    std::vector<GlobPattern> compileGlobs(const std::vector<std::string>& patterns);
+
+    /**
+     * @brief Compiles wildcard patterns with the semantics of wildcardsToRegex.
+     * @param wildcards Vector of wildcard strings (e.g., "*.hpp")
+     * @return Vector of compiled patterns
+     */
+    std::vector<GlobPattern> compileWildcards(const std::vector<std::string>& wildcards);
+
+    /**
+     * @brief Checks whether a filename matches any of the given compiled patterns.
+     * @param filename Name of file to test
+     * @param patterns Compiled pattern list
+     * @return true if any match, false otherwise
+     */
+    bool matchesPattern(std::string_view filename, const std::vector<GlobPattern>& patterns);
+
     /**
      * @brief Converts a list of wildcard patterns to equivalent regex objects.
      * @param wildcards Vector of wildcard strings (e.g., "*.hpp")
@@ -54,5 +180,13 @@ namespace PatternUtils {
 	 */
     bool isExcludedDir(const std::filesystem::path& dir, const std::vector<std::string>& excludeDirs);
 
+	/**
+	 * @brief Checks a directory name against exclusion patterns compiled once with compileGlobs.
+	 * @param dir Directory path to check (only the filename component is used)
+	 * @param excludeDirPatterns Compiled exclusion patterns
+	 * @return true if the directory is excluded, false otherwise
+	 */
+    bool isExcludedDir(const std::filesystem::path& dir, const std::vector<GlobPattern>& excludeDirPatterns);
+
 
 } // namespace PatternUtils